@@ -51,6 +51,10 @@
 //SD6 A1 TCP RemoteCommandService
 #define AUTOSTART_REMOTE_COMMAND_SERVICE //Will try to auto-join on program start, or host if that fails.
 
+//SD6 Dedicated Server
+//#define HEADLESS_SERVER //Set by the DedicatedServer build configuration instead of here: console app, no window, renderer, audio or FMOD.
+//--
+
 /* Examples of Other Settings
 	#ifdef __MSC_VER 
 		#ifdef (_WIN32)
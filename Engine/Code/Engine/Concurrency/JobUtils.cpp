@@ -116,9 +116,11 @@ void JobSystem::AcquireJob( Job* job )
 //--------------------------------------------------------------------------------------------------------------
 void JobSystem::ReleaseJob( Job* job )
 {
-	--job->refCount; 
-	if ( job->refCount == JOB_REFCOUNT_UNREFERENCED )
+	if ( --job->refCount == JOB_REFCOUNT_UNREFERENCED )
+	{
+		free( job->jobData.buffer ); //Malloc'd by CreateJob.
 		m_jobPool.Delete( job );
+	}
 }
 
 
@@ -161,10 +163,20 @@ bool JobConsumer::TryConsumingOneJob()
 //--------------------------------------------------------------------------------------------------------------
 STATIC void JobConsumer::RunJobsUntilShutdown( JobConsumer* consumer )
 {
+	const double SECONDS_TO_STAY_AWAKE = .05; //A few frames' worth, so a worker fed every frame (e.g. NetSession::Update's packet jobs) never sleeps through a batch.
+	double lastJobSeconds = -SECONDS_TO_STAY_AWAKE;
+
 	while ( JobSystem::Instance()->IsRunning() )
 	{
-		consumer->TryConsumingAllJobs();
-		Thread::ThreadSleep( std::chrono::milliseconds( 100 ) );
+		if ( consumer->TryConsumingOneJob() )
+		{
+			consumer->TryConsumingAllJobs();
+			lastJobSeconds = GetCurrentTimeSeconds();
+		}
+		else if ( ( GetCurrentTimeSeconds() - lastJobSeconds ) < SECONDS_TO_STAY_AWAKE )
+			Thread::ThreadYield();
+		else
+			Thread::ThreadSleep( std::chrono::milliseconds( 100 ) );
 	}
 	consumer->TryConsumingAllJobs(); //Re-runs the above loop one last time, in case we were told to stop while messages are still queued.
 }
@@ -201,7 +213,7 @@ STATIC void JobConsumer::RunOneJob( JobConsumer* consumer )
 	if ( JobSystem::Instance()->IsRunning() )
 	{
 		if ( !consumer->TryConsumingOneJob() )
-			Thread::ThreadSleep( std::chrono::milliseconds( 100 ) );
+			Thread::ThreadYield(); //Sleeping here would stall WaitOnJobForCompletion long after the job it's waiting on finishes.
 	}
 }
 
@@ -4,6 +4,7 @@
 #include "Engine/Memory/ObjectPool.hpp"
 #include "Engine/Memory/LinearMemoryBuffer.hpp"
 #include "Engine/Concurrency/ThreadSafeQueue.hpp"
+#include <atomic>
 struct Job;
 class Thread;
 typedef ThreadSafeQueue<Job*> JobQueue;
@@ -36,7 +37,7 @@ struct Job //The benefit of a job system over just spawning a thread per job: CR
 {
 	//Important: jobs need to remain the same size for the JobSystem::m_jobPool object pool allocator.
 	JobCategory jobType;
-	int refCount; //Start at 2. Releases one from the thread that completes its work, and the other either immediately from DetachJob or on completion in WaitOnJob.
+	std::atomic<int> refCount; //Start at 2. Releases one from the thread that completes its work, and the other either immediately from DetachJob or on completion in WaitOnJob (which polls it, hence atomic).
 
 	JobCallback* jobCallback; //Note: best to send jobs for anything that can be thought of as an array of elements updated independently, e.g. particle list.
 	CBuffer jobData;
@@ -101,9 +102,9 @@ public:
 	static JobConsumer* Create( JobCategory orderedFilterCategories[], size_t numCategories );
 
 	//These run-prefixed functions differ from try-prefixed because they check JobSystem::IsRunning.
-	static void RunJobsUntilShutdown( JobConsumer* consumer );
+	static void RunJobsUntilShutdown( JobConsumer* consumer ); //Yields rather than sleeps for a little while after its last job, so per-frame jobs find it awake.
 	static void RunJobsForMilliseconds( JobConsumer* consumer, float ms );
-	static void RunOneJob( JobConsumer* consumer );
+	static void RunOneJob( JobConsumer* consumer ); //Yields if there was nothing to run, since the caller's usually spinning on a job another thread holds.
 
 
 private:
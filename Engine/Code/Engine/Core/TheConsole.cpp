@@ -1,5 +1,6 @@
 #include "Engine/Core/TheConsole.hpp"
 #include <stdarg.h>
+#include <stdio.h>
 #include "Engine/Input/TheInput.hpp"
 #include "Engine/Renderer/BitmapFont.hpp"
 #include "Engine/Math/MathUtils.hpp"
@@ -130,6 +131,9 @@ void TheConsole::vaPrint( const char* messageFormat, va_list variableArgumentLis
 	finalMessage += ": ";
 	finalMessage += messageLiteral;
 	m_storedText.push_back( std::pair< std::string, Rgba>( finalMessage, m_currentColor ) );
+#ifdef HEADLESS_SERVER
+	printf( "%s\n", finalMessage.c_str() ); //Nothing renders the console, so stdout is the only place to read it.
+#endif
 
 	unsigned int indexOfNewestStoredText = ( m_storedText.size() > 0 ) ? m_storedText.size() - 1 : 0;
 	m_bottommostLogIndexToRender = indexOfNewestStoredText;
@@ -169,6 +173,7 @@ void TheConsole::HideConsole()
 }
 
 
+#ifndef HEADLESS_SERVER //TheRenderer isn't built into servers, they echo to stdout instead.
 //--------------------------------------------------------------------------------------------------------------
 void TheConsole::Render() //Recall up is +y.
 {
@@ -261,6 +266,7 @@ void TheConsole::RenderPreviousTextEntries( float consoleX, float spacingPx, flo
 		positionInLog.y -= heightOfOneLinePx; //Move caret down to next line.
 	}
 }
+#endif
 
 
 //--------------------------------------------------------------------------------------------------------------
@@ -19,6 +19,12 @@ class Command;
 //--------------------------------------------------------------------------------------------------------------
 extern TheConsole* g_theConsole;
 
+#ifdef HEADLESS_SERVER
+	#define CONSOLE_DEFAULT_FONT nullptr //No renderer, and nothing draws the console anyway.
+#else
+	#define CONSOLE_DEFAULT_FONT g_theRenderer->GetDefaultFont()
+#endif
+
 
 //--------------------------------------------------------------------------------------------------------------
 typedef void( ConsoleCommandCallback )( Command& );
@@ -55,7 +61,7 @@ public:
 	TheConsole( double consoleX, double consoleY, double consoleWidth, double screenHeight,
 				bool showPromptBox = true,
 				const Rgba& textColor = Rgba(), bool isVisible = false, float textScale = .25f,
-				double maxConsoleHeightCoverageNormalized = 0.3, BitmapFont* font = g_theRenderer->GetDefaultFont() )
+				double maxConsoleHeightCoverageNormalized = 0.3, BitmapFont* font = CONSOLE_DEFAULT_FONT )
 		: m_currentColor( textColor )
 		, m_isVisible( isVisible )
 		, m_currentScale( textScale )
@@ -218,7 +218,7 @@ static const bool SHOULD_INDEED_UNSUB = true;
 
 //--------------------------------------------------------------------------------------------------------------
 //Networking
-typedef uint8_t NetConnectionIndex;
+typedef uint16_t NetConnectionIndex; //INVALID_CONNECTION_INDEX is its max value.
 #define MAX_GUID_LENGTH	(32)
 enum NetCoreMessageType : uint8_t //Limited to 256 total message types, 0-255.
 {
@@ -229,5 +229,8 @@ enum NetCoreMessageType : uint8_t //Limited to 256 total message types, 0-255.
 	NETMSG_JOIN_ACCEPT,
 	NETMSG_JOIN_DENY,
 	NETMSG_LEAVE,
+	NETMSG_FRAGMENT, //A piece of a message too big for one NetMessage, cf. NetConnection::SendFragmentsToThem.
+	NETMSG_CLOCK_SYNC_REQUEST, //Clients ask the host's time every so often, cf. NetConnection::QueueClockSyncMessages.
+	NETMSG_CLOCK_SYNC_RESPONSE,
 	MAX_CORE_NETMSG_TYPES //Assigned to the first game-side message type.
 };
\ No newline at end of file
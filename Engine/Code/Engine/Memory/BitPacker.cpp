@@ -0,0 +1,250 @@
+#include "Engine/Memory/BitPacker.hpp"
+#include "Engine/Error/ErrorWarningAssert.hpp"
+
+
+//--------------------------------------------------------------------------------------------------------------
+static uint32_t GetMaxValueForBitWidth( uint8_t numBits )
+{
+	return ( numBits >= MAX_BITS_PER_WRITE ) ? 0xFFFFFFFF : ( ( 1u << numBits ) - 1 );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+BitPacker::BitPacker( void* buffer, size_t bufferSizeBytes, BitPackerMode mode )
+	: m_buffer( (byte_t*)buffer )
+	, m_bufferSizeBytes( bufferSizeBytes )
+	, m_mode( mode )
+	, m_bitOffset( 0 )
+{
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+BitPacker::BitPacker( const BytePacker& byteStream, BitPackerMode mode )
+	: m_buffer( byteStream.GetIoHead() )
+	, m_bufferSizeBytes( ( mode == BITPACKER_MODE_WRITE ) ? byteStream.GetWritableBytes() : byteStream.GetReadableBytes() )
+	, m_mode( mode )
+	, m_bitOffset( 0 )
+{
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool BitPacker::CanAccessBits( uint8_t numBits, BitPackerMode mode ) const
+{
+	if ( m_mode != mode )
+	{
+		ERROR_RECOVERABLE( "BitPacker used against the mode it was made for!" );
+		return false;
+	}
+
+	return ( numBits <= MAX_BITS_PER_WRITE ) && ( numBits <= GetRemainingBits() );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool BitPacker::WriteBits( uint32_t value, uint8_t numBits )
+{
+	if ( !CanAccessBits( numBits, BITPACKER_MODE_WRITE ) )
+		return false; //Too big for m_buffer to hold.
+
+	//Fill the rest of the current byte, then whole bytes, then the front of the last byte, highest bits first.
+	uint8_t numBitsLeft = numBits;
+	while ( numBitsLeft > 0 )
+	{
+		size_t byteIndex = m_bitOffset / NUM_BITS_IN_BYTE;
+		uint8_t numBitsFreeInByte = (uint8_t)( NUM_BITS_IN_BYTE - ( m_bitOffset % NUM_BITS_IN_BYTE ) );
+		uint8_t numBitsThisByte = ( numBitsLeft < numBitsFreeInByte ) ? numBitsLeft : numBitsFreeInByte;
+		uint8_t shiftWithinByte = numBitsFreeInByte - numBitsThisByte;
+
+		byte_t chunkMask = (byte_t)GetMaxValueForBitWidth( numBitsThisByte );
+		byte_t chunk = (byte_t)( value >> ( numBitsLeft - numBitsThisByte ) ) & chunkMask;
+
+		byte_t& currentByte = m_buffer[ byteIndex ];
+		currentByte = (byte_t)( ( currentByte & ~( chunkMask << shiftWithinByte ) ) | ( chunk << shiftWithinByte ) );
+
+		m_bitOffset += numBitsThisByte;
+		numBitsLeft -= numBitsThisByte;
+	}
+
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool BitPacker::ReadBits( uint32_t* out_value, uint8_t numBits )
+{
+	if ( !CanAccessBits( numBits, BITPACKER_MODE_READ ) )
+		return false; //Ran out of valid written data to read.
+
+	uint32_t value = 0;
+	uint8_t numBitsLeft = numBits;
+	while ( numBitsLeft > 0 )
+	{
+		size_t byteIndex = m_bitOffset / NUM_BITS_IN_BYTE;
+		uint8_t numBitsFreeInByte = (uint8_t)( NUM_BITS_IN_BYTE - ( m_bitOffset % NUM_BITS_IN_BYTE ) );
+		uint8_t numBitsThisByte = ( numBitsLeft < numBitsFreeInByte ) ? numBitsLeft : numBitsFreeInByte;
+		uint8_t shiftWithinByte = numBitsFreeInByte - numBitsThisByte;
+
+		byte_t chunkMask = (byte_t)GetMaxValueForBitWidth( numBitsThisByte );
+		byte_t chunk = ( m_buffer[ byteIndex ] >> shiftWithinByte ) & chunkMask;
+
+		value = ( value << numBitsThisByte ) | chunk;
+
+		m_bitOffset += numBitsThisByte;
+		numBitsLeft -= numBitsThisByte;
+	}
+
+	*out_value = value;
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool BitPacker::ReadBool( bool* out_value )
+{
+	uint32_t bit;
+	if ( !ReadBits( &bit, 1 ) )
+		return false;
+
+	*out_value = ( bit != 0 );
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool BitPacker::WriteBitsFromBuffer( const void* srcBuffer, size_t numBits )
+{
+	if ( numBits > GetRemainingBits() )
+		return false; //Check up front so we never leave a partial copy behind.
+
+	size_t numSrcBytes = ( numBits + NUM_BITS_IN_BYTE - 1 ) / NUM_BITS_IN_BYTE;
+	BitPacker srcBits( const_cast<void*>( srcBuffer ), numSrcBytes, BITPACKER_MODE_READ );
+
+	size_t numBitsLeft = numBits;
+	while ( numBitsLeft > 0 )
+	{
+		uint8_t numBitsThisChunk = (uint8_t)( ( numBitsLeft < MAX_BITS_PER_WRITE ) ? numBitsLeft : MAX_BITS_PER_WRITE );
+
+		uint32_t chunk;
+		srcBits.ReadBits( &chunk, numBitsThisChunk );
+		WriteBits( chunk, numBitsThisChunk );
+
+		numBitsLeft -= numBitsThisChunk;
+	}
+
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool BitPacker::SkipBits( size_t numBits )
+{
+	if ( ( m_mode != BITPACKER_MODE_READ ) || ( numBits > GetRemainingBits() ) )
+		return false;
+
+	m_bitOffset += numBits;
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool BitPacker::WriteVarUint( uint32_t value )
+{
+	//Lowest group first, each group's top bit says whether another follows.
+	do
+	{
+		uint32_t group = value & 0x7F;
+		value >>= 7;
+		if ( value != 0 )
+			group |= 0x80;
+
+		if ( !WriteBits( group, NUM_BITS_IN_BYTE ) )
+			return false;
+	} while ( value != 0 );
+
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool BitPacker::ReadVarUint( uint32_t* out_value )
+{
+	uint32_t value = 0;
+	for ( int groupIndex = 0; groupIndex < MAX_VARUINT_BYTES; groupIndex++ )
+	{
+		uint32_t group;
+		if ( !ReadBits( &group, NUM_BITS_IN_BYTE ) )
+			return false;
+
+		value |= ( group & 0x7F ) << ( 7 * groupIndex );
+		if ( ( group & 0x80 ) == 0 )
+		{
+			*out_value = value;
+			return true;
+		}
+	}
+
+	return false; //Malformed, the continue bit never cleared.
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+STATIC size_t BitPacker::GetVarUintSize( uint32_t value )
+{
+	size_t numBytes = 1;
+	while ( value >= 0x80 )
+	{
+		value >>= 7;
+		++numBytes;
+	}
+	return numBytes;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool BitPacker::WriteQuantizedFloat( float value, float minValue, float maxValue, uint8_t numBits )
+{
+	double range = (double)maxValue - (double)minValue;
+	double normalized = ( range > 0.0 ) ? ( ( Clamp( value, minValue, maxValue ) - (double)minValue ) / range ) : 0.0;
+
+	uint32_t quantized = (uint32_t)( ( normalized * GetMaxValueForBitWidth( numBits ) ) + .5 ); //Round to the nearest step.
+	return WriteBits( quantized, numBits );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool BitPacker::ReadQuantizedFloat( float* out_value, float minValue, float maxValue, uint8_t numBits )
+{
+	uint32_t quantized;
+	if ( !ReadBits( &quantized, numBits ) )
+		return false;
+
+	double normalized = (double)quantized / (double)GetMaxValueForBitWidth( numBits );
+	*out_value = (float)( minValue + ( normalized * ( (double)maxValue - (double)minValue ) ) );
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool BitPacker::WriteQuantizedVector2f( const Vector2f& value, const Vector2f& mins, const Vector2f& maxs, uint8_t numBitsPerComponent )
+{
+	bool success = WriteQuantizedFloat( value.x, mins.x, maxs.x, numBitsPerComponent );
+	if ( !success )
+		return false;
+
+	success = WriteQuantizedFloat( value.y, mins.y, maxs.y, numBitsPerComponent );
+	return success;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool BitPacker::ReadQuantizedVector2f( Vector2f* out_value, const Vector2f& mins, const Vector2f& maxs, uint8_t numBitsPerComponent )
+{
+	bool success = ReadQuantizedFloat( &out_value->x, mins.x, maxs.x, numBitsPerComponent );
+	if ( !success )
+		return false;
+
+	success = ReadQuantizedFloat( &out_value->y, mins.y, maxs.y, numBitsPerComponent );
+	return success;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+
+#include "Engine/Memory/BytePacker.hpp"
+#include "Engine/Memory/BitUtils.hpp"
+
+
+//-----------------------------------------------------------------------------
+#define MAX_BITS_PER_WRITE (32)
+#define MAX_VARUINT_BYTES (5) //A uint32_t split into 7-bit groups needs at most ceil( 32 / 7 ) of them.
+
+
+//-----------------------------------------------------------------------------
+enum BitPackerMode
+{
+	BITPACKER_MODE_WRITE,
+	BITPACKER_MODE_READ
+};
+
+
+//-----------------------------------------------------------------------------
+class BitPacker //Packs values at arbitrary bit widths, most significant bit first, so there's no endianness to reconcile like BytePacker.
+{
+public:
+	BitPacker( void* buffer, size_t bufferSizeBytes, BitPackerMode mode );
+	BitPacker( const BytePacker& byteStream, BitPackerMode mode ); //Starts at its I/O head. Call FinishOnto() with it when done.
+
+	size_t GetNumBitsUsed() const { return m_bitOffset; }
+	size_t GetNumBytesUsed() const { return ( m_bitOffset + NUM_BITS_IN_BYTE - 1 ) / NUM_BITS_IN_BYTE; } //Includes any partial last byte.
+	size_t GetRemainingBits() const { return ( m_bufferSizeBytes * NUM_BITS_IN_BYTE ) - m_bitOffset; }
+	void FinishOnto( const BytePacker& byteStream ) const { byteStream.AdvanceOffset( GetNumBytesUsed() ); } //Realigns it to the next whole byte.
+
+	bool WriteBits( uint32_t value, uint8_t numBits ); //Only the low numBits of value are kept.
+	bool ReadBits( uint32_t* out_value, uint8_t numBits );
+	bool WriteBool( bool value ) { return WriteBits( value ? 1 : 0, 1 ); }
+	bool ReadBool( bool* out_value );
+	bool WriteBitsFromBuffer( const void* srcBuffer, size_t numBits ); //e.g. Splicing in what another BitPacker wrote, without realigning it to a byte.
+	bool SkipBits( size_t numBits ); //Reading only, e.g. past a length-prefixed field we can't or won't parse.
+
+	bool WriteVarUint( uint32_t value ); //7 bits per byte-sized group plus a continue bit, i.e. values under 128 take one byte.
+	bool ReadVarUint( uint32_t* out_value );
+	static size_t GetVarUintSize( uint32_t value ); //In bytes, for budgeting space before writing.
+
+	//Quantized values are clamped into [min, max], then mapped onto the 2^numBits evenly spaced steps across it.
+	bool WriteQuantizedFloat( float value, float minValue, float maxValue, uint8_t numBits );
+	bool ReadQuantizedFloat( float* out_value, float minValue, float maxValue, uint8_t numBits );
+	bool WriteQuantizedVector2f( const Vector2f& value, const Vector2f& mins, const Vector2f& maxs, uint8_t numBitsPerComponent );
+	bool ReadQuantizedVector2f( Vector2f* out_value, const Vector2f& mins, const Vector2f& maxs, uint8_t numBitsPerComponent );
+
+
+private:
+	bool CanAccessBits( uint8_t numBits, BitPackerMode mode ) const;
+
+	byte_t* m_buffer;
+	size_t m_bufferSizeBytes;
+	BitPackerMode m_mode;
+	size_t m_bitOffset; //Where I'm currently writing or reading the buffer, in bits from its start.
+};
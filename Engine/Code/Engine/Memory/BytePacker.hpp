@@ -28,6 +28,7 @@ public:
 	byte_t* GetIoHead() const { return m_buffer + m_ioOffset; }
 	
 	size_t GetWritableBytes() const { return GetTotalWritableBytes() - m_ioOffset; } //How much is left to write to.
+	size_t GetReadableBytes() const { return ( m_maxReadSize > m_ioOffset ) ? ( m_maxReadSize - m_ioOffset ) : 0; } //How much is left to read.
 	
 	size_t GetTotalReadableBytes() const { return GetMax( m_ioOffset, m_maxReadSize ); } //Ensure maxReadSize updates on write!
 	size_t GetTotalWritableBytes() const { return m_maxWriteSize; }
@@ -51,6 +52,7 @@ public:
 	void SetBuffer( void* buffer ) { m_buffer = (byte_t*)buffer; }
 	void AdvanceOffset( size_t delta ) const { m_ioOffset += delta; }
 	void SetTotalReadableBytes( size_t newReadHead ) { m_maxReadSize = newReadHead; }
+	void SetTotalWritableBytes( size_t newWriteLimit ) { m_maxWriteSize = newWriteLimit; } //e.g. 0 to make it read-only.
 	void ResetOffset( size_t newIoHeadPosition = 0 ) const { m_ioOffset = newIoHeadPosition; }
 
 private:
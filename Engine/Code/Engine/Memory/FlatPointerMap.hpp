@@ -0,0 +1,139 @@
+#pragma once
+
+
+#include <stdint.h>
+#include <vector>
+
+
+//-----------------------------------------------------------------------------
+template < typename ValueType >
+class FlatPointerMap //Open-addressed, linear-probed map from pointers, all in one array, so a lookup is usually a single cache miss instead of a tree walk.
+{
+public:
+	FlatPointerMap() : m_numEntries( 0 ) {}
+
+	bool Insert( const void* key, const ValueType& value ); //False if already present, in which case the old value stays.
+	bool Find( const void* key, ValueType& out_value ) const;
+	bool Erase( const void* key );
+	void Clear() { m_entries.clear(); m_numEntries = 0; }
+	size_t Size() const { return m_numEntries; }
+
+
+private:
+	struct Entry
+	{
+		const void* key; //nullptr marks an empty entry, so nullptr can't be a key.
+		ValueType value;
+	};
+
+	size_t GetHomeIndex( const void* key ) const;
+	size_t FindIndex( const void* key ) const; //m_entries.size() if absent.
+	void Grow();
+
+	std::vector< Entry > m_entries; //Power of two in size, at most half full, so probe runs stay short.
+	size_t m_numEntries;
+};
+
+
+//--------------------------------------------------------------------------------------------------------------
+template < typename ValueType > size_t FlatPointerMap<ValueType>::GetHomeIndex( const void* key ) const
+{
+	uint64_t hash = (uint64_t)(uintptr_t)key; //Allocations are aligned, so mix the high bits down before masking off the low ones.
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	return (size_t)hash & ( m_entries.size() - 1 );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+template < typename ValueType > size_t FlatPointerMap<ValueType>::FindIndex( const void* key ) const
+{
+	if ( m_entries.empty() || ( key == nullptr ) )
+		return m_entries.size();
+
+	const size_t mask = m_entries.size() - 1;
+	for ( size_t index = GetHomeIndex( key ); m_entries[ index ].key != nullptr; index = ( index + 1 ) & mask )
+		if ( m_entries[ index ].key == key )
+			return index;
+
+	return m_entries.size(); //Hit an empty entry, which never being full guarantees.
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+template < typename ValueType > bool FlatPointerMap<ValueType>::Insert( const void* key, const ValueType& value )
+{
+	if ( key == nullptr )
+		return false;
+
+	if ( ( ( m_numEntries + 1 ) * 2 ) > m_entries.size() )
+		Grow();
+
+	const size_t mask = m_entries.size() - 1;
+	size_t index = GetHomeIndex( key );
+	for ( ; m_entries[ index ].key != nullptr; index = ( index + 1 ) & mask )
+		if ( m_entries[ index ].key == key )
+			return false;
+
+	m_entries[ index ].key = key;
+	m_entries[ index ].value = value;
+	++m_numEntries;
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+template < typename ValueType > bool FlatPointerMap<ValueType>::Find( const void* key, ValueType& out_value ) const
+{
+	size_t index = FindIndex( key );
+	if ( index == m_entries.size() )
+		return false;
+
+	out_value = m_entries[ index ].value;
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+template < typename ValueType > bool FlatPointerMap<ValueType>::Erase( const void* key )
+{
+	size_t hole = FindIndex( key );
+	if ( hole == m_entries.size() )
+		return false;
+
+	//Shift later entries of the probe run back into the hole, rather than leave a tombstone that slows every later lookup.
+	const size_t mask = m_entries.size() - 1;
+	for ( size_t next = ( hole + 1 ) & mask; m_entries[ next ].key != nullptr; next = ( next + 1 ) & mask )
+	{
+		size_t home = GetHomeIndex( m_entries[ next ].key );
+		bool isHomeBetween = ( hole <= next ) ? ( ( hole < home ) && ( home <= next ) ) : ( ( hole < home ) || ( home <= next ) );
+		if ( isHomeBetween )
+			continue; //Moving it before its home would hide it from FindIndex.
+
+		m_entries[ hole ] = m_entries[ next ];
+		hole = next;
+	}
+
+	m_entries[ hole ].key = nullptr;
+	--m_numEntries;
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+template < typename ValueType > void FlatPointerMap<ValueType>::Grow()
+{
+	std::vector< Entry > oldEntries;
+	oldEntries.swap( m_entries );
+
+	Entry emptyEntry;
+	emptyEntry.key = nullptr;
+	emptyEntry.value = ValueType();
+	m_entries.resize( oldEntries.empty() ? 16 : ( oldEntries.size() * 2 ), emptyEntry );
+	m_numEntries = 0;
+
+	for each ( const Entry& entry in oldEntries )
+		if ( entry.key != nullptr )
+			Insert( entry.key, entry.value );
+}
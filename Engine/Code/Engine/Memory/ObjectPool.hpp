@@ -4,6 +4,7 @@
 #include "Engine/Memory/PageAllocator.hpp"
 #include "Engine/Error/ErrorWarningAssert.hpp"
 #include "Engine/Concurrency/CriticalSection.hpp"
+#include <utility>
 #pragma warning ( disable : 4127 ) //Constant conditional in ASSERT_OR_DIE below (after template instantiation).
 
 
@@ -17,7 +18,7 @@ class ObjectPool
 {
 public:
 	void Init( const size_t numObjectsPerBlock ); //Note that init is called at start to kick off the ObjectPool, not what we alloc from per object--that's alloc().
-	TypeAllocated* Allocate();
+	template < typename... ConstructorArgs > TypeAllocated* Allocate( ConstructorArgs&&... args ); //Forwarded to the ctor, e.g. none for the default one.
 	void Delete( TypeAllocated* ptr );
 
 
@@ -55,11 +56,11 @@ template < typename TypeAllocated > void ObjectPool<TypeAllocated>::Init( const
 
 
 //--------------------------------------------------------------------------------------------------------------
-template < typename TypeAllocated > TypeAllocated* ObjectPool<TypeAllocated>::Allocate()
+template < typename TypeAllocated > template < typename... ConstructorArgs > TypeAllocated* ObjectPool<TypeAllocated>::Allocate( ConstructorArgs&&... args )
 {
 	TypeAllocated* newObj = (TypeAllocated*)m_freePagesStack;
 	m_freePagesStack = m_freePagesStack->next;
-	new ( newObj ) TypeAllocated();
+	new ( newObj ) TypeAllocated( std::forward<ConstructorArgs>( args )... );
 
 	return newObj;
 }
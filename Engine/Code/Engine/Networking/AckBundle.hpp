@@ -1,11 +1,14 @@
 #pragma once
 #include <vector>
 #include "Engine/EngineCommon.hpp"
+#include "Engine/Memory/BitUtils.hpp"
 
 
 //--------------------------------------------------------------------------------------------------------------
 #define INVALID_PACKET_ACK (0xFFFF) //"-1" for uint16 => 65535.
 #define MAX_RELIABLES_PER_PACKET (32)
+typedef uint32_t AckBitfield; //Wider means a reliable's packet can be confirmed by more of the packets after it, so fewer needless resends under loss.
+#define NUM_PREVIOUS_ACKS_IN_BITFIELD ( sizeof( AckBitfield ) * NUM_BITS_IN_BYTE )
 
 
 //-----------------------------------------------------------------------------
@@ -14,9 +17,12 @@ struct AckBundle //Whatever information we need to remember about a reliably sen
 	//WARNING: These are only for locally tracking packet IDs, i.e. unlike msg reliableIDs they aren't sent.
 		//(How acks ARE sent is through the PacketHeader class.)
 
-	AckBundle() : ackID( INVALID_PACKET_ACK ) {}
+	AckBundle() : ackID( INVALID_PACKET_ACK ), sentTimeSeconds( 0.0 ) {}
 	uint16_t ackID; //Which sent packet this is associated with. 
 		//This goes up to 65535, then back to 0, so you may skip one every so often (~per 5min) but that's fine.
+		//Also the tag telling whether the bundle at ack % MAX_ACK_BUNDLES is still this ack's, or was recycled or already confirmed.
+
+	double sentTimeSeconds; //Sampled against when its ack comes back, for NetConnection's round trip time estimate.
 
 	uint16_t sentReliableIDs[ MAX_RELIABLES_PER_PACKET ]; //Describes which reliables were sent with this ack.
 	uint32_t numReliableIDsSent;
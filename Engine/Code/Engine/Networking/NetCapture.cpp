@@ -0,0 +1,182 @@
+#include "Engine/Networking/NetCapture.hpp"
+
+
+#include "Engine/FileUtils/FileUtils.hpp"
+#include "Engine/FileUtils/Readers/BinaryReader.hpp"
+#include "Engine/Time/Time.hpp"
+
+
+//-----------------------------------------------------------------------------
+class CaptureBufferReader : public BinaryReader //Reads a capture already in memory, so NetSession::ReplayCapture never waits on disk.
+{
+public:
+	CaptureBufferReader( const std::vector< unsigned char >& buffer ) : m_buffer( buffer ), m_offset( 0 ) {}
+	virtual size_t ReadBytes( void* out_value, const size_t numBytes ) override
+	{
+		if ( numBytes > GetRemainingBytes() )
+			return 0;
+
+		memcpy( out_value, &m_buffer[ m_offset ], numBytes );
+		m_offset += numBytes;
+		return numBytes;
+	}
+	bool Skip( size_t numBytes )
+	{
+		if ( numBytes > GetRemainingBytes() )
+			return false;
+
+		m_offset += numBytes;
+		return true;
+	}
+	size_t GetOffset() const { return m_offset; }
+	size_t GetRemainingBytes() const { return m_buffer.size() - m_offset; }
+
+
+private:
+	const std::vector< unsigned char >& m_buffer;
+	size_t m_offset;
+};
+
+
+//--------------------------------------------------------------------------------------------------------------
+static bool ReadAddress( CaptureBufferReader& reader, sockaddr_in* out_addr )
+{
+	memset( out_addr, 0, sizeof( sockaddr_in ) );
+	out_addr->sin_family = AF_INET;
+	return reader.Read<ULONG>( &out_addr->sin_addr.S_un.S_addr ) && reader.Read<USHORT>( &out_addr->sin_port ); //Both kept in network order.
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool NetCapture::OpenForWriting( const char* filename, const sockaddr_in& sessionAddr, uint16_t numAllowedConnections )
+{
+	if ( m_isWriting || !m_writer.open( filename ) )
+		return false;
+
+	m_isWriting = true;
+	m_captureStartSeconds = GetCurrentTimeSeconds();
+
+	m_writer.Write<uint32_t>( NETCAPTURE_MAGIC );
+	m_writer.Write<uint16_t>( NETCAPTURE_VERSION );
+	WriteAddress( sessionAddr );
+	m_writer.Write<uint16_t>( numAllowedConnections );
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetCapture::Close()
+{
+	if ( !m_isWriting )
+		return;
+
+	m_writer.close();
+	m_isWriting = false;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetCapture::WriteRecordHeader( NetCaptureRecordType recordType )
+{
+	m_writer.Write<uint8_t>( recordType );
+	m_writer.Write<double>( GetCurrentTimeSeconds() - m_captureStartSeconds );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetCapture::WriteAddress( const sockaddr_in& addr )
+{
+	m_writer.Write<ULONG>( addr.sin_addr.S_un.S_addr );
+	m_writer.Write<USHORT>( addr.sin_port );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetCapture::WritePacket( NetCaptureRecordType packetRecordType, const sockaddr_in& addr, const void* data, size_t numBytes )
+{
+	WriteRecordHeader( packetRecordType );
+	WriteAddress( addr );
+	m_writer.Write<uint16_t>( (uint16_t)numBytes ); //Datagrams never exceed MAX_PACKET_SIZE.
+	m_writer.WriteBytes( data, numBytes );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetCapture::WriteHost( const char* username )
+{
+	WriteRecordHeader( NETCAPTURE_RECORD_HOST );
+	m_writer.WriteString( username );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetCapture::WriteJoin( const char* username, const sockaddr_in& hostAddr )
+{
+	WriteRecordHeader( NETCAPTURE_RECORD_JOIN );
+	m_writer.WriteString( username );
+	WriteAddress( hostAddr );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetCapture::WriteRecord( NetCaptureRecordType recordType )
+{
+	WriteRecordHeader( recordType );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool NetCapture::LoadFromFile( const char* filename )
+{
+	m_records.clear();
+	if ( !LoadBinaryFileIntoBuffer( filename, m_fileBuffer ) )
+		return false;
+
+	CaptureBufferReader reader( m_fileBuffer );
+
+	uint32_t magic;
+	uint16_t version;
+	if ( !reader.Read<uint32_t>( &magic ) || ( magic != NETCAPTURE_MAGIC ) || !reader.Read<uint16_t>( &version ) || ( version != NETCAPTURE_VERSION ) )
+		return false;
+
+	if ( !ReadAddress( reader, &m_sessionAddr ) || !reader.Read<uint16_t>( &m_numAllowedConnections ) )
+		return false;
+
+	while ( reader.GetRemainingBytes() > 0 )
+	{
+		NetCaptureRecord record;
+		record.payloadOffset = 0;
+		record.payloadSize = 0;
+
+		uint8_t recordType;
+		if ( !reader.Read<uint8_t>( &recordType ) || ( recordType >= NUM_NETCAPTURE_RECORD_TYPES ) || !reader.Read<double>( &record.secondsSinceCaptureStart ) )
+			break;
+		record.type = (NetCaptureRecordType)recordType;
+
+		bool success = true;
+		switch ( record.type )
+		{
+		case NETCAPTURE_RECORD_PACKET_RECEIVED:
+		case NETCAPTURE_RECORD_PACKET_SENT:
+			success = ReadAddress( reader, &record.addr ) && reader.Read<uint16_t>( &record.payloadSize );
+			record.payloadOffset = reader.GetOffset();
+			success = success && reader.Skip( record.payloadSize );
+			break;
+		case NETCAPTURE_RECORD_HOST:
+			success = reader.ReadString( record.username );
+			break;
+		case NETCAPTURE_RECORD_JOIN:
+			success = reader.ReadString( record.username ) && ReadAddress( reader, &record.addr );
+			break;
+		default:
+			break; //Nothing past the header.
+		}
+
+		if ( !success )
+			break; //Truncated, e.g. the game didn't get to close the capture. Keep every whole record before it.
+
+		m_records.push_back( record );
+	}
+
+	return true;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+
+#include "Engine/Networking/NetSystem.hpp"
+#include "Engine/FileUtils/Writers/FileBinaryWriter.hpp"
+#include <string>
+#include <vector>
+
+
+//-----------------------------------------------------------------------------
+#define NETCAPTURE_MAGIC (0x5041434E) //"NCAP", as it reads in a little-endian file.
+#define NETCAPTURE_VERSION (2) //2: PacketHeader::highestReceivedAckHoldMilliseconds.
+
+
+//-----------------------------------------------------------------------------
+enum NetCaptureRecordType : uint8_t
+{
+	NETCAPTURE_RECORD_PACKET_RECEIVED,
+	NETCAPTURE_RECORD_PACKET_SENT,
+	NETCAPTURE_RECORD_HOST, //The session's own calls, so a replay ends up in the same states the captured session did.
+	NETCAPTURE_RECORD_JOIN,
+	NETCAPTURE_RECORD_LEAVE,
+	NETCAPTURE_RECORD_START_LISTENING,
+	NETCAPTURE_RECORD_STOP_LISTENING,
+	NUM_NETCAPTURE_RECORD_TYPES
+};
+
+
+//-----------------------------------------------------------------------------
+struct NetCaptureRecord
+{
+	NetCaptureRecordType type;
+	double secondsSinceCaptureStart;
+	sockaddr_in addr; //Packets: who from or to. Joins: the host.
+	std::string username; //Hosts and joins.
+	size_t payloadOffset; //Packets: into NetCapture::m_fileBuffer.
+	uint16_t payloadSize;
+};
+
+
+//-----------------------------------------------------------------------------
+struct NetCaptureReplayStats
+{
+	NetCaptureReplayStats() : numPacketsReplayed( 0 ), numPacketsRejected( 0 ), numPacketsSkipped( 0 ), numBytesReplayed( 0 ), replaySeconds( 0.0 ), capturedSeconds( 0.0 ) {}
+	int numPacketsReplayed;
+	int numPacketsRejected; //TryProcessPacket refused them, e.g. for a connection the replay never saw join.
+	int numPacketsSkipped; //Ones the captured session sent, replaying only feeds it what it received.
+	size_t numBytesReplayed;
+	double replaySeconds; //Spent in the replayed calls only, not loading the file.
+	double capturedSeconds; //Between the first and last record when captured.
+};
+
+
+//-----------------------------------------------------------------------------
+class NetCapture //Every datagram in and out of a NetSession, timestamped, cf. NetSession::StartCapture and NetSession::ReplayCapture.
+{
+public:
+	NetCapture() : m_isWriting( false ), m_captureStartSeconds( 0.0 ), m_numAllowedConnections( 0 ) {}
+
+	//Writing, as a session runs.
+	bool OpenForWriting( const char* filename, const sockaddr_in& sessionAddr, uint16_t numAllowedConnections );
+	void Close();
+	bool IsWriting() const { return m_isWriting; }
+	void WritePacket( NetCaptureRecordType packetRecordType, const sockaddr_in& addr, const void* data, size_t numBytes );
+	void WriteHost( const char* username );
+	void WriteJoin( const char* username, const sockaddr_in& hostAddr );
+	void WriteRecord( NetCaptureRecordType recordType ); //For the ones with nothing past the header, e.g. NETCAPTURE_RECORD_LEAVE.
+
+	//Reading, all up front.
+	bool LoadFromFile( const char* filename );
+	const sockaddr_in& GetSessionAddress() const { return m_sessionAddr; }
+	uint16_t GetNumAllowedConnections() const { return m_numAllowedConnections; }
+	const std::vector< NetCaptureRecord >& GetRecords() const { return m_records; }
+	const unsigned char* GetPayload( const NetCaptureRecord& record ) const { return m_fileBuffer.data() + record.payloadOffset; } //Not [], an empty last payload sits one past the end.
+
+
+private:
+	void WriteRecordHeader( NetCaptureRecordType recordType );
+	void WriteAddress( const sockaddr_in& addr );
+
+	FileBinaryWriter m_writer;
+	bool m_isWriting;
+	double m_captureStartSeconds;
+
+	sockaddr_in m_sessionAddr; //The capturing session's own socket, so NetConnection::IsMe holds on replay.
+	uint16_t m_numAllowedConnections;
+	std::vector< unsigned char > m_fileBuffer;
+	std::vector< NetCaptureRecord > m_records;
+};
@@ -3,12 +3,11 @@
 #include "Engine/Networking/NetPacket.hpp"
 #include "Engine/Memory/BitUtils.hpp"
 #include "Engine/Time/Time.hpp"
+#include <algorithm>
 
 
 //--------------------------------------------------------------------------------------------------------------
-#define MAX_UNRELIABLES		(10000)
-#define MAX_RELIABLES		(10000)
-#define MAX_VALID_OFFSET	( sizeof(uint16_t) * NUM_BITS_IN_BYTE ) //2 * 8.
+#define MAX_VALID_OFFSET	( NUM_PREVIOUS_ACKS_IN_BITFIELD ) //4 * 8.
 
 
 
@@ -28,12 +27,34 @@ NetConnection::NetConnection( NetSession* ns, NetConnectionIndex index, const ch
 	, m_secondsSinceLastSend( -1.0 )
 	, m_lastRecvTimeSeconds( GetCurrentTimeSeconds() )
 	, m_lastSendTimeSeconds( GetCurrentTimeSeconds() )
+	, m_smoothedRTTSeconds( -1.0 )
+	, m_rttVarianceSeconds( 0.0 )
+	, m_resendTimeoutSeconds( INITIAL_RESEND_TIMEOUT_SECONDS )
+	, m_lowestRTTSeconds( -1.0 )
+	, m_sendRateHz( MAX_SEND_RATE_HZ )
+	, m_secondsUntilNextTick( DEFAULT_TICK_RATE_SECONDS * ( ( index % ns->GetNumAllowedConnections() ) / (float)ns->GetNumAllowedConnections() ) ) //Pacing.
+	, m_secondsSinceLastTick( 0.f )
+	, m_secondsBetweenLastTicks( 0.f )
+	, m_congestionSampleStartSeconds( GetCurrentTimeSeconds() )
+	, m_numPacketsReceivedThisSample( 0 )
+	, m_numPacketsAckedThisSample( 0 )
+	, m_numPacketsLostThisSample( 0 )
+	, m_measuredLossRate( 0.f )
+	, m_nextAckToJudge( 0 )
+	, m_highestReceivedAckSeconds( GetCurrentTimeSeconds() )
+	, m_numReliablesResent( 0 )
+	, m_nextUnsentUnreliableIndex( 0 )
+	, m_hasConstructedPacket( false )
 {
+	memset( m_streamCreditBytes, 0, sizeof( m_streamCreditBytes ) );
+	m_unflushedSentTallies.reserve( UINT8_MAX ); //A packet's message count is a uint8_t.
+	m_confirmedReliablesToDelete.reserve( RELIABLE_WINDOW_SIZE ); //All of m_sentReliables at most.
 	m_connectionInfo.address = addr;
 	m_connectionInfo.connectionIndex = index;
 	for ( int i = 0; i < MAX_GUID_LENGTH; i++ ) m_connectionInfo.guid[ i ] = guid[ i ];
 	m_unreliablesPool.Init( MAX_UNRELIABLES );
 	m_reliablesPool.Init( MAX_RELIABLES );
+	m_outOfOrderReceivedPool.Init( MAX_INORDER_CHANNELS * INORDER_CHANNEL_WINDOW_SIZE );
 
 	m_connectionState = ( IsMe() ? CONNECTION_STATE_LOCAL : CONNECTION_STATE_UNCONFIRMED );
 }
@@ -49,39 +70,231 @@ bool NetConnection::IsMe() const
 
 
 //--------------------------------------------------------------------------------------------------------------
-void NetConnection::QueueUnreliable( NetMessage& msg )
+NetMessage* NetConnection::CloneForQueue( ObjectPool< NetMessage >& pool, const NetMessage& msg, SharedNetMessagePayload* sharedPayload )
 {
-	NetMessage* out_cloneMsg = m_unreliablesPool.Allocate(); //May potentially run out of allocator blocks.
+	//May potentially run out of allocator blocks.
+	if ( sharedPayload != nullptr )
+		return pool.Allocate( msg, sharedPayload ); //Header only, the payload was already serialized once for everyone.
+
+	NetMessage* out_cloneMsg = pool.Allocate();
 	NetMessage::Duplicate( msg, *out_cloneMsg );
+	return out_cloneMsg;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetConnection::QueueUnreliable( NetMessage& msg, SharedNetMessagePayload* sharedPayload )
+{
+	NetMessage* out_cloneMsg = CloneForQueue( m_unreliablesPool, msg, sharedPayload );
+
+	if ( msg.IsReplaceable() )
+	{
+		uint64_t streamKey = ( (uint64_t)msg.GetTypeID() << 32 ) | msg.GetReplacementKey();
+		auto foundIter = m_unsentReplaceableIndices.find( streamKey );
+		if ( foundIter != m_unsentReplaceableIndices.end() )
+		{
+			NetMessage*& staleMsg = m_unsentUnreliables[ foundIter->second ];
+			CountMessageDropped( *staleMsg ); //Superseded, so never sent.
+			m_unreliablesPool.Delete( staleMsg );
+			staleMsg = out_cloneMsg; //Overwritten in place, so the newest state keeps the stale one's spot in line.
+			return;
+		}
+
+		m_unsentReplaceableIndices[ streamKey ] = m_unsentUnreliables.size();
+	}
 
 	m_unsentUnreliables.push_back( out_cloneMsg );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
-void NetConnection::QueueReliable( NetMessage& msg )
+void NetConnection::QueueReliable( NetMessage& msg, SharedNetMessagePayload* sharedPayload )
 {
-	NetMessage* out_cloneMsg = m_reliablesPool.Allocate(); //May potentially run out of allocator blocks.
-	NetMessage::Duplicate( msg, *out_cloneMsg );
+	NetMessage* out_cloneMsg = CloneForQueue( m_reliablesPool, msg, sharedPayload );
+
+	if ( m_unsentReliables.IsFull() )
+	{
+		ERROR_RECOVERABLE( "Ran out of room to queue unsent reliables!" );
+		CountMessageDropped( *out_cloneMsg );
+		m_reliablesPool.Delete( out_cloneMsg );
+		return;
+	}
 
 	if ( msg.IsInOrder() )
-		out_cloneMsg->SetSequenceID( m_channelData.GetNextSequenceIDToSend() );
+		out_cloneMsg->SetSequenceID( m_channels[ msg.GetInOrderChannel() ].GetNextSequenceIDToSend() );
 
-	m_unsentReliables.push( out_cloneMsg );
+	m_unsentReliables.Push( out_cloneMsg );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
-void NetConnection::SendMessageToThem( NetMessage& msg )
+void NetConnection::SendMessageToThem( NetMessage& msg, SharedNetMessagePayload* sharedPayload /*= nullptr*/ )
 {
 	bool foundDefn = msg.FinalizeMessageDefinition( m_session );
 	if ( !foundDefn )
 		return; //Throw out the handler-less message. Above reroute to SendMessageDirect resolves edge case of having 1 thrown-out message hit SendTo below.
 
+	if ( msg.GetPayloadSize() > MAX_MESSAGE_SIZE )
+	{
+		SendFragmentsToThem( msg ); //Too big for our queues' NetMessages, let alone a packet.
+		return;
+	}
+
 	if ( msg.IsReliable() )
-		QueueReliable( msg );
+		QueueReliable( msg, sharedPayload );
 	else
-		QueueUnreliable( msg );
+		QueueUnreliable( msg, sharedPayload );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetConnection::SendFragmentsToThem( NetMessage& msg )
+{
+	if ( !msg.IsReliable() )
+	{
+		ERROR_RECOVERABLE( "Only reliable messages get fragmented, dropping an unreliable one over MAX_MESSAGE_SIZE!" );
+		return;
+	}
+
+	size_t payloadSize = msg.GetPayloadSize();
+	if ( payloadSize > MAX_FRAGMENTED_MESSAGE_SIZE )
+	{
+		ERROR_RECOVERABLE( Stringf( "Dropping %s, its %u bytes exceed MAX_FRAGMENTED_MESSAGE_SIZE!", msg.GetMessageDefinition().debugName, (unsigned int)payloadSize ) );
+		return;
+	}
+
+	//Each fragment is an ordinary reliable in-order message, so resending and ordering them comes for free.
+	uint16_t numFragments = (uint16_t)( ( payloadSize + MAX_FRAGMENT_CHUNK_SIZE - 1 ) / MAX_FRAGMENT_CHUNK_SIZE );
+	for ( uint16_t fragmentIndex = 0; fragmentIndex < numFragments; fragmentIndex++ )
+	{
+		size_t chunkOffset = fragmentIndex * MAX_FRAGMENT_CHUNK_SIZE;
+		size_t chunkSize = GetMin( MAX_FRAGMENT_CHUNK_SIZE, payloadSize - chunkOffset );
+
+		NetMessage fragmentMsg( NETMSG_FRAGMENT );
+		fragmentMsg.Write<uint8_t>( msg.GetTypeID() );
+		fragmentMsg.Write<uint16_t>( fragmentIndex );
+		fragmentMsg.Write<uint16_t>( numFragments );
+		fragmentMsg.WriteForwardAlongBuffer( msg.GetBuffer() + chunkOffset, chunkSize );
+
+		SendMessageToThem( fragmentMsg );
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetConnection::ReceiveFragment( const NetSender& from, NetMessage& fragmentMsg )
+{
+	uint8_t msgTypeID;
+	uint16_t fragmentIndex;
+	uint16_t numFragments;
+	bool successfulRead = fragmentMsg.Read<uint8_t>( &msgTypeID )
+		&& fragmentMsg.Read<uint16_t>( &fragmentIndex )
+		&& fragmentMsg.Read<uint16_t>( &numFragments );
+	if ( !successfulRead || ( numFragments == 0 ) ) //Off the wire, so log and drop rather than stop on a dialog.
+	{
+		LogAndShowPrintfWithTag( "NetConnection", "Dropped a malformed fragment header from %s.", GetGuidString().c_str() );
+		return;
+	}
+
+	FragmentReassemblyData& reassembly = m_fragmentReassembly;
+	if ( fragmentIndex == 0 )
+	{
+		if ( reassembly.IsInProgress() )
+			LogAndShowPrintfWithTag( "NetConnection", "Fragmented message from %s began before the last one finished, discarding that one.", GetGuidString().c_str() );
+		reassembly.Reset();
+
+		if ( reassembly.buffer == nullptr )
+			reassembly.buffer = new byte_t[ MAX_FRAGMENTED_MESSAGE_SIZE ];
+		reassembly.msgTypeID = msgTypeID;
+		reassembly.numFragmentsExpected = numFragments;
+	}
+
+	bool isNextFragment = reassembly.IsInProgress() && ( fragmentIndex == reassembly.nextFragmentIndex )
+		&& ( msgTypeID == reassembly.msgTypeID ) && ( numFragments == reassembly.numFragmentsExpected );
+	size_t chunkSize = fragmentMsg.GetReadableBytes();
+	if ( !isNextFragment || ( ( reassembly.numBytesReceived + chunkSize ) > MAX_FRAGMENTED_MESSAGE_SIZE ) )
+	{
+		LogAndShowPrintfWithTag( "NetConnection", "Dropped a fragment from %s that doesn't follow on from the last, or overflows MAX_FRAGMENTED_MESSAGE_SIZE.", GetGuidString().c_str() );
+		reassembly.Reset();
+		return;
+	}
+
+	fragmentMsg.ReadForwardAlongBuffer( reassembly.buffer + reassembly.numBytesReceived, chunkSize );
+	reassembly.numBytesReceived += chunkSize;
+	++reassembly.nextFragmentIndex;
+
+	if ( reassembly.nextFragmentIndex < reassembly.numFragmentsExpected )
+		return;
+
+	//Delivered all at once, handlers never see a partial message. Note it's ordered with other fragmented messages, not its own definition's channel.
+	NetMessage reassembledMsg( reassembly.msgTypeID, (uint16_t)reassembly.numBytesReceived, reassembly.buffer, reassembly.numBytesReceived );
+	reassembly.Reset();
+
+	bool foundDefn = reassembledMsg.FinalizeMessageDefinition( m_session );
+	if ( foundDefn )
+		reassembledMsg.Process( from );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+double NetConnection::GetRemoteTimeSeconds() const
+{
+	return m_clockSync.GetRemoteTimeSeconds( GetCurrentTimeSeconds() );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetConnection::QueueClockSyncMessages()
+{
+	double nowSeconds = GetCurrentTimeSeconds();
+
+	if ( m_clockSync.HasPendingResponse() )
+	{
+		NetMessage responseMsg( NETMSG_CLOCK_SYNC_RESPONSE );
+		responseMsg.Write<double>( m_clockSync.GetPendingRequestSentSeconds() );
+		responseMsg.Write<double>( m_clockSync.GetPendingRequestReceivedSeconds() );
+		responseMsg.Write<double>( nowSeconds );
+		SendMessageToThem( responseMsg );
+		m_clockSync.ClearPendingResponse();
+	}
+
+	if ( IsMe() || !m_session->IsHost( this ) || !m_clockSync.IsRequestDue( nowSeconds ) )
+		return; //Only clients ask, and only the host.
+
+	NetMessage requestMsg( NETMSG_CLOCK_SYNC_REQUEST );
+	requestMsg.Write<double>( nowSeconds );
+	SendMessageToThem( requestMsg );
+	m_clockSync.MarkRequestSent( nowSeconds );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetConnection::ReceiveClockSyncRequest( NetMessage& requestMsg )
+{
+	double requestSentSeconds;
+	if ( requestMsg.Read<double>( &requestSentSeconds ) )
+		m_clockSync.SetPendingResponse( requestSentSeconds, GetCurrentTimeSeconds() );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetConnection::ReceiveClockSyncResponse( NetMessage& responseMsg )
+{
+	double responseReceivedSeconds = GetCurrentTimeSeconds();
+
+	double requestSentSeconds;
+	double requestReceivedSeconds;
+	double responseSentSeconds;
+	bool successfulRead = responseMsg.Read<double>( &requestSentSeconds )
+		&& responseMsg.Read<double>( &requestReceivedSeconds )
+		&& responseMsg.Read<double>( &responseSentSeconds );
+	if ( !successfulRead ) //Off the wire, and the next response will do just as well.
+	{
+		LogAndShowPrintfWithTag( "NetConnection", "Dropped a malformed clock sync response from %s.", GetGuidString().c_str() );
+		return;
+	}
+
+	m_clockSync.AddSample( requestSentSeconds, requestReceivedSeconds, responseSentSeconds, responseReceivedSeconds );
 }
 
 
@@ -95,55 +308,83 @@ void NetConnection::SendMessagesToThem( NetMessage msgs[], int numMessages )
 
 
 //--------------------------------------------------------------------------------------------------------------
-static bool IsMessageStarved( NetMessage* msg )
+static uint32_t GetCurrentTimeMilliseconds()
+{
+	return (uint32_t)( GetCurrentTimeSeconds() * 1000.0 ); //Wraps after ~49 days, fine for the differences we take.
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool NetConnection::IsReliableDueForResend( const NetMessage* msg ) const
 {
-	uint32_t msSinceLastSendAttempt = (uint32_t)GetCurrentTimeSeconds() - msg->GetTimestamp();
+	uint32_t msSinceLastSendAttempt = GetCurrentTimeMilliseconds() - msg->GetTimestamp();
 	
-	const uint32_t millisecondsUntilConsideredStarved = 200U; //.2 seconds for now.
+	uint32_t millisecondsUntilConsideredStarved = (uint32_t)( m_resendTimeoutSeconds * 1000.0 ); //Adapts to the link, cf. UpdateRTTEstimate.
 
 	return ( msSinceLastSendAttempt >= millisecondsUntilConsideredStarved );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
-static bool CanSendAnotherReliable( NetPacket& packet )
+static bool CanSendAnotherReliable( const AckBundle* bundle )
 {
-	//Note this logic only holds when unreliables are known to come after reliables in a packet.
-	return ( ( packet.GetTotalAddedMessages() + 1 ) < MAX_RELIABLES_PER_PACKET );
+	return ( bundle->numReliableIDsSent < MAX_RELIABLES_PER_PACKET ); //Reliables and unreliables interleave now, so count the former directly.
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
-uint8_t NetConnection::ResendSentReliables( NetPacket& packet, AckBundle* bundle )
+static bool FitsInByteBudget( const NetMessage* msg, size_t bytesWritten, size_t maxBytes )
+{
+	return ( ( bytesWritten + msg->GetTotalWireSize() ) <= maxBytes );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+static bool HasHigherMessagePriority( const NetMessage* lhs, const NetMessage* rhs )
+{
+	return lhs->GetPriority() > rhs->GetPriority();
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+uint8_t NetConnection::ResendSentReliables( NetPacket& packet, AckBundle* bundle, size_t maxBytes )
 {
 	//From the queue of reliables we've already sent--"old" reliables.
 	uint8_t numMessagesWritten = 0;
+	size_t bytesWritten = 0;
 
-	while ( !m_sentReliables.empty() && CanSendAnotherReliable( packet ) )
+	size_t numSentToVisit = m_sentReliables.GetSize(); //Resent ones go back on the end, so don't let the loop reach them again.
+	while ( ( numSentToVisit-- > 0 ) && CanSendAnotherReliable( bundle ) )
 	{
-		NetMessage* msg = m_sentReliables.front();
+		NetMessage* msg = m_sentReliables.Front();
 
 		if ( IsReliableConfirmed( msg->GetReliableID() ) )
 		{
-			m_sentReliables.pop();
+			m_sentReliables.Pop();
 
-			m_reliablesPool.Delete( msg ); //Cleanup even though ID's still in bundle.
+			m_confirmedReliablesToDelete.push_back( msg ); //Cleanup even though ID's still in bundle, once back on the main thread.
 				//But we cycle over our array/queue of messages as mentioned above at NetCon::bundles when enough time passes.
 
 			continue;
 		}
 
-		if ( IsMessageStarved( msg ) ) //We determine this based on msg.m_secondsSinceSend! Anti-message starvation safeguard.
+		if ( IsReliableDueForResend( msg ) ) //We determine this based on msg's timestamp! Anti-message starvation safeguard.
 		{
-			m_sentReliables.pop();
+			if ( !FitsInByteBudget( msg, bytesWritten, maxBytes ) || !packet.WriteMessageToBuffer( *msg, m_session ) )
+				break; //Stays at the front, to be first resent once this stream has the room.
+
+			m_sentReliables.Pop();
 
-			msg->SetTimestamp( (uint32_t)GetCurrentTimeSeconds() * 1000U ); 
+			msg->SetTimestamp( GetCurrentTimeMilliseconds() ); 
 			
 			bundle->AddReliable( msg->GetReliableID() ); //Anytime we add a message, add its ID to ackBundle.
 
-			packet.WriteMessageToBuffer( *msg, m_session );
-
+			bytesWritten += msg->GetTotalWireSize();
 			++numMessagesWritten;
+			++m_numReliablesResent;
+			CountMessageSent( *msg, true ); //Also counts into the session's m_numReliablesResent, once flushed.
+
+			m_sentReliables.Push( msg ); //Back of the line, still awaiting confirmation. Always fits, we just popped.
 		}
 		else
 		{
@@ -156,27 +397,30 @@ uint8_t NetConnection::ResendSentReliables( NetPacket& packet, AckBundle* bundle
 
 
 //--------------------------------------------------------------------------------------------------------------
-uint8_t NetConnection::SendUnsentReliables( NetPacket& packet, AckBundle* bundle )
+uint8_t NetConnection::SendUnsentReliables( NetPacket& packet, AckBundle* bundle, size_t maxBytes )
 {
 	uint8_t numMessagesWritten = 0;
+	size_t bytesWritten = 0;
 
-	while ( !m_unsentReliables.empty() && CanSendAnotherReliable( packet ) )
+	while ( !m_unsentReliables.IsEmpty() && CanSendAnotherReliable( bundle ) && HasRoomInReliableWindow() && !m_sentReliables.IsFull() )
 	{
-		NetMessage* msg = m_unsentReliables.front();
-		msg->SetReliableID( GetNextSentReliableID() ); //Increments each Get() call.
+		NetMessage* msg = m_unsentReliables.Front();
+		msg->SetReliableID( m_nextSentReliableID ); //Not consumed until it's written, or the skipped ID would never be confirmed.
 
-		bundle->AddReliable( msg->GetReliableID() );
-
-		bool hadRoomToWrite = packet.WriteMessageToBuffer( *msg, m_session );
+		bool hadRoomToWrite = FitsInByteBudget( msg, bytesWritten, maxBytes ) && packet.WriteMessageToBuffer( *msg, m_session );
 		if ( !hadRoomToWrite )
 			break; //If you want to be more efficient, go over all unsent to see if any will fit.			
 			//i.e. Rather than just break immediately at the first won't-fit instance.
 
+		GetNextSentReliableID(); //Increments each Get() call.
+		bundle->AddReliable( msg->GetReliableID() );
+		bytesWritten += msg->GetTotalWireSize();
 		++numMessagesWritten;
+		CountMessageSent( *msg, false );
 
-		m_unsentReliables.pop();
-		msg->SetTimestamp( (uint32_t)GetCurrentTimeSeconds() * 1000 );
-		m_sentReliables.push( msg );
+		m_unsentReliables.Pop();
+		msg->SetTimestamp( GetCurrentTimeMilliseconds() );
+		m_sentReliables.Push( msg );
 	}
 
 	return numMessagesWritten;
@@ -184,70 +428,262 @@ uint8_t NetConnection::SendUnsentReliables( NetPacket& packet, AckBundle* bundle
 
 
 //--------------------------------------------------------------------------------------------------------------
-uint8_t NetConnection::SendUnreliables( NetPacket& packet )
+uint8_t NetConnection::SendUnreliables( NetPacket& packet, size_t maxBytes )
 {
 	uint8_t numMessagesWritten = 0;
+	size_t bytesWritten = 0;
 
 	TODO( "Compare below to NetSession::SendMessagesDirect from A2 and create a WriteAllMessage to remove repetitions." );
-	for ( unsigned int msgIndex = 0; msgIndex < m_unsentUnreliables.size(); msgIndex++ )
+	for ( ; m_nextUnsentUnreliableIndex < m_unsentUnreliables.size(); m_nextUnsentUnreliableIndex++ )
 	{
-		NetMessage& msg = *m_unsentUnreliables[ msgIndex ];
+		NetMessage& msg = *m_unsentUnreliables[ m_nextUnsentUnreliableIndex ];
 
-		bool hadEnoughRoom = packet.WriteMessageToBuffer( msg, m_session );
+		bool hadEnoughRoom = FitsInByteBudget( &msg, bytesWritten, maxBytes ) && packet.WriteMessageToBuffer( msg, m_session );
 		if ( !hadEnoughRoom ) //sendto and start anew.
-			break; //Unlike SendMessagesDirect, we just drop everything after hitting a packet's MTU. The fate of unreliable traffic.
+			break; //Whatever's left once the packet's assembled gets dropped, cf. DropUnsentUnreliables. The fate of unreliable traffic.
 
+		bytesWritten += msg.GetTotalWireSize();
 		++numMessagesWritten;
+		CountMessageSent( msg, false );
 	}
 
+	return numMessagesWritten;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetConnection::DropUnsentUnreliables()
+{
 	//Dump the rest out, they will have to be SendMessage'd again or won't get sent.
+	for ( size_t msgIndex = m_nextUnsentUnreliableIndex; msgIndex < m_unsentUnreliables.size(); msgIndex++ )
+		CountMessageDropped( *m_unsentUnreliables[ msgIndex ] ); //Those before it made it into the packet.
+
 	for each ( NetMessage* msg in m_unsentUnreliables )
 		m_unreliablesPool.Delete( msg );
 	m_unsentUnreliables.clear();
+	m_unsentReplaceableIndices.clear();
+	m_nextUnsentUnreliableIndex = 0;
+}
 
-	return numMessagesWritten;
+
+//--------------------------------------------------------------------------------------------------------------
+void NetConnection::CountMessageSent( const NetMessage& msg, bool wasResent )
+{
+	m_trafficStats.Add( NETSTAT_MESSAGES_SENT );
+	if ( wasResent )
+		m_trafficStats.Add( NETSTAT_RELIABLES_RESENT );
+
+	SentMessageTally tally = { msg.GetTypeID(), wasResent, (uint32_t)msg.GetTotalWireSize() };
+	m_unflushedSentTallies.push_back( tally );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetConnection::FlushSentMessageTallies()
+{
+	for each ( const SentMessageTally& tally in m_unflushedSentTallies )
+	{
+		m_session->CountMessageTraffic( tally.typeID, NETSTAT_MESSAGES_SENT );
+		m_session->CountMessageTraffic( tally.typeID, NETSTAT_BYTES_SENT, tally.wireSize );
+
+		if ( tally.wasResent )
+		{
+			m_session->CountReliableResent();
+			m_session->CountMessageTraffic( tally.typeID, NETSTAT_RELIABLES_RESENT );
+		}
+	}
+
+	m_unflushedSentTallies.clear();
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetConnection::CountMessageDropped( const NetMessage& msg )
+{
+	m_trafficStats.Add( NETSTAT_MESSAGES_DROPPED );
+	m_session->CountMessageTraffic( msg.GetTypeID(), NETSTAT_MESSAGES_DROPPED );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetConnection::DeleteConfirmedReliables()
+{
+	for each ( NetMessage* msg in m_confirmedReliablesToDelete )
+		m_reliablesPool.Delete( msg ); //~NetMessage frees its buffer and releases any shared payload.
+
+	m_confirmedReliablesToDelete.clear();
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool NetConnection::HasMessagesInStream( PacketStream stream )
+{
+	switch ( stream )
+	{
+		case PACKET_STREAM_RESENT_RELIABLES:
+			while ( !m_sentReliables.IsEmpty() && IsReliableConfirmed( m_sentReliables.Front()->GetReliableID() ) )
+			{
+				m_confirmedReliablesToDelete.push_back( m_sentReliables.Front() ); //Same cleanup ResendSentReliables does, so the front is one that may be due.
+				m_sentReliables.Pop();
+			}
+			return !m_sentReliables.IsEmpty() && IsReliableDueForResend( m_sentReliables.Front() );
+		case PACKET_STREAM_UNSENT_RELIABLES:
+			return !m_unsentReliables.IsEmpty() && HasRoomInReliableWindow() && !m_sentReliables.IsFull();
+		case PACKET_STREAM_UNRELIABLES:
+			return ( m_nextUnsentUnreliableIndex < m_unsentUnreliables.size() );
+		default:
+			return false;
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+size_t NetConnection::WriteMessagesFromStream( PacketStream stream, NetPacket& packet, AckBundle* bundle, size_t maxBytes )
+{
+	size_t bytesFreeBefore = packet.GetWritableBytes();
+
+	switch ( stream )
+	{
+		case PACKET_STREAM_RESENT_RELIABLES: ResendSentReliables( packet, bundle, maxBytes ); break;
+		case PACKET_STREAM_UNSENT_RELIABLES: SendUnsentReliables( packet, bundle, maxBytes ); break;
+		case PACKET_STREAM_UNRELIABLES: SendUnreliables( packet, maxBytes ); break;
+	}
+
+	return bytesFreeBefore - packet.GetWritableBytes();
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetConnection::WriteMessagesByPriority( NetPacket& packet, AckBundle* bundle )
+{
+	const float STREAM_WEIGHTS[ NUM_PACKET_STREAMS ] = { RESEND_STREAM_WEIGHT, UNSENT_RELIABLE_STREAM_WEIGHT, UNRELIABLE_STREAM_WEIGHT };
+
+	//Each stream with something to send is credited its weighted share of this packet on top of whatever it's still owed.
+	//So a stream squeezed out of one packet ages toward the front of the next, and every stream keeps making progress.
+	float totalPendingWeight = 0.f;
+	for ( int streamIndex = 0; streamIndex < NUM_PACKET_STREAMS; streamIndex++ )
+	{
+		if ( HasMessagesInStream( (PacketStream)streamIndex ) )
+			totalPendingWeight += STREAM_WEIGHTS[ streamIndex ];
+		else
+			m_streamCreditBytes[ streamIndex ] = 0.f; //Nothing waiting, nothing owed.
+	}
+	if ( totalPendingWeight == 0.f )
+		return;
+
+	float packetBytesFree = (float)packet.GetWritableBytes();
+	PacketStream streamsByCredit[ NUM_PACKET_STREAMS ];
+	for ( int streamIndex = 0; streamIndex < NUM_PACKET_STREAMS; streamIndex++ )
+	{
+		if ( HasMessagesInStream( (PacketStream)streamIndex ) )
+		{
+			float share = packetBytesFree * ( STREAM_WEIGHTS[ streamIndex ] / totalPendingWeight );
+			m_streamCreditBytes[ streamIndex ] = GetMin( m_streamCreditBytes[ streamIndex ] + share, MAX_STREAM_CREDIT_BYTES );
+		}
+
+		//Insertion sort, most owed first.
+		int insertIndex = streamIndex;
+		while ( ( insertIndex > 0 ) && ( m_streamCreditBytes[ streamsByCredit[ insertIndex - 1 ] ] < m_streamCreditBytes[ streamIndex ] ) )
+		{
+			streamsByCredit[ insertIndex ] = streamsByCredit[ insertIndex - 1 ];
+			--insertIndex;
+		}
+		streamsByCredit[ insertIndex ] = (PacketStream)streamIndex;
+	}
+
+	//Each stream spends what it's owed, then any room still left goes to whoever can use it, so no space is wasted.
+	for each ( PacketStream stream in streamsByCredit )
+	{
+		if ( m_streamCreditBytes[ stream ] >= 1.f )
+			m_streamCreditBytes[ stream ] -= (float)WriteMessagesFromStream( stream, packet, bundle, (size_t)m_streamCreditBytes[ stream ] );
+	}
+	for each ( PacketStream stream in streamsByCredit )
+	{
+		float bytesWritten = (float)WriteMessagesFromStream( stream, packet, bundle, packet.GetWritableBytes() );
+		m_streamCreditBytes[ stream ] = GetMax( m_streamCreditBytes[ stream ] - bytesWritten, -MAX_STREAM_CREDIT_BYTES );
+	}
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 void NetConnection::ConstructAndSendPacket()
+{
+	PrepareToConstructPacket();
+	ConstructPacket();
+	SendConstructedPacket();
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetConnection::PrepareToConstructPacket()
+{
+	if ( !IsConnectionBad() )
+		QueueClockSyncMessages(); //Asks m_session whether they're the host.
+
+	//Here rather than in WriteMessagesByPriority, since stable_sort allocates a temporary buffer.
+	std::stable_sort( m_unsentUnreliables.begin(), m_unsentUnreliables.end(), HasHigherMessagePriority ); //Invalidates m_unsentReplaceableIndices, cleared by DropUnsentUnreliables.
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetConnection::ConstructPacket()
 {
 	bool writeSuccess; //Note that unlike recv-side, sending-side fails silently and just doesn't send in NetSession::Update()'s calls to here.
-	NetPacket packet;
+	NetPacket& packet = m_constructedPacket;
+	packet.ResetForWriting();
+	m_hasConstructedPacket = false;
+
 	PacketHeader ph;
 	ph.connectionIndex = m_session->GetMyConnectionIndex();
 	ph.ack = GetNextSentAck(); //This will be INVALID_PACKET_ACK for connectionless things like ping commands that use SendMessageDirect.
 	ph.highestReceivedAck = m_highestReceivedAck;
 	ph.previousReceivedAcksAsBitfield = m_previousReceivedAcksAsBitfield;
+	double holdMilliseconds = ( GetCurrentTimeSeconds() - m_highestReceivedAckSeconds ) * 1000.0;
+	ph.highestReceivedAckHoldMilliseconds = (uint16_t)GetMin( GetMax( holdMilliseconds, 0.0 ), (double)UINT16_MAX );
 	writeSuccess = packet.WritePacketHeader( ph );
 	if ( !writeSuccess )
 		return;
 
 	AckBundle* bundle = CreateAckBundle( ph.ack ); //These are only for locally tracking packet IDs, i.e. unlike msg reliableIDs they aren't sent.
+	m_constructedPacketAck = ph.ack;
 	ByteBufferBookmark numMsgsBufferOffset = packet.ReserveForWriting<uint8_t>( 0U );
 
-	//Note that return counts from these are just to help debug, packet +1's its numMessages each WriteMessage call.
+	//Note that packet +1's its numMessages each WriteMessage call.
+	//[Can also send not-so-old reliables here, if room exists and their msg.reliableIDs aren't already in the packet.]
 	if ( !IsConnectionBad() )
-	{
-		ResendSentReliables( packet, bundle ); //Note we resend first, to cover for any potentially lost packets.
-		SendUnsentReliables( packet, bundle );
-		SendUnreliables( packet );
-		//[Can also send not-so-old reliables here, if room exists and their msg.reliableIDs aren't already in the packet.]
-	}
+		WriteMessagesByPriority( packet, bundle ); //Resends, new reliables and unreliables each get a weighted share, none starve.
+
+	packet.WriteAtBookmark( numMsgsBufferOffset, packet.GetTotalAddedMessages() );
+	m_hasConstructedPacket = true;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetConnection::SendConstructedPacket()
+{
+	if ( !m_hasConstructedPacket )
+		return;
+	m_hasConstructedPacket = false;
 
-	uint8_t numMessagesInPacket = packet.GetTotalAddedMessages();
-	if ( numMessagesInPacket == 0 )
+	DropUnsentUnreliables(); //Even when bad, else they'd pile up until it recovers (and FlushUnreliables would never finish).
+	FlushSentMessageTallies();
+	DeleteConfirmedReliables();
+
+	if ( m_constructedPacket.GetTotalAddedMessages() == 0 )
 	{
 		const double SECONDS_PER_HEARTBEAT = PI;
 		if ( m_secondsSinceLastSend < SECONDS_PER_HEARTBEAT )
 		{
 			m_secondsSinceLastSend += GetCurrentTimeSeconds() - m_lastSendTimeSeconds;
+			AckBundle* unsentBundle = FindBundle( m_constructedPacketAck );
+			if ( unsentBundle != nullptr )
+				unsentBundle->ackID = INVALID_PACKET_ACK; //Never coming back, and not for loss, so JudgeUnackedPackets mustn't count it.
 			return; //Don't send 0-msg packets, unless it's a heartbeat.
 		}
 	}
 
-	packet.WriteAtBookmark( numMsgsBufferOffset, numMessagesInPacket );
-	m_session->SendPacket( m_connectionInfo.address, packet ); //Dispatch filled packet.
+	m_session->SendPacket( m_connectionInfo.address, m_constructedPacket ); //Dispatch filled packet.
+	m_trafficStats.Add( NETSTAT_BYTES_SENT, (uint32_t)m_constructedPacket.GetTotalReadableBytes() );
 	m_lastSendTimeSeconds = GetCurrentTimeSeconds(); //For below.
 }
 
@@ -282,36 +718,51 @@ uint16_t NetConnection::GetNextSentReliableID()
 //--------------------------------------------------------------------------------------------------------------
 bool NetConnection::CanProcessMessage( NetMessage& msg ) const
 {
-	if ( msg.IsReliable() )
-		return !HasReceivedReliable( msg.GetReliableID() ); //No processing the already-marked!
+	if ( !msg.IsReliable() )
+		return true;
 
-	return true;
+	if ( IsReliableBeyondReceiveWindow( msg.GetReliableID() ) ) //Our sends never get this far ahead, so it's corrupt or hostile.
+	{
+		LogAndShowPrintfWithTag( "NetConnection", "Dropped reliable #%u from %s, beyond our window at #%u.", 
+								 msg.GetReliableID(), GetGuidString().c_str(), m_nextExpectedReliableID );
+		return false;
+	}
+
+	return !HasReceivedReliable( msg.GetReliableID() ); //No processing the already-marked!
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 void NetConnection::ProcessInOrder( const NetSender& from, NetMessage& msg )
 {
-	if ( m_channelData.nextExpectedSequenceID == msg.GetSequenceID() )
+	InOrderChannelData& channel = m_channels[ msg.GetInOrderChannel() ]; //Other channels carry on regardless of what this one waits on.
+
+	if ( channel.nextExpectedSequenceID == msg.GetSequenceID() )
 	{
 //		LogAndShowPrintfWithTag( "InOrderTesting", "Processing seqID %u relID %u.", msg.GetSequenceID(), msg.GetReliableID() );
 		msg.Process( from );
-		++m_channelData.nextExpectedSequenceID;
-		//Need to add code here to go through the OOO vector and remove anything that matches the above, ++ it if so.
-		NetMessage* foundMsg = m_channelData.FindAndRemoveMessageForSequenceID( m_channelData.nextExpectedSequenceID );
+		++channel.nextExpectedSequenceID;
+		//Go through the stored out-of-order messages and process anything that now follows on, ++ing past each.
+		NetMessage* foundMsg = channel.FindAndRemoveMessageForSequenceID( channel.nextExpectedSequenceID );
 		while ( foundMsg != nullptr )
 		{
 //			LogAndShowPrintfWithTag( "InOrderTesting", "Removing from outOfOrderMsgs and Processing seqID %u relID %u.", msg.GetSequenceID(), msg.GetReliableID() );
 			foundMsg->Process( from );
-			++m_channelData.nextExpectedSequenceID;
-			foundMsg = m_channelData.FindAndRemoveMessageForSequenceID( m_channelData.nextExpectedSequenceID );
+			m_outOfOrderReceivedPool.Delete( foundMsg );
+			++channel.nextExpectedSequenceID;
+			foundMsg = channel.FindAndRemoveMessageForSequenceID( channel.nextExpectedSequenceID );
 		}
 	}
 	else
 	{
-		NetMessage* out_cloneMsg = m_reliablesPool.Allocate(); //May potentially run out of allocator blocks.
+		//The only received messages copied out of their packet, since they have to outlive it.
+		NetMessage* out_cloneMsg = m_outOfOrderReceivedPool.Allocate(); //Sized to every channel's window, so it can't run out.
 		NetMessage::Duplicate( msg, *out_cloneMsg );
-		m_channelData.outOfOrderReceivedSequencedMessages.insert( out_cloneMsg );
+		if ( !channel.StoreOutOfOrderMessage( out_cloneMsg ) )
+		{
+			ERROR_RECOVERABLE( "ProcessInOrder got a sequenceID it can't store, outside the channel window or already stored!" );
+			m_outOfOrderReceivedPool.Delete( out_cloneMsg );
+		}
 //		LogAndShowPrintfWithTag( "InOrderTesting", "Stored seqID %u relID %u in outOfOrderMsgs.", out_cloneMsg->GetSequenceID(), out_cloneMsg->GetReliableID() );
 	}
 }
@@ -347,34 +798,70 @@ void NetConnection::MarkPacketReceived( const PacketHeader& ph )
 {
 	//Update what we put into the next PacketHeader of acks on response to the recv.
 	UpdateHighestReceivedAck( ph.ack/*newValue*/ );
+	++m_numPacketsReceivedThisSample;
 
 	//Now do some cleanup book-keeping--this is where we mark reliables as not just "I got it" recv, but "I checked it off" CONFIRMED.
-	ProcessConfirmedAcks( ph.highestReceivedAck, ph.previousReceivedAcksAsBitfield ); //Basically make sure we're in sync with the other side's acks.
+	ProcessConfirmedAcks( ph.highestReceivedAck, ph.previousReceivedAcksAsBitfield, ph.highestReceivedAckHoldMilliseconds ); //Basically make sure we're in sync with the other side's acks.
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
-void NetConnection::ProcessConfirmedAcks( uint16_t packetHighestAckReceived, uint16_t packetPreviousAcksBitfield )
+void NetConnection::ProcessConfirmedAcks( uint16_t packetHighestAckReceived, AckBitfield packetPreviousAcksBitfield, uint16_t packetHighestAckHoldMilliseconds )
 {
+	//Only the newest ack is a fair RTT sample. Ones confirmed via the bitfield may be late because the packet first acking them was lost.
+	//Each bundle is only found once (ConfirmAck clears its tag), and packets are never resent under the same ack, so samples are unambiguous.
+	//Less however long they held it waiting on their own tick, else a slow sender would look like a congested link and we'd slow to match.
+	AckBundle* newestBundle = FindBundle( packetHighestAckReceived );
+	if ( newestBundle != nullptr )
+	{
+		double rttSampleSeconds = GetCurrentTimeSeconds() - newestBundle->sentTimeSeconds - ( packetHighestAckHoldMilliseconds / 1000.0 );
+		UpdateRTTEstimate( GetMax( rttSampleSeconds, 0.0 ) );
+	}
+
 	ConfirmAck( packetHighestAckReceived );
-	uint16_t numBitsInBitfield = sizeof( packetPreviousAcksBitfield ) * NUM_BITS_IN_BYTE;
-	for ( uint16_t bitIndex = 0; bitIndex < numBitsInBitfield; ++bitIndex )
+
+	//Only visit the set bits, lowest first.
+	AckBitfield remainingBits = packetPreviousAcksBitfield;
+	for ( uint16_t bitIndex = 0; remainingBits != 0; ++bitIndex, remainingBits >>= 1 )
 	{
 		//This checks whether the packet's record of the other side has something in its prevAcksBitfield set that we don't.
-		if ( IS_BITFIELD_SET_AT_INDEX( packetPreviousAcksBitfield, bitIndex ) ) //If so, update us at the equivalent slot.
+		if ( ( remainingBits & 1 ) != 0 ) //If so, update us at the equivalent slot.
 			ConfirmAck( packetHighestAckReceived - ( bitIndex + 1 ) );
 	}
+
+	JudgeUnackedPackets( packetHighestAckReceived );
 }
 
+
 //--------------------------------------------------------------------------------------------------------------
-AckBundle* NetConnection::FindBundle( uint16_t ackID )
+void NetConnection::JudgeUnackedPackets( uint16_t packetHighestAckReceived )
 {
-	for each ( AckBundle& ab in m_ackBundles )
+	if ( packetHighestAckReceived == INVALID_PACKET_ACK )
+		return; //They've yet to receive anything from us.
+
+	//Bundles only live MAX_ACK_BUNDLES acks, past that we can't tell acked from lost, e.g. after a long stretch of hearing nothing.
+	if ( (uint16_t)( m_nextSentAck - m_nextAckToJudge ) > MAX_ACK_BUNDLES )
+		m_nextAckToJudge = m_nextSentAck - MAX_ACK_BUNDLES;
+
+	//Anything below this can no longer be reported by their bitfield, so if it's still unconfirmed it never arrived.
+	uint16_t oldestStillReportable = packetHighestAckReceived - (uint16_t)NUM_PREVIOUS_ACKS_IN_BITFIELD;
+	while ( UnsignedLessThan( m_nextAckToJudge, oldestStillReportable ) && UnsignedLessThan( m_nextAckToJudge, m_nextSentAck ) )
 	{
-		if ( ab.ackID == ackID )
-			return &ab;
+		AckBundle* unackedBundle = FindBundle( m_nextAckToJudge ); //Null once confirmed, or if never sent, cf. SendConstructedPacket.
+		if ( unackedBundle != nullptr )
+			++m_numPacketsLostThisSample;
+
+		++m_nextAckToJudge;
+		if ( m_nextAckToJudge == INVALID_PACKET_ACK )
+			++m_nextAckToJudge; //Skipped the same way by GetNextSentAck.
 	}
-	return nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+AckBundle* NetConnection::FindBundle( uint16_t ackID )
+{
+	AckBundle& ab = m_ackBundles[ ackID % MAX_ACK_BUNDLES ]; //Where CreateAckBundle put it.
+	return ( ab.ackID == ackID ) ? &ab : nullptr;
 }
 
 
@@ -389,6 +876,9 @@ void NetConnection::ConfirmAck( uint16_t ack )
 	{
 		for ( unsigned int reliableIdIndex = 0; reliableIdIndex < correspondingBundle->numReliableIDsSent; reliableIdIndex++ )
 			MarkReliableConfirmed( correspondingBundle->sentReliableIDs[ reliableIdIndex ] );
+
+		correspondingBundle->ackID = INVALID_PACKET_ACK; //Every later packet's bitfield repeats this ack, no need to walk it again.
+		++m_numPacketsAckedThisSample;
 	}
 }
 
@@ -397,29 +887,20 @@ void NetConnection::ConfirmAck( uint16_t ack )
 void NetConnection::MarkReliableConfirmed( uint16_t rid )
 {
 	if ( UnsignedLessThan( rid, m_oldestUnconfirmedReliableID ) )
-	{
 		return; //We already know it was confirmed--because it's below the oldest unconfirmed we have.
-	}
-	else if ( rid == m_oldestUnconfirmedReliableID )
-	{
-		//The main reason we insert rid just to remove it, is to increment m_oldest correctly.
-		std::set<uint16_t, UnsignedComparator>::iterator ridIter = m_confirmedReliableIDs.insert( rid ).first; //Iter to inserted key.
 
-		//This may not be as simple as just incrementing once.
-		//e.g. m_oldestUnconfirmedReliableID was 3, and now we've received 2 for the first time.
-		//So, we need to advance as many times as it takes to find m_oldest.
+	if ( UnsignedGreaterThanOrEqual( rid, m_nextSentReliableID ) )
+		return; //Never sent, so can't be confirmed. Also keeps the bit below inside the window.
 
-		//Each time we remove at the oldest, we'll increment oldest for the next go-around, so we'll remove 0, 1, 2, but not 4 if find(3) fails.
-		while ( ridIter != m_confirmedReliableIDs.end() )
-		{
-			m_confirmedReliableIDs.erase( ridIter );
-			++m_oldestUnconfirmedReliableID; //Be sure it comes after the erase!
-			ridIter = m_confirmedReliableIDs.find( m_oldestUnconfirmedReliableID );
-		}
-	}
-	else //The oldest is staying the oldest, but the new received id exceeds it. We get 3, but still lack 2.
+	m_confirmedReliableIDs.set( rid % RELIABLE_WINDOW_SIZE );
+
+	//This may not be as simple as just incrementing once.
+	//e.g. m_oldestUnconfirmedReliableID was 2 and we already had 3 and 4, now getting 2 advances it to 5, but not to 6 if we lack 5.
+	//Clear each bit we slide past, since it'll be reused by the ID RELIABLE_WINDOW_SIZE above it.
+	while ( ( m_oldestUnconfirmedReliableID != m_nextSentReliableID ) && m_confirmedReliableIDs.test( m_oldestUnconfirmedReliableID % RELIABLE_WINDOW_SIZE ) )
 	{
-		m_confirmedReliableIDs.insert( rid ); //Could enforce ordered-insert manually on an array, too.
+		m_confirmedReliableIDs.reset( m_oldestUnconfirmedReliableID % RELIABLE_WINDOW_SIZE );
+		++m_oldestUnconfirmedReliableID;
 	}
 
 	m_lastConfirmedAck = rid; //Note this is then not updated by the first case.
@@ -479,12 +960,17 @@ void NetConnection::UpdateHighestReceivedAck( uint16_t newAckValue )
 //		ASSERT_RECOVERABLE( ( offsetShiftAmt /*- 1, 0-1 caused it to underflow*/ ) <= MAX_VALID_OFFSET, "Invalid offset in UpdateHighestReceivedAck case 1!" );
 			//WARNING: these are extremely likely to go off when you use a breakpoint, because it quickly gets MAX_VALID_OFFSET acks away!
 
-		m_previousReceivedAcksAsBitfield = m_previousReceivedAcksAsBitfield << offsetShiftAmt; //No -1 here, this is not an index.
+		if ( offsetShiftAmt >= MAX_VALID_OFFSET )
+			m_previousReceivedAcksAsBitfield = 0; //Everything we had slides off the end (and shifting by the full width is undefined).
+		else
+			m_previousReceivedAcksAsBitfield = m_previousReceivedAcksAsBitfield << offsetShiftAmt; //No -1 here, this is not an index.
 			//We want to index from 0, hence the <<, simplifying IsReceived(). Could do << or >> as long as all methods are consistent though.
 
 		m_highestReceivedAck = newAckValue;
+		m_highestReceivedAckSeconds = GetCurrentTimeSeconds();
 
-		SET_BIT( m_previousReceivedAcksAsBitfield, offsetShiftAmt - 1 ); //Stores the previous m_highest value into m_prevBF as a 1 for "I did get this."
+		if ( offsetShiftAmt <= MAX_VALID_OFFSET )
+			SET_BIT( m_previousReceivedAcksAsBitfield, offsetShiftAmt - 1 ); //Stores the previous m_highest value into m_prevBF as a 1 for "I did get this."
 			//The extra -1 is because we start indexing at prevBF[0].
 	}
 	else //newValue < m_highest, so reverse the subtraction order for the shift. Implies we just received a packet sent before our most recent/highest packet.
@@ -493,12 +979,13 @@ void NetConnection::UpdateHighestReceivedAck( uint16_t newAckValue )
 //		ASSERT_RECOVERABLE( ( offsetShiftAmt /*- 1, 0-1 caused it to underflow*/ ) <= MAX_VALID_OFFSET, "Invalid offset in UpdateHighestReceivedAck case 2!" );
 			//WARNING: these are extremely likely to go off when you use a breakpoint, because it quickly gets MAX_VALID_OFFSET acks away!
 
-		SET_BIT( m_previousReceivedAcksAsBitfield, offsetShiftAmt - 1 ); //Keeps m_highest the same while storing new value into m_prevBF as a 1 for "I did get this."
+		if ( ( offsetShiftAmt > 0 ) && ( offsetShiftAmt <= MAX_VALID_OFFSET ) ) //Else too old for the bitfield to remember.
+			SET_BIT( m_previousReceivedAcksAsBitfield, offsetShiftAmt - 1 ); //Keeps m_highest the same while storing new value into m_prevBF as a 1 for "I did get this."
 			//The extra -1 is because we start indexing at prevBF[0].
 	}
 
 	/* Example Case
-		m_highest	m_prevBitfield (tracks up to the last 16 unique acks received)
+		m_highest	m_prevBitfield (tracks up to the last 32 unique acks received, 16 shown)
 		0			0000 0000 0000 0000	=> Now UHRA(2) hits. We'll assume 0 started in the list, hence it receives a "1" in the line below 2-0=2 places behind highest.
 											- (Note "2 places behind highest" means prevBF[1] due to indices starting  at zero in C++, hence the extra -1 above.)
 		2			0100 0000 0000 0000	=> Thus prevBF denotes that 0 was already in that list, but 1 hasn't been seen yet. Now say we call UHRA(4).
@@ -542,6 +1029,8 @@ AckBundle* NetConnection::CreateAckBundle( uint16_t packetAck )
 
 	bundle->ackID = packetAck;
 
+	bundle->sentTimeSeconds = GetCurrentTimeSeconds();
+
 	bundle->numReliableIDsSent = 0;
 
 	return bundle;
@@ -549,67 +1038,149 @@ AckBundle* NetConnection::CreateAckBundle( uint16_t packetAck )
 
 
 //--------------------------------------------------------------------------------------------------------------
-void NetConnection::RemoveAllReliableIDsLessThan( uint16_t newCutoffID )
+void NetConnection::UpdateRTTEstimate( double rttSampleSeconds )
 {
-	//We can receive reliable IDs out of order and wrapped around, e.g. one sends 65535 0 1 2 3 4 but we get 2 3 0 65535 4 1, so doing a naive loop.
+	const double SMOOTHING_GAIN = 1.0 / 8.0; //Alpha.
+	const double VARIANCE_GAIN = 1.0 / 4.0; //Beta.
+	const double VARIANCE_MULTIPLIER = 4.0; //K.
 
-	//Doing a naive loop because we can't assume m_receivedReliableIDs is sorted, e.g. receiving 4 1 65535 2 3 0 instead of 65535 0 1 2 3 4.
-	for ( auto ridIter = m_receivedReliableIDs.begin(); ridIter != m_receivedReliableIDs.end(); )
+	if ( !HasRTTEstimate() )
 	{
-		const uint16_t& rid = *ridIter;
-		if ( UnsignedLessThan( rid, newCutoffID ) )
-		{
-			m_receivedReliableIDs.erase( ridIter );
-		}
-		else ++ridIter;
+		m_smoothedRTTSeconds = rttSampleSeconds;
+		m_rttVarianceSeconds = rttSampleSeconds * .5;
+	}
+	else //Variance first, it's measured against the old SRTT.
+	{
+		m_rttVarianceSeconds = ( ( 1.0 - VARIANCE_GAIN ) * m_rttVarianceSeconds ) + ( VARIANCE_GAIN * fabs( m_smoothedRTTSeconds - rttSampleSeconds ) );
+		m_smoothedRTTSeconds = ( ( 1.0 - SMOOTHING_GAIN ) * m_smoothedRTTSeconds ) + ( SMOOTHING_GAIN * rttSampleSeconds );
+	}
+
+	double resendTimeoutSeconds = m_smoothedRTTSeconds + ( VARIANCE_MULTIPLIER * m_rttVarianceSeconds );
+	m_resendTimeoutSeconds = GetMax( MIN_RESEND_TIMEOUT_SECONDS, GetMin( resendTimeoutSeconds, MAX_RESEND_TIMEOUT_SECONDS ) );
+
+	if ( ( m_lowestRTTSeconds < 0.0 ) || ( rttSampleSeconds < m_lowestRTTSeconds ) )
+		m_lowestRTTSeconds = rttSampleSeconds;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool NetConnection::UpdateTickTimer( float deltaSeconds )
+{
+	m_secondsSinceLastTick += deltaSeconds;
+	m_secondsUntilNextTick -= deltaSeconds;
+	if ( m_secondsUntilNextTick > 0.f )
+		return false;
+
+	UpdateSendRate();
+
+	m_secondsUntilNextTick += ( 1.f / m_sendRateHz );
+	if ( m_secondsUntilNextTick <= 0.f )
+		m_secondsUntilNextTick = ( 1.f / m_sendRateHz ); //Fell behind, e.g. a long frame. Skip the missed ticks rather than bursting to catch up.
+
+	m_secondsBetweenLastTicks = m_secondsSinceLastTick;
+	m_secondsSinceLastTick = 0.f;
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetConnection::UpdateSendRate()
+{
+	double currentTimeSeconds = GetCurrentTimeSeconds();
+	if ( ( currentTimeSeconds - m_congestionSampleStartSeconds ) < CONGESTION_SAMPLE_SECONDS )
+		return;
+
+	//Only packets we now know the fate of count, so heartbeat-only links and acks landing a sample late don't read as loss.
+	uint32_t numPacketsJudged = m_numPacketsAckedThisSample + m_numPacketsLostThisSample;
+	if ( ( m_numPacketsReceivedThisSample > 0 ) && ( numPacketsJudged > 0 ) )
+	{
+		m_measuredLossRate = (float)m_numPacketsLostThisSample / (float)numPacketsJudged;
+
+		bool isRTTInflated = HasRTTEstimate() && ( m_smoothedRTTSeconds > ( ( 2.0 * m_lowestRTTSeconds ) + CONGESTION_RTT_SLACK_SECONDS ) );
+		bool isCongested = ( m_measuredLossRate > CONGESTION_LOSS_THRESHOLD ) || isRTTInflated;
+
+		if ( isCongested )
+			m_sendRateHz = GetMax( MIN_SEND_RATE_HZ, m_sendRateHz * SEND_RATE_DECREASE_SCALE );
+		else
+			m_sendRateHz = GetMin( MAX_SEND_RATE_HZ, m_sendRateHz + SEND_RATE_INCREASE_HZ );
 	}
+
+	m_congestionSampleStartSeconds = currentTimeSeconds;
+	m_numPacketsReceivedThisSample = 0;
+	m_numPacketsAckedThisSample = 0;
+	m_numPacketsLostThisSample = 0;
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 void NetConnection::MarkReliableReceived( uint16_t receivedReliableID )
 {
-	if ( UnsignedGreaterThanOrEqual( receivedReliableID, m_nextExpectedReliableID + RELIABLE_RANGE_RADIUS ) ) //This interval defines sliding window.
+	//We can receive reliable IDs out of order and wrapped around, e.g. one sends 65535 0 1 2 3 4 but we get 2 3 0 65535 4 1.
+	//Keying each into the bitset by ID % RELIABLE_WINDOW_SIZE handles both without any searching or sorting.
+	if ( UnsignedGreaterThanOrEqual( receivedReliableID, m_nextExpectedReliableID ) ) //This interval defines sliding window.
 	{
-		uint16_t distance = receivedReliableID - m_nextExpectedReliableID;
-		if ( UnsignedGreaterThan( distance, RELIABLE_RANGE_RADIUS ) )
-			ERROR_AND_DIE( "MarkReliableReceived found reliable ahead of expected range!" ); //SEND-SIDE SHOULD BLOCK THIS FROM HAPPENING.
-		
-		TODO( "In a release build, should drop this violating connection." );
+		if ( IsReliableBeyondReceiveWindow( receivedReliableID ) ) //SEND-SIDE BLOCKS THIS, cf. HasRoomInReliableWindow. Off the wire, so no dying over it.
+		{
+			LogAndShowPrintfWithTag( "NetConnection", "MarkReliableReceived ignored reliable #%u from %s, beyond our window at #%u.", 
+									 receivedReliableID, GetGuidString().c_str(), m_nextExpectedReliableID ); //CanProcessMessage drops these first, but joins skip it.
+			return;
+		}
+
+		//Where we handle what the sliding window has now left behind: the slots it newly covers last held IDs RELIABLE_WINDOW_SIZE back.
+		for ( uint16_t skippedID = m_nextExpectedReliableID; skippedID != receivedReliableID; ++skippedID )
+			m_receivedReliableIDs.reset( skippedID % RELIABLE_WINDOW_SIZE );
 
 		m_nextExpectedReliableID = receivedReliableID + 1; //Advances sliding window.
-		RemoveAllReliableIDsLessThan( receivedReliableID - RELIABLE_RANGE_RADIUS );
-			//Where we handle what the sliding window has now left behind, keeping receivedReliables container from outgrowing twice interval radius + 1.
 	}
-	else
+	else if ( (uint16_t)( m_nextExpectedReliableID - receivedReliableID ) > RELIABLE_WINDOW_SIZE )
 	{
-		uint16_t diff = m_nextExpectedReliableID - receivedReliableID;
-		if ( UnsignedLessThan( diff, RELIABLE_RANGE_RADIUS ) )
-			m_receivedReliableIDs.push_back( receivedReliableID );
+		return; //Already behind the window, which HasReceivedReliable treats as received anyway.
 	}
+
+	m_receivedReliableIDs.set( receivedReliableID % RELIABLE_WINDOW_SIZE );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool NetConnection::IsReliableBeyondReceiveWindow( uint16_t reliableID ) const
+{
+	return UnsignedGreaterThanOrEqual( reliableID, m_nextExpectedReliableID ) 
+		&& ( (uint16_t)( reliableID - m_nextExpectedReliableID ) > RELIABLE_RANGE_RADIUS );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 bool NetConnection::HasReceivedReliable( uint16_t reliableID ) const
 {
-	//Is it still within our sliding window interval? i.e. reliableID >= MIN && reliableID <= MAX?
-	if ( UnsignedGreaterThanOrEqual( reliableID, m_nextExpectedReliableID - RELIABLE_RANGE_RADIUS )
-		 && UnsignedLessThanOrEqual( reliableID, m_nextExpectedReliableID + RELIABLE_RANGE_RADIUS ) )
-	{
-		//Does it also then exist in our receivedReliables?
-		for each ( const uint16_t& rid in m_receivedReliableIDs )
-			if ( rid == reliableID )
-				return true;
-	}
-	return false;
+	if ( UnsignedGreaterThanOrEqual( reliableID, m_nextExpectedReliableID ) )
+		return false; //Above anything we've received.
+
+	if ( (uint16_t)( m_nextExpectedReliableID - reliableID ) > RELIABLE_WINDOW_SIZE )
+		return true; //Behind our sliding window, so a stale resend of something long since processed.
+
+	return m_receivedReliableIDs.test( reliableID % RELIABLE_WINDOW_SIZE );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 bool NetConnection::IsReliableConfirmed( uint16_t reliableID ) const
 {		
-	return ( m_confirmedReliableIDs.find( reliableID ) != m_confirmedReliableIDs.end() );
+	if ( UnsignedLessThan( reliableID, m_oldestUnconfirmedReliableID ) )
+		return true; //The window already slid past it.
+
+	if ( UnsignedGreaterThanOrEqual( reliableID, m_nextSentReliableID ) )
+		return false;
+
+	return m_confirmedReliableIDs.test( reliableID % RELIABLE_WINDOW_SIZE );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool NetConnection::HasRoomInReliableWindow() const
+{
+	//Keeps the other side's MarkReliableReceived from ever seeing an ID beyond its window, and our confirmed bitset from lapping itself.
+	uint16_t numUnconfirmed = m_nextSentReliableID - m_oldestUnconfirmedReliableID;
+	return ( numUnconfirmed < RELIABLE_RANGE_RADIUS );
 }
 
 
@@ -622,7 +1193,7 @@ std::string NetConnection::GetDebugString()
 	
 	std::string connStr = Stringf
 	( 
-		"%c %u [%s]\t %s\t lastRecvTime[%.3fs]\t lastSentAck[%u]\t lastRecvAck[%u]\t lastConfAck[%u]",
+		"%c %u [%s]\t %s\t lastRecvTime[%.3fs]\t lastSentAck[%u]\t lastRecvAck[%u]\t lastConfAck[%u]\t rtt[%.1f+/-%.1fms]\t rto[%.0fms]\t rate[%.0fHz]\t loss[%.0f%%]\t clock[%+.1fms]\t up[%.1fKB/s]\t down[%.1fKB/s]\t resent[%u/s]\t dropped[%u/s]",
 		m_session->IsHost( this ) ? 'H' : ' ',
 		m_connectionInfo.connectionIndex,
 		addrStr,
@@ -630,7 +1201,17 @@ std::string NetConnection::GetDebugString()
 		m_secondsSinceLastRecv,
 		m_nextSentAck,
 		m_lastReceivedAck,
-		m_lastConfirmedAck
+		m_lastConfirmedAck,
+		HasRTTEstimate() ? ( 1000.0 * m_smoothedRTTSeconds ) : 0.0,
+		1000.0 * m_rttVarianceSeconds,
+		1000.0 * m_resendTimeoutSeconds,
+		m_sendRateHz,
+		100.f * m_measuredLossRate,
+		1000.0 * m_clockSync.GetOffsetSeconds( GetCurrentTimeSeconds() ),
+		m_trafficStats.GetLastSecond( NETSTAT_BYTES_SENT ) / 1024.f,
+		m_trafficStats.GetLastSecond( NETSTAT_BYTES_RECEIVED ) / 1024.f,
+		m_trafficStats.GetLastSecond( NETSTAT_RELIABLES_RESENT ),
+		m_trafficStats.GetLastSecond( NETSTAT_MESSAGES_DROPPED )
 	);
 
 	if ( IsMe() )
@@ -3,25 +3,57 @@
 #include "Engine/Networking/NetSystem.hpp"
 #include "Engine/Networking/NetMessage.hpp"
 #include "Engine/Networking/AckBundle.hpp"
+#include "Engine/Networking/NetPacket.hpp"
 #include "Engine/Memory/ObjectPool.hpp"
 #include "Engine/Networking/NetConnectionUtils.hpp"
-#include <set>
+#include "Engine/Networking/NetTrafficStats.hpp"
+#include <bitset>
+#include <map>
 
 
 //-----------------------------------------------------------------------------
-#define INVALID_CONNECTION_INDEX	(0xFF)
+#define INVALID_CONNECTION_INDEX	(0xFFFF)
 #define DEFAULT_TICK_RATE_SECONDS	( 1.f / 20.f ) //20 ticks a second.
 #define MAX_ACK_BUNDLES				(128)  //( 2 * (int) (1.f / DEFAULT_TICK_RATE_SECONDS ) ) //2 secs of memory.
 	//Worked out to more with a number someone said had been suggested by instructor, so playing it safe with this.
 #define RELIABLE_RANGE_RADIUS		(1000) //Defines an interval of valid acks centered on nextExpectedReliableID.
 	//i.e. The other side should never send beyond nextExpectedReliableID + RELIABLE_RANGE_RADIUS. 
 	//This also can't exceed half of our selected uint type range, or else we invalidate UnsignedGreaterThan (etc) functions.
+#define RELIABLE_WINDOW_SIZE		(2048) //Slots in the reliable ID bitsets, keyed by ID % this. At least twice RELIABLE_RANGE_RADIUS,
+	//and a power of two so that keying stays consistent when the uint16_t IDs wrap around.
+#define INITIAL_RESEND_TIMEOUT_SECONDS	( .2 ) //Until the first round trip time sample comes in.
+#define MIN_RESEND_TIMEOUT_SECONDS		( .03 ) //Floors it for LANs, where RTT is mostly the other side's tick delay before it acks.
+#define MAX_RESEND_TIMEOUT_SECONDS		( 2. ) //Caps it so a latency spike can't stall reliables for long.
+#define MAX_SEND_RATE_HZ			( 1.f / DEFAULT_TICK_RATE_SECONDS ) //Congestion control never ticks a connection faster than the old global rate...
+#define MIN_SEND_RATE_HZ			( 4.f ) //...or slower than this, so the game-side updates and acks keep flowing on a lossy link.
+#define SEND_RATE_INCREASE_HZ		( 1.f ) //Additive increase, per CONGESTION_SAMPLE_SECONDS without signs of congestion.
+#define SEND_RATE_DECREASE_SCALE	( .5f ) //Multiplicative decrease, per CONGESTION_SAMPLE_SECONDS with them.
+#define CONGESTION_SAMPLE_SECONDS	( 1.0 )
+#define CONGESTION_LOSS_THRESHOLD	( .05f ) //Fraction of packets sent going unacked that counts as congestion.
+#define CONGESTION_RTT_SLACK_SECONDS	( .05 ) //SRTT this far past twice the lowest RTT seen counts as congestion too, i.e. router queues filling.
+#define MAX_FRAGMENTED_MESSAGE_SIZE	( 32 KB ) //Largest payload SendMessageToThem accepts, splitting anything past MAX_MESSAGE_SIZE into NETMSG_FRAGMENTs.
+#define FRAGMENT_HEADER_SIZE		( sizeof( uint8_t ) + sizeof( uint16_t ) + sizeof( uint16_t ) ) //Message type, fragment index, number of fragments.
+#define MAX_FRAGMENT_CHUNK_SIZE		( MAX_MESSAGE_SIZE - FRAGMENT_HEADER_SIZE )
+#define RESEND_STREAM_WEIGHT			( 2.f ) //Packet space is shared between the PacketStreams below by these weights.
+#define UNSENT_RELIABLE_STREAM_WEIGHT	( 1.f ) //Resends get the most, since a lost reliable holds up everything in-order behind it.
+#define UNRELIABLE_STREAM_WEIGHT		( 1.f )
+#define MAX_STREAM_CREDIT_BYTES			( 4.f * MAX_PACKET_SIZE ) //Caps what a long-starved stream is owed, so it can't starve the rest for long in turn.
+#define MAX_UNRELIABLES				(10000)
+#define MAX_RELIABLES				(10000)
 
 
 //-----------------------------------------------------------------------------
 class NetSession;
-class NetPacket;
-struct PacketHeader;
+
+
+//-----------------------------------------------------------------------------
+enum PacketStream //What ConstructAndSendPacket schedules packet space between.
+{
+	PACKET_STREAM_RESENT_RELIABLES,
+	PACKET_STREAM_UNSENT_RELIABLES,
+	PACKET_STREAM_UNRELIABLES,
+	NUM_PACKET_STREAMS
+};
 
 
 //-----------------------------------------------------------------------------
@@ -57,16 +89,36 @@ public:
 	void ConfirmAndWakeConnection();
 	double GetSecondsSinceLastRecv() const { return m_secondsSinceLastRecv; }
 	void AddSecondsSinceLastRecv( double secs ) { m_secondsSinceLastRecv += secs; }
-
-	void SendMessageToThem( NetMessage& msg ); //Enqueues into unreliable vector or unsent-reliable queue.
+	bool HasRTTEstimate() const { return ( m_smoothedRTTSeconds >= 0.0 ); }
+	double GetSmoothedRTTSeconds() const { return m_smoothedRTTSeconds; }
+	double GetRTTVarianceSeconds() const { return m_rttVarianceSeconds; }
+	double GetResendTimeoutSeconds() const { return m_resendTimeoutSeconds; }
+	float GetSendRateHz() const { return m_sendRateHz; }
+	float GetMeasuredLossRate() const { return m_measuredLossRate; }
+	uint32_t GetNumReliablesResent() const { return m_numReliablesResent; } //Since the connection was made.
+	const NetClockSync& GetClockSync() const { return m_clockSync; }
+	double GetRemoteTimeSeconds() const; //Their clock right now, i.e. ours until the first clock sync response arrives.
+	NetTrafficStats& GetTrafficStats() { return m_trafficStats; } //Last second and minute, rolled by NetSession::Update.
+	bool UpdateTickTimer( float deltaSeconds ); //True when it's this connection's turn to tick, cf. NetSession::Update.
+	float GetSecondsBetweenLastTicks() const { return m_secondsBetweenLastTicks; } //Use as the tick's deltaSeconds.
+
+	void SendMessageToThem( NetMessage& msg, SharedNetMessagePayload* sharedPayload = nullptr ); //Enqueues into unreliable vector or unsent-reliable queue.
+		//Pass a sharedPayload (cf. NetSession::SendToAllConnections) to reference it rather than copy msg's payload.
+		//Reliable messages over MAX_MESSAGE_SIZE get fragmented, e.g. write them into your own buffer via NetMessage( id, size, buffer, 0 ).
 	void SendMessagesToThem( NetMessage msgs[], int numMessages );
-	void ConstructAndSendPacket(); //Pops from unreliables' front end, but tosses it all if out of room.
+	void ConstructAndSendPacket(); //Pops from unreliables' front end, but tosses it all if out of room. The three calls below, in order.
+	void PrepareToConstructPacket(); //Main thread. Queues what needs the session, e.g. clock sync, and sorts, so ConstructPacket needn't touch either or allocate.
+	void ConstructPacket(); //Touches only this connection and never allocates or frees, so NetSession::Update builds many at once as jobs.
+	void SendConstructedPacket(); //Main thread. Frees what ConstructPacket retired, counts into the session's stats, and sends unless empty with no heartbeat due.
 	
 	bool CanProcessMessage( NetMessage& msg ) const;
 	void ProcessMessage( const NetSender& from, NetMessage& msg );
 	void ProcessInOrder( const NetSender& from, NetMessage& msg );
 	void MarkPacketReceived( const PacketHeader& ph );
 	void MarkMessageReceived( const NetMessage& msg );
+	void ReceiveFragment( const NetSender& from, NetMessage& fragmentMsg ); //Processes the original message once its last fragment arrives.
+	void ReceiveClockSyncRequest( NetMessage& requestMsg );
+	void ReceiveClockSyncResponse( NetMessage& responseMsg );
 
 	sockaddr_in GetAddressObject() const { return m_connectionInfo.address; }
 	uint16_t GetNextSentAck(); //FOR PACKETS (read from PacketHeader and updated as local/never-sent AckBundles with bitfield logic).
@@ -78,24 +130,40 @@ public:
 private:
 	bool WasAckReceived( uint16_t ackValue ); //What uses this? Was part of the interview question, but unconnected during lecture.
 	bool HasReceivedReliable( uint16_t reliableID ) const;
+	bool IsReliableBeyondReceiveWindow( uint16_t reliableID ) const; //More than RELIABLE_RANGE_RADIUS ahead of m_nextExpectedReliableID.
 	bool IsReliableConfirmed( uint16_t reliableID ) const;
+	bool HasRoomInReliableWindow() const; //Whether sending another new reliable keeps us within RELIABLE_RANGE_RADIUS of the oldest unconfirmed.
 	AckBundle* CreateAckBundle( uint16_t packetAck ); //May recycle old ones.
-
-	void QueueReliable( NetMessage& msg );
-	void QueueUnreliable( NetMessage& msg );
-	uint8_t ResendSentReliables( NetPacket& packet, AckBundle* bundle );
-	uint8_t SendUnsentReliables( NetPacket& packet, AckBundle* bundle );
-	uint8_t SendUnreliables( NetPacket& packet );
+	void UpdateRTTEstimate( double rttSampleSeconds );
+	void UpdateSendRate(); //AIMD, cf. CONGESTION_SAMPLE_SECONDS.
+	void JudgeUnackedPackets( uint16_t packetHighestAckReceived ); //Counts as lost those now too old for their ack bitfield to report.
+	bool IsReliableDueForResend( const NetMessage* msg ) const;
+
+	NetMessage* CloneForQueue( ObjectPool< NetMessage >& pool, const NetMessage& msg, SharedNetMessagePayload* sharedPayload );
+	void QueueReliable( NetMessage& msg, SharedNetMessagePayload* sharedPayload );
+	void QueueUnreliable( NetMessage& msg, SharedNetMessagePayload* sharedPayload );
+	void WriteMessagesByPriority( NetPacket& packet, AckBundle* bundle ); //Weighted between PacketStreams, with what each is owed carried over.
+	bool HasMessagesInStream( PacketStream stream );
+	size_t WriteMessagesFromStream( PacketStream stream, NetPacket& packet, AckBundle* bundle, size_t maxBytes ); //Returns bytes written.
+	uint8_t ResendSentReliables( NetPacket& packet, AckBundle* bundle, size_t maxBytes );
+	uint8_t SendUnsentReliables( NetPacket& packet, AckBundle* bundle, size_t maxBytes );
+	uint8_t SendUnreliables( NetPacket& packet, size_t maxBytes ); //Highest NetMessagePriority first.
+	void DropUnsentUnreliables();
+	void SendFragmentsToThem( NetMessage& msg );
+	void QueueClockSyncMessages(); //Called just before each packet's built, so the times written are as near as we can get to when it's sent.
+	void CountMessageSent( const NetMessage& msg, bool wasResent ); //Into ours now, and the session's per-message-type stats once FlushSentMessageTallies runs.
+	void FlushSentMessageTallies(); //Main thread, the session's stats are shared by every connection's ConstructPacket.
+	void DeleteConfirmedReliables(); //Main thread, the global operator delete isn't thread-safe.
+	void CountMessageDropped( const NetMessage& msg );
 	
 	void MarkReliableReceived( uint16_t receivedReliableID );
-	void RemoveAllReliableIDsLessThan( uint16_t newCutoffID );
 
 	//Below are called upon by MarkPacketReceived, but not MarkMessageReceived. Yeah.
 		void UpdateHighestReceivedAck( uint16_t newAckValue );
-		void ProcessConfirmedAcks( uint16_t packetHighestAckReceived, uint16_t packetPreviousAcksBitfield );
+		void ProcessConfirmedAcks( uint16_t packetHighestAckReceived, AckBitfield packetPreviousAcksBitfield, uint16_t packetHighestAckHoldMilliseconds );
 		void ConfirmAck( uint16_t ack );
 			void MarkReliableConfirmed( uint16_t rid );
-			AckBundle* FindBundle( uint16_t ackID );
+			AckBundle* FindBundle( uint16_t ackID ); //Direct-indexed at ackID % MAX_ACK_BUNDLES, null if that slot has moved on.
 
 	NetSession* m_session; //Who made this connection.
 	NetConnectionState m_connectionState;
@@ -116,29 +184,71 @@ private:
 	uint16_t m_lastReceivedAck; //For debug window.
 	uint16_t m_lastConfirmedAck; //For debug window.
 	uint16_t m_highestReceivedAck; //For receiving side.
-	uint16_t m_previousReceivedAcksAsBitfield; //For receiving side.
+	double m_highestReceivedAckSeconds; //When it arrived, for PacketHeader::highestReceivedAckHoldMilliseconds.
+	AckBitfield m_previousReceivedAcksAsBitfield; //For receiving side.
+
+	//-----------------------------------------------------------------------------//Round Trip Time (Jacobson/Karels, i.e. as TCP does in RFC 6298)
+	double m_smoothedRTTSeconds; //SRTT, negative until the first sample.
+	double m_rttVarianceSeconds; //RTTVAR, the smoothed mean deviation from SRTT.
+	double m_resendTimeoutSeconds; //RTO, how long a sent reliable waits for confirmation before we resend it.
+	double m_lowestRTTSeconds; //Baseline for spotting queueing delay, negative until the first sample.
+
+	//-----------------------------------------------------------------------------//Congestion Control and Pacing
+	float m_sendRateHz; //Ticks per second, i.e. packets per second at most (heartbeats aside).
+	float m_secondsUntilNextTick; //Starts staggered by connection index, so a host's connections don't all send in the same frame.
+	float m_secondsSinceLastTick;
+	float m_secondsBetweenLastTicks;
+	double m_congestionSampleStartSeconds;
+	uint32_t m_numPacketsReceivedThisSample; //A sample they sent nothing in says nothing about the link, so it's skipped.
+	uint32_t m_numPacketsAckedThisSample;
+	uint32_t m_numPacketsLostThisSample; //Only once their ack can no longer turn up, cf. JudgeUnackedPackets.
+	float m_measuredLossRate; //From the last complete sample.
+	uint16_t m_nextAckToJudge; //Oldest sent ack not yet known acked or lost.
+	uint32_t m_numReliablesResent;
+
+	//-----------------------------------------------------------------------------//Clock Sync (Clients sync to the host only.)
+	NetClockSync m_clockSync;
+
+	//-----------------------------------------------------------------------------//Traffic Stats
+	NetTrafficStats m_trafficStats;
 
 	//-----------------------------------------------------------------------------//Messages
 	
 	//----//Sending Unreliable Traffic
 	ObjectPool< NetMessage > m_unreliablesPool;
 	std::vector< NetMessage* > m_unsentUnreliables;
+	std::map< uint64_t, size_t > m_unsentReplaceableIndices; //Type ID above replacement key, to where that stream's newest sits in m_unsentUnreliables.
+	size_t m_nextUnsentUnreliableIndex; //Where SendUnreliables picks up within the packet being assembled.
+
+	//----//Packet Assembly
+	float m_streamCreditBytes[ NUM_PACKET_STREAMS ]; //Deficit round robin, i.e. what each stream is still owed of packet space.
+	NetPacket m_constructedPacket; //Between ConstructPacket and SendConstructedPacket.
+	bool m_hasConstructedPacket;
+	uint16_t m_constructedPacketAck;
+	struct SentMessageTally { uint8_t typeID; bool wasResent; uint32_t wireSize; };
+	std::vector< SentMessageTally > m_unflushedSentTallies; //Reserved for a full packet and cleared, not freed, by each flush, so ConstructPacket never allocates.
+	std::vector< NetMessage* > m_confirmedReliablesToDelete; //Popped off m_sentReliables by ConstructPacket, reserved likewise.
 
 	//----//Sending Reliable Traffic (IDs)
 	uint16_t m_nextSentReliableID;
 	uint16_t m_oldestUnconfirmedReliableID; //We have to hear back from the other side via ??? before incrementing this.
-	std::set<uint16_t, UnsignedComparator> m_confirmedReliableIDs; //Confirmed == the sender's side, below received == the recv's side.
+	std::bitset< RELIABLE_WINDOW_SIZE > m_confirmedReliableIDs; //Confirmed == the sender's side, below received == the recv's side.
+		//Only meaningful from m_oldestUnconfirmedReliableID up to m_nextSentReliableID, anything older is known confirmed.
 
 	//----//Sending Reliable Traffic
 	ObjectPool< NetMessage > m_reliablesPool;
-	std::queue< NetMessage* > m_unsentReliables;
-	std::queue< NetMessage* > m_sentReliables; //NetMessage receives no reliableID until it migrates from m_unsent to here.
+	NetMessageRingQueue< MAX_RELIABLES > m_unsentReliables;
+	NetMessageRingQueue< RELIABLE_WINDOW_SIZE > m_sentReliables; //NetMessage receives no reliableID until it migrates from m_unsent to here.
 	
+	//----//Receiving In-Order Traffic
+	ObjectPool< NetMessage > m_outOfOrderReceivedPool; //Kept apart from m_reliablesPool, so a burst of early arrivals can't starve our sends.
+
 	//----//Receiving Reliable Traffic (IDs)
-	std::vector<uint16_t> m_receivedReliableIDs;
-	uint16_t m_nextExpectedReliableID; //We can tolerate this being exceeded up to this + MAX_RELIABLE_RANGE.
-		//Works like the ack -- nextExpectedReliableID is one above our oldest one we could possibly have (i.e. sliding window upper bound).
+	std::bitset< RELIABLE_WINDOW_SIZE > m_receivedReliableIDs; //Only meaningful for the RELIABLE_WINDOW_SIZE IDs below m_nextExpectedReliableID.
+	uint16_t m_nextExpectedReliableID; //We can tolerate this being exceeded up to this + RELIABLE_RANGE_RADIUS.
+		//Works like the ack -- nextExpectedReliableID is one above the highest one we've received (i.e. sliding window upper bound).
 
-	//-----------------------------------------------------------------------------//In-Order Channels (for now just one)
-	InOrderChannelData m_channelData;
+	//-----------------------------------------------------------------------------//In-Order Channels
+	InOrderChannelData m_channels[ MAX_INORDER_CHANNELS ]; //Indexed by NetMessage::GetInOrderChannel.
+	FragmentReassemblyData m_fragmentReassembly;
 };
@@ -1,28 +1,160 @@
 #include "Engine/Networking/NetConnectionUtils.hpp"
 #include "Engine/Networking/NetMessage.hpp"
+#include "Engine/Math/MathUtils.hpp"
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool InOrderChannelData::StoreOutOfOrderMessage( NetMessage* msg )
+{
+	uint16_t distanceAhead = msg->GetSequenceID() - nextExpectedSequenceID;
+	if ( ( distanceAhead == 0 ) || ( distanceAhead >= INORDER_CHANNEL_WINDOW_SIZE ) )
+		return false; //The expected one should be processed rather than stored, and anything farther would lap the ring.
+
+	NetMessage*& slot = outOfOrderReceivedSequencedMessages[ msg->GetSequenceID() % INORDER_CHANNEL_WINDOW_SIZE ];
+	if ( slot != nullptr )
+		return false; //Only one sequenceID in the window maps here, so it's a duplicate.
+
+	slot = msg;
+	return true;
+}
 
 
 //--------------------------------------------------------------------------------------------------------------
 NetMessage* InOrderChannelData::FindAndRemoveMessageForSequenceID( uint16_t sid )
 {
-	for ( auto msgIter = outOfOrderReceivedSequencedMessages.begin(); msgIter != outOfOrderReceivedSequencedMessages.end(); ++msgIter )
+	NetMessage*& slot = outOfOrderReceivedSequencedMessages[ sid % INORDER_CHANNEL_WINDOW_SIZE ];
+	NetMessage* msg = slot;
+	if ( ( msg == nullptr ) || ( msg->GetSequenceID() != sid ) )
+		return nullptr;
+
+	slot = nullptr;
+	return msg;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+NetClockSync::NetClockSync()
+	: m_nextSampleIndex( 0 )
+	, m_numSamples( 0 )
+	, m_lastRequestSentSeconds( -1.0 )
+	, m_fitLocalSeconds( 0.0 )
+	, m_offsetSeconds( 0.0 )
+	, m_drift( 0.0 )
+	, m_bestRTTSeconds( -1.0 )
+	, m_hasPendingResponse( false )
+	, m_pendingRequestSentSeconds( 0.0 )
+	, m_pendingRequestReceivedSeconds( 0.0 )
+{
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool NetClockSync::IsRequestDue( double nowSeconds ) const
+{
+	if ( m_lastRequestSentSeconds < 0.0 )
+		return true;
+
+	double interval = ( m_numSamples < CLOCK_SYNC_MIN_SAMPLES_FOR_DRIFT ) ? CLOCK_SYNC_FAST_INTERVAL_SECONDS : CLOCK_SYNC_INTERVAL_SECONDS;
+	return ( ( nowSeconds - m_lastRequestSentSeconds ) >= interval );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetClockSync::AddSample( double requestSentSeconds, double requestReceivedSeconds, double responseSentSeconds, double responseReceivedSeconds )
+{
+	double rttSeconds = ( responseReceivedSeconds - requestSentSeconds ) - ( responseSentSeconds - requestReceivedSeconds );
+	if ( rttSeconds < 0.0 )
+		return; //Only a mangled or misordered response gets here.
+
+	ClockSyncSample& sample = m_samples[ m_nextSampleIndex ];
+	sample.localSeconds = responseReceivedSeconds;
+	sample.offsetSeconds = ( ( requestReceivedSeconds - requestSentSeconds ) + ( responseSentSeconds - responseReceivedSeconds ) ) * .5;
+	sample.rttSeconds = rttSeconds;
+
+	m_nextSampleIndex = ( m_nextSampleIndex + 1 ) % CLOCK_SYNC_MAX_SAMPLES;
+	if ( m_numSamples < CLOCK_SYNC_MAX_SAMPLES )
+		++m_numSamples;
+
+	UpdateEstimate();
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetClockSync::UpdateEstimate()
+{
+	m_bestRTTSeconds = m_samples[ 0 ].rttSeconds;
+	for ( int sampleIndex = 1; sampleIndex < m_numSamples; sampleIndex++ )
+		m_bestRTTSeconds = GetMin( m_bestRTTSeconds, m_samples[ sampleIndex ].rttSeconds );
+
+	//Least-squares line through the samples with the quickest round trips, offset against local time, whose slope is the drift.
+	double sumLocal = 0.0;
+	double sumOffset = 0.0;
+	int numFit = 0;
+	for ( int sampleIndex = 0; sampleIndex < m_numSamples; sampleIndex++ )
+	{
+		const ClockSyncSample& sample = m_samples[ sampleIndex ];
+		if ( sample.rttSeconds > ( m_bestRTTSeconds + CLOCK_SYNC_RTT_SLACK_SECONDS ) )
+			continue;
+
+		sumLocal += sample.localSeconds;
+		sumOffset += sample.offsetSeconds;
+		++numFit;
+	}
+
+	m_fitLocalSeconds = sumLocal / numFit; //At least the best sample always makes it in.
+	m_offsetSeconds = sumOffset / numFit;
+	m_drift = 0.0;
+	if ( numFit < CLOCK_SYNC_MIN_SAMPLES_FOR_DRIFT )
+		return;
+
+	double covariance = 0.0;
+	double variance = 0.0;
+	for ( int sampleIndex = 0; sampleIndex < m_numSamples; sampleIndex++ )
 	{
-		NetMessage* msg = *msgIter;
-		ASSERT_RECOVERABLE( msg != nullptr, "Unexpected nullptr in FindAndRemoveMessageForSequenceID." );
-
-		if ( msg->GetSequenceID() == sid )
-		{
-			outOfOrderReceivedSequencedMessages.erase( msgIter );
-			return msg;
-		}
+		const ClockSyncSample& sample = m_samples[ sampleIndex ];
+		if ( sample.rttSeconds > ( m_bestRTTSeconds + CLOCK_SYNC_RTT_SLACK_SECONDS ) )
+			continue;
+
+		double localFromMean = sample.localSeconds - m_fitLocalSeconds;
+		covariance += localFromMean * ( sample.offsetSeconds - m_offsetSeconds );
+		variance += localFromMean * localFromMean;
 	}
 
-	return nullptr;
+	if ( variance > 0.0 )
+		m_drift = GetMax( -CLOCK_SYNC_MAX_DRIFT, GetMin( covariance / variance, CLOCK_SYNC_MAX_DRIFT ) );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+double NetClockSync::GetRemoteTimeSeconds( double localSeconds ) const
+{
+	if ( !HasEstimate() )
+		return localSeconds;
+
+	return localSeconds + m_offsetSeconds + ( m_drift * ( localSeconds - m_fitLocalSeconds ) );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+uint32_t GetWireMilliseconds( double seconds )
+{
+	return (uint32_t)(uint64_t)( seconds * 1000.0 ); //Through uint64_t, so it wraps rather than overflows.
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+double UnwrapWireMilliseconds( uint32_t wireMilliseconds, double nearbySeconds )
+{
+	uint64_t nearbyMilliseconds = (uint64_t)( nearbySeconds * 1000.0 );
+	int32_t millisecondsPastNearby = (int32_t)( wireMilliseconds - (uint32_t)nearbyMilliseconds ); //Signed, so a stamp from just before comes out negative, not ~49 days on.
+	return ( (double)nearbyMilliseconds + millisecondsPastNearby ) * .001;
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
-bool InOrderMessageComparator::operator()( const NetMessage* a, const NetMessage* b ) const
+void NetClockSync::SetPendingResponse( double requestSentSeconds, double requestReceivedSeconds )
 {
-	return UnsignedLessThan( a->GetSequenceID(), b->GetSequenceID() );
+	m_hasPendingResponse = true; //Replaces any still unanswered, only the newest is worth a sample.
+	m_pendingRequestSentSeconds = requestSentSeconds;
+	m_pendingRequestReceivedSeconds = requestReceivedSeconds;
 }
@@ -1,9 +1,22 @@
 #pragma once
 #include <stdint.h>
-#include <set>
 #include "Engine/Networking/NetSystem.hpp"
 
 
+//-----------------------------------------------------------------------------
+#define MAX_INORDER_CHANNELS		(4) //Independent sequences, so a lost message only stalls the in-order messages on its own channel.
+#define INORDER_CHANNEL_WINDOW_SIZE	(1024) //Out-of-order slots per channel, keyed by sequenceID % this. At least RELIABLE_RANGE_RADIUS,
+	//since no more reliables than that are ever unconfirmed at once, and a power of two so keying survives the uint16_t wrapping.
+#define FRAGMENT_INORDER_CHANNEL	( MAX_INORDER_CHANNELS - 1 ) //Reserved for NETMSG_FRAGMENT, so don't register game messages on it.
+#define CLOCK_SYNC_INTERVAL_SECONDS			( 1.0 ) //Between requests once synced.
+#define CLOCK_SYNC_FAST_INTERVAL_SECONDS	( .1 ) //Until CLOCK_SYNC_MIN_SAMPLES_FOR_DRIFT arrive, so a new client is synced within its first second.
+#define CLOCK_SYNC_MAX_SAMPLES				(16) //Window the offset and drift are fit over, i.e. about the last 16 seconds.
+#define CLOCK_SYNC_MIN_SAMPLES_FOR_DRIFT	(4)
+#define CLOCK_SYNC_RTT_SLACK_SECONDS		( .005 ) //Samples whose round trip ran this far past the window's best are left out of the fit.
+	//An asymmetric delay skews a sample's offset by up to half its round trip, and the quickest round trips have the least room for that.
+#define CLOCK_SYNC_MAX_DRIFT				( .001 ) //Seconds per second. Real clocks drift by parts per million, anything past this is noise.
+
+
 //-----------------------------------------------------------------------------
 class NetMessage;
 
@@ -13,6 +26,8 @@ extern bool UnsignedGreaterThan( uint16_t a, uint16_t b );
 extern bool UnsignedGreaterThanOrEqual( uint16_t a, uint16_t b );
 extern bool UnsignedLessThan( uint16_t a, uint16_t b );
 extern bool UnsignedLessThanOrEqual( uint16_t a, uint16_t b );
+extern uint32_t GetWireMilliseconds( double seconds ); //A GetCurrentTimeSeconds-style time as 32 bits of ms, wrapping after ~49 days.
+extern double UnwrapWireMilliseconds( uint32_t wireMilliseconds, double nearbySeconds ); //Back to seconds, given a time on the same clock within ~24 days of it.
 
 
 //-----------------------------------------------------------------------------
@@ -24,13 +39,6 @@ struct UnsignedComparator
 };
 
 
-//-----------------------------------------------------------------------------
-struct InOrderMessageComparator
-{
-	bool operator() ( const NetMessage* a, const NetMessage* b ) const;
-};
-
-
 //-----------------------------------------------------------------------------
 struct InOrderChannelData
 {
@@ -38,6 +46,7 @@ struct InOrderChannelData
 		: nextSentSequenceID( 0 )
 		, nextExpectedSequenceID( 0 )
 	{
+		memset( outOfOrderReceivedSequencedMessages, 0, sizeof( outOfOrderReceivedSequencedMessages ) );
 	}
 
 	//Sending side:
@@ -47,9 +56,122 @@ struct InOrderChannelData
 	//Receiving side:
 	uint16_t nextExpectedSequenceID/*ToBeReceived*/;
 
-	NetMessage* FindAndRemoveMessageForSequenceID( uint16_t sid );
-	std::set<NetMessage*, InOrderMessageComparator > outOfOrderReceivedSequencedMessages/*ToBeReceived*/;
-		//C4 uses an in-place linked list for this, putting next and prev pointers on NetMessage* for this.
+	bool StoreOutOfOrderMessage( NetMessage* msg ); //False if it's outside the window or a duplicate, in which case the caller still owns msg.
+	NetMessage* FindAndRemoveMessageForSequenceID( uint16_t sid ); //Null if it hasn't arrived yet.
+	NetMessage* outOfOrderReceivedSequencedMessages/*ToBeReceived*/[ INORDER_CHANNEL_WINDOW_SIZE ]; //Ring keyed by sequenceID, no searching.
+};
+
+
+//-----------------------------------------------------------------------------
+struct FragmentReassemblyData //Fragments arrive in order on their own channel, so only one message is ever being put back together.
+{
+	FragmentReassemblyData()
+		: buffer( nullptr )
+		, numBytesReceived( 0 )
+		, msgTypeID( 0 )
+		, numFragmentsExpected( 0 )
+		, nextFragmentIndex( 0 )
+	{
+	}
+	~FragmentReassemblyData() { delete[] buffer; }
+
+	bool IsInProgress() const { return ( numFragmentsExpected > 0 ); }
+	void Reset() { numBytesReceived = 0; numFragmentsExpected = 0; nextFragmentIndex = 0; } //Keeps the buffer for next time.
+
+	byte_t* buffer; //MAX_FRAGMENTED_MESSAGE_SIZE, allocated the first time a fragment arrives.
+	size_t numBytesReceived;
+	uint8_t msgTypeID; //Of the message being reassembled.
+	uint16_t numFragmentsExpected;
+	uint16_t nextFragmentIndex;
+};
+
+
+//-----------------------------------------------------------------------------
+struct ClockSyncSample
+{
+	double localSeconds; //When the response arrived.
+	double offsetSeconds; //Their clock minus ours.
+	double rttSeconds; //Excluding however long they held the request.
+};
+
+
+//-----------------------------------------------------------------------------
+class NetClockSync //NTP-style offset and drift estimate of the other side's GetCurrentTimeSeconds, cf. NetConnection::GetRemoteTimeSeconds.
+{
+public:
+	NetClockSync();
+
+	//Requesting side:
+	bool IsRequestDue( double nowSeconds ) const;
+	void MarkRequestSent( double nowSeconds ) { m_lastRequestSentSeconds = nowSeconds; }
+	void AddSample( double requestSentSeconds, double requestReceivedSeconds, double responseSentSeconds, double responseReceivedSeconds ); //t0 to t3.
+	bool HasEstimate() const { return ( m_numSamples > 0 ); }
+	double GetRemoteTimeSeconds( double localSeconds ) const; //Just ours if there's no estimate yet.
+	double GetOffsetSeconds( double localSeconds ) const { return GetRemoteTimeSeconds( localSeconds ) - localSeconds; }
+	double GetDrift() const { return m_drift; }
+	double GetBestRTTSeconds() const { return m_bestRTTSeconds; }
+
+	//Responding side, answered with the next packet so the time they're held counts toward neither side's round trip:
+	bool HasPendingResponse() const { return m_hasPendingResponse; }
+	void SetPendingResponse( double requestSentSeconds, double requestReceivedSeconds );
+	void ClearPendingResponse() { m_hasPendingResponse = false; }
+	double GetPendingRequestSentSeconds() const { return m_pendingRequestSentSeconds; }
+	double GetPendingRequestReceivedSeconds() const { return m_pendingRequestReceivedSeconds; }
+
+
+private:
+	void UpdateEstimate();
+
+	ClockSyncSample m_samples[ CLOCK_SYNC_MAX_SAMPLES ];
+	int m_nextSampleIndex;
+	int m_numSamples;
+	double m_lastRequestSentSeconds;
+
+	//Fit over the samples by UpdateEstimate, offset at a local time is m_offsetSeconds + m_drift * ( time - m_fitLocalSeconds ).
+	double m_fitLocalSeconds;
+	double m_offsetSeconds;
+	double m_drift;
+	double m_bestRTTSeconds;
+
+	bool m_hasPendingResponse;
+	double m_pendingRequestSentSeconds; //Their clock.
+	double m_pendingRequestReceivedSeconds; //Ours.
+};
+
+
+//-----------------------------------------------------------------------------
+template < size_t CAPACITY >
+class NetMessageRingQueue //Fixed-capacity FIFO, so queuing reliables never allocates nodes like std::queue.
+{
+public:
+	NetMessageRingQueue() : m_frontIndex( 0 ), m_numQueued( 0 ) {}
+
+	bool IsEmpty() const { return ( m_numQueued == 0 ); }
+	bool IsFull() const { return ( m_numQueued == CAPACITY ); }
+	size_t GetSize() const { return m_numQueued; }
+	NetMessage* Front() const { return m_slots[ m_frontIndex ]; }
+
+	bool Push( NetMessage* msg )
+	{
+		if ( IsFull() )
+			return false;
+
+		m_slots[ ( m_frontIndex + m_numQueued ) % CAPACITY ] = msg;
+		++m_numQueued;
+		return true;
+	}
+
+	void Pop()
+	{
+		m_frontIndex = ( m_frontIndex + 1 ) % CAPACITY;
+		--m_numQueued;
+	}
+
+
+private:
+	NetMessage* m_slots[ CAPACITY ];
+	size_t m_frontIndex;
+	size_t m_numQueued;
 };
 
 
@@ -58,7 +180,7 @@ struct NetConnectionInfo
 {
 	sockaddr_in		address;
 	char			guid[ MAX_GUID_LENGTH ];
-	uint8_t			connectionIndex/*WithinSession*/; //Identifies locally to this session of the game which objects the connection corresponds to.
+	NetConnectionIndex	connectionIndex/*WithinSession*/; //Identifies locally to this session of the game which objects the connection corresponds to.
 };
 
 
@@ -0,0 +1,530 @@
+#include "Engine/Networking/NetLoadTest.hpp"
+
+
+#include "Engine/EngineCommon.hpp"
+#include "Engine/Core/TheEventSystem.hpp"
+#include "Engine/Core/TheConsole.hpp"
+#include "Engine/Core/Command.hpp"
+#include "Engine/Networking/NetSender.hpp"
+#include "Engine/Math/MathUtils.hpp"
+#include "Engine/Time/Time.hpp"
+#include <algorithm>
+
+
+//--------------------------------------------------------------------------------------------------------------
+STATIC NetLoadTest* NetLoadTest::s_theLoadTest = nullptr;
+static const float LOADTEST_WORLD_HALF_EXTENT = 25.f; //Objects bounce around inside this square, only so updates change.
+
+
+//--------------------------------------------------------------------------------------------------------------
+NetLoadTest::NetLoadTest()
+	: m_host( nullptr )
+	, m_nextObjectID( 0 )
+	, m_numObjectsWanted( 0 )
+	, m_secondsRemaining( 0.f )
+	, m_runsUntilStopped( false )
+	, m_objectChurnAccumulator( 0.f )
+	, m_secondsSinceReport( 0.f )
+	, m_bytesSentAtReport( 0 )
+	, m_bytesReceivedAtReport( 0 )
+	, m_reliablesResentAtReport( 0 )
+	, m_numChurnsSinceReport( 0 )
+{
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+STATIC NetLoadTest* NetLoadTest::Instance()
+{
+	if ( s_theLoadTest == nullptr )
+		s_theLoadTest = new NetLoadTest();
+
+	return s_theLoadTest;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+#pragma region Console Commands
+static void NetLoadTestStart( Command& args )
+{
+	if ( NetLoadTest::Instance()->IsRunning() )
+	{
+		g_theConsole->Printf( "Load test already running, use NetLoadTestStop first." );
+		return;
+	}
+
+	int numBots;
+	float durationSeconds;
+	int numObjects;
+	bool hasBots = args.GetNextInt( &numBots, 0 );
+	args.GetNextFloat( &durationSeconds, 0.f );
+	args.GetNextInt( &numObjects, LOADTEST_DEFAULT_NUM_OBJECTS );
+	if ( !hasBots || ( numBots <= 0 ) || ( numObjects < 0 ) )
+	{
+		g_theConsole->Printf( "Incorrect arguments." );
+		g_theConsole->Printf( "Usage: NetLoadTestStart <numBots> [durationSeconds, 0 to run until stopped] [numObjects]" );
+		return;
+	}
+
+	if ( !NetLoadTest::Instance()->Start( numBots, durationSeconds, numObjects ) )
+		g_theConsole->Printf( "NetLoadTestStart failed, see log." );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+static void NetLoadTestStop( Command& )
+{
+	if ( NetLoadTest::Instance()->IsRunning() )
+		NetLoadTest::Instance()->Stop();
+	else
+		g_theConsole->Printf( "No load test running." );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+static void NetLoadTestReport( Command& )
+{
+	if ( NetLoadTest::Instance()->IsRunning() )
+		NetLoadTest::Instance()->PrintReport();
+	else
+		g_theConsole->Printf( "No load test running." );
+}
+#pragma endregion
+
+
+//--------------------------------------------------------------------------------------------------------------
+STATIC void NetLoadTest::RegisterConsoleCommands()
+{
+	g_theConsole->RegisterCommand( "NetLoadTestStart", NetLoadTestStart );
+	g_theConsole->RegisterCommand( "NetLoadTestStop", NetLoadTestStop );
+	g_theConsole->RegisterCommand( "NetLoadTestReport", NetLoadTestReport );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+#pragma region Message Handlers
+static void OnLoadTestInputReceived( const NetSender& from, NetMessage& inputMsg )
+{
+	NetLoadTest::Instance()->OnInputReceived( from, inputMsg );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+static void OnLoadTestInputEchoReceived( const NetSender& from, NetMessage& echoMsg )
+{
+	NetLoadTest::Instance()->OnInputEchoReceived( from, echoMsg );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+static void OnLoadTestObjectMessageReceived( const NetSender&, NetMessage& objectMsg )
+{
+	//Bots keep no world, reading it through is enough to exercise receiving it.
+	uint16_t objectID;
+	objectMsg.Read<uint16_t>( &objectID );
+
+	if ( objectMsg.GetTypeID() != NETMSG_LOADTEST_OBJECT_DESTROY )
+	{
+		Vector2f position;
+		objectMsg.Read<float>( &position.x );
+		objectMsg.Read<float>( &position.y );
+	}
+}
+#pragma endregion
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetLoadTest::OnInputReceived( const NetSender& from, NetMessage& inputMsg )
+{
+	if ( ( from.ourSession != m_host ) || ( from.sourceConnection == nullptr ) )
+		return;
+
+	double sentSeconds;
+	float moveX;
+	float moveY;
+	uint8_t buttons;
+	inputMsg.Read<double>( &sentSeconds );
+	inputMsg.Read<float>( &moveX );
+	inputMsg.Read<float>( &moveY );
+	inputMsg.Read<uint8_t>( &buttons );
+
+	NetMessage echoMsg( NETMSG_LOADTEST_INPUT_ECHO );
+	echoMsg.Write<double>( sentSeconds );
+	from.sourceConnection->SendMessageToThem( echoMsg );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetLoadTest::OnInputEchoReceived( const NetSender&, NetMessage& echoMsg )
+{
+	double sentSeconds;
+	if ( !echoMsg.Read<double>( &sentSeconds ) )
+		return;
+
+	//Same process, same clock, so no offset to correct for.
+	m_latencySamplesMs.push_back( (float)( ( GetCurrentTimeSeconds() - sentSeconds ) * 1000.0 ) );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetLoadTest::RegisterLoadTestMessages( NetSession* session )
+{
+	session->RegisterMessage( NETMSG_LOADTEST_BOT_INPUT, "LoadTest_BotInput", OnLoadTestInputReceived, NETMSGCTRL_PROCESSED_INORDER, NETMSGOPT_RELIABLE, LOADTEST_INORDER_CHANNEL );
+	session->RegisterMessage( NETMSG_LOADTEST_INPUT_ECHO, "LoadTest_InputEcho", OnLoadTestInputEchoReceived, NETMSGCTRL_PROCESSED_INORDER, NETMSGOPT_RELIABLE, LOADTEST_INORDER_CHANNEL );
+	session->RegisterMessage( NETMSG_LOADTEST_OBJECT_CREATE, "LoadTest_ObjectCreate", OnLoadTestObjectMessageReceived, NETMSGCTRL_PROCESSED_INORDER, NETMSGOPT_RELIABLE, LOADTEST_INORDER_CHANNEL );
+	session->RegisterMessage( NETMSG_LOADTEST_OBJECT_DESTROY, "LoadTest_ObjectDestroy", OnLoadTestObjectMessageReceived, NETMSGCTRL_PROCESSED_INORDER, NETMSGOPT_RELIABLE, LOADTEST_INORDER_CHANNEL );
+	session->RegisterMessage( NETMSG_LOADTEST_OBJECT_UPDATE, "LoadTest_ObjectUpdate", OnLoadTestObjectMessageReceived, NETMSGCTRL_NONE, NETMSGOPT_REPLACEABLE, 0, NETMSG_PRIORITY_LOW );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool NetLoadTest::Start( int numBots, float durationSeconds, int numObjects )
+{
+	if ( IsRunning() )
+		return false;
+
+	if ( numBots + 1 > MAX_CONNECTIONS )
+	{
+		LogAndShowPrintfWithTag( "NetLoadTest", "Cannot exceed %d bots.", MAX_CONNECTIONS - 1 );
+		return false;
+	}
+
+	m_host = new NetSession( "NetLoadTestHost" );
+	RegisterLoadTestMessages( m_host );
+	if ( !m_host->Start( LOADTEST_PORT, numBots + 1 ) || !m_host->Host( "LoadTestHost" ) || !m_host->StartListening() )
+	{
+		LogAndShowPrintfWithTag( "NetLoadTest", "Host session failed to start." );
+		ShutdownSession( m_host );
+		m_host = nullptr;
+		return false;
+	}
+
+	TheEventSystem::Instance()->RegisterEvent< NetLoadTest, &NetLoadTest::OnNetworkTick_Handler >( "OnNetworkTick", this );
+	TheEventSystem::Instance()->RegisterEvent< NetLoadTest, &NetLoadTest::OnConnectionJoined_Handler >( "OnConnectionJoined", this );
+
+	sockaddr_in hostAddr;
+	m_host->GetAddressObject( &hostAddr );
+	uint16_t nextPort = ntohs( hostAddr.sin_port ) + 1;
+
+	for ( int botIndex = 0; botIndex < numBots; botIndex++ )
+	{
+		NetLoadTestBot bot;
+		bot.session = new NetSession( "NetLoadTestBot" );
+		sprintf_s( bot.username, MAX_GUID_LENGTH, "Bot%d", botIndex );
+		bot.secondsUntilChurn = GetRandomFloatInRange( 0.f, 2.f * LOADTEST_MEAN_SECONDS_BETWEEN_BOT_CHURN );
+		RegisterLoadTestMessages( bot.session );
+
+		if ( !bot.session->Start( nextPort, 2 ) )
+		{
+			LogAndShowPrintfWithTag( "NetLoadTest", "Bot %d failed to start, continuing with %d bots.", botIndex, botIndex );
+			ShutdownSession( bot.session );
+			break;
+		}
+
+		sockaddr_in botAddr;
+		bot.session->GetAddressObject( &botAddr );
+		nextPort = ntohs( botAddr.sin_port ) + 1; //Past wherever its port scan landed.
+
+		bot.session->Join( bot.username, hostAddr );
+		m_bots.push_back( bot );
+	}
+
+	m_numObjectsWanted = numObjects;
+	m_nextObjectID = 0;
+	m_objectChurnAccumulator = 0.f;
+	m_runsUntilStopped = ( durationSeconds <= 0.f );
+	m_secondsRemaining = durationSeconds;
+
+	m_secondsSinceReport = 0.f;
+	m_latencySamplesMs.clear();
+	m_frameSamplesMs.clear();
+	m_bytesSentAtReport = 0;
+	m_bytesReceivedAtReport = 0;
+	m_reliablesResentAtReport = 0;
+	m_numChurnsSinceReport = 0;
+
+	LogAndShowPrintfWithTag( "NetLoadTest", "Started with %u bots and %d objects, reporting every %.0f seconds.", m_bots.size(), numObjects, LOADTEST_REPORT_SECONDS );
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetLoadTest::Stop()
+{
+	if ( !IsRunning() )
+		return;
+
+	PrintReport();
+
+	TheEventSystem::Instance()->UnregisterSubscriber< NetLoadTest, &NetLoadTest::OnNetworkTick_Handler >( "OnNetworkTick", this );
+	TheEventSystem::Instance()->UnregisterSubscriber< NetLoadTest, &NetLoadTest::OnConnectionJoined_Handler >( "OnConnectionJoined", this );
+
+	for each ( const NetLoadTestBot& bot in m_bots )
+		ShutdownSession( bot.session );
+	m_bots.clear();
+
+	ShutdownSession( m_host );
+	m_host = nullptr;
+	m_objects.clear();
+
+	LogAndShowPrintfWithTag( "NetLoadTest", "Stopped." );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetLoadTest::ShutdownSession( NetSession* session )
+{
+	if ( session->IsRunning() )
+	{
+		if ( session->IsInConnectedState() )
+			session->Leave();
+
+		EngineEvent shutdownEv( "OnNetSessionShutdown", session ); //Other sessions, e.g. the game's, are left running.
+		TheEventSystem::Instance()->TriggerEvent( "OnNetSessionShutdown", &shutdownEv );
+	}
+
+	delete session;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool NetLoadTest::IsOurSession( NetSession* session ) const
+{
+	if ( session == m_host )
+		return true;
+
+	for each ( const NetLoadTestBot& bot in m_bots )
+		if ( bot.session == session )
+			return true;
+
+	return false;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetLoadTest::Update( float deltaSeconds )
+{
+	double frameStartSeconds = GetCurrentTimeSeconds();
+
+	UpdateObjects( deltaSeconds );
+	UpdateBotChurn( deltaSeconds );
+
+	m_host->SessionUpdate( deltaSeconds );
+	for each ( const NetLoadTestBot& bot in m_bots )
+		bot.session->SessionUpdate( deltaSeconds );
+
+	m_frameSamplesMs.push_back( (float)( ( GetCurrentTimeSeconds() - frameStartSeconds ) * 1000.0 ) );
+
+	m_secondsSinceReport += deltaSeconds;
+	if ( m_secondsSinceReport >= LOADTEST_REPORT_SECONDS )
+		PrintReport();
+
+	if ( !m_runsUntilStopped )
+	{
+		m_secondsRemaining -= deltaSeconds;
+		if ( m_secondsRemaining <= 0.f )
+			Stop();
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetLoadTest::UpdateObjects( float deltaSeconds )
+{
+	while ( (int)m_objects.size() < m_numObjectsWanted )
+		CreateObject();
+
+	m_objectChurnAccumulator += LOADTEST_OBJECT_CHURN_PER_SECOND * deltaSeconds;
+	while ( ( m_objectChurnAccumulator >= 1.f ) && !m_objects.empty() )
+	{
+		DestroyObject( GetRandomIntLessThan( (int)m_objects.size() ) );
+		CreateObject();
+		m_objectChurnAccumulator -= 1.f;
+	}
+
+	for each ( NetLoadTestObject& obj in m_objects )
+	{
+		obj.position += obj.velocity * deltaSeconds;
+
+		if ( ( obj.position.x < -LOADTEST_WORLD_HALF_EXTENT ) || ( obj.position.x > LOADTEST_WORLD_HALF_EXTENT ) )
+			obj.velocity.x = -obj.velocity.x;
+		if ( ( obj.position.y < -LOADTEST_WORLD_HALF_EXTENT ) || ( obj.position.y > LOADTEST_WORLD_HALF_EXTENT ) )
+			obj.velocity.y = -obj.velocity.y;
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetLoadTest::CreateObject()
+{
+	NetLoadTestObject obj;
+	obj.id = m_nextObjectID++;
+	obj.position = Vector2f( GetRandomFloatInRange( -LOADTEST_WORLD_HALF_EXTENT, LOADTEST_WORLD_HALF_EXTENT ), GetRandomFloatInRange( -LOADTEST_WORLD_HALF_EXTENT, LOADTEST_WORLD_HALF_EXTENT ) );
+	obj.velocity = Vector2f( GetRandomFloatInRange( -5.f, 5.f ), GetRandomFloatInRange( -5.f, 5.f ) );
+	m_objects.push_back( obj );
+
+	NetMessage createMsg( NETMSG_LOADTEST_OBJECT_CREATE );
+	createMsg.Write<uint16_t>( obj.id );
+	createMsg.Write<float>( obj.position.x );
+	createMsg.Write<float>( obj.position.y );
+	m_host->SendToAllConnections( createMsg );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetLoadTest::DestroyObject( int objectIndex )
+{
+	NetMessage destroyMsg( NETMSG_LOADTEST_OBJECT_DESTROY );
+	destroyMsg.Write<uint16_t>( m_objects[ objectIndex ].id );
+	m_host->SendToAllConnections( destroyMsg );
+
+	m_objects[ objectIndex ] = m_objects.back();
+	m_objects.pop_back();
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetLoadTest::UpdateBotChurn( float deltaSeconds )
+{
+	sockaddr_in hostAddr;
+	m_host->GetAddressObject( &hostAddr );
+
+	for each ( NetLoadTestBot& bot in m_bots )
+	{
+		bot.secondsUntilChurn -= deltaSeconds;
+		if ( bot.secondsUntilChurn > 0.f )
+			continue;
+
+		if ( bot.session->IsInJoiningState() )
+			continue; //Let the join resolve first, it times out on its own.
+
+		if ( bot.session->IsInConnectedState() )
+			bot.session->Leave();
+		else
+			bot.session->Join( bot.username, hostAddr );
+
+		bot.secondsUntilChurn = GetRandomFloatInRange( 0.f, 2.f * LOADTEST_MEAN_SECONDS_BETWEEN_BOT_CHURN );
+		++m_numChurnsSinceReport;
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool NetLoadTest::OnNetworkTick_Handler( EngineEvent* eventContext )
+{
+	NetConnection* conn = dynamic_cast<EngineEventNetworked*>( eventContext )->connection;
+	if ( ( conn == nullptr ) || conn->IsMe() || !IsOurSession( conn->GetSession() ) )
+		return SHOULD_NOT_UNSUB;
+
+	NetSession* session = conn->GetSession();
+	if ( session == m_host )
+	{
+		for each ( const NetLoadTestObject& obj in m_objects )
+		{
+			NetMessage updateMsg( NETMSG_LOADTEST_OBJECT_UPDATE );
+			updateMsg.SetReplacementKey( obj.id );
+			updateMsg.Write<uint16_t>( obj.id );
+			updateMsg.Write<float>( obj.position.x );
+			updateMsg.Write<float>( obj.position.y );
+			conn->SendMessageToThem( updateMsg );
+		}
+	}
+	else if ( ( conn == session->GetHostConnection() ) && session->IsInConnectedState() )
+	{
+		NetMessage inputMsg( NETMSG_LOADTEST_BOT_INPUT );
+		inputMsg.Write<double>( GetCurrentTimeSeconds() );
+		inputMsg.Write<float>( GetRandomFloatInRange( -1.f, 1.f ) );
+		inputMsg.Write<float>( GetRandomFloatInRange( -1.f, 1.f ) );
+		inputMsg.Write<uint8_t>( (uint8_t)GetRandomIntLessThan( 256 ) );
+		conn->SendMessageToThem( inputMsg );
+	}
+
+	return SHOULD_NOT_UNSUB;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool NetLoadTest::OnConnectionJoined_Handler( EngineEvent* eventContext )
+{
+	NetConnection* conn = dynamic_cast<EngineEventNetworked*>( eventContext )->connection;
+	if ( ( conn == nullptr ) || conn->IsMe() || ( conn->GetSession() != m_host ) )
+		return SHOULD_NOT_UNSUB;
+
+	for each ( const NetLoadTestObject& obj in m_objects )
+	{
+		NetMessage createMsg( NETMSG_LOADTEST_OBJECT_CREATE );
+		createMsg.Write<uint16_t>( obj.id );
+		createMsg.Write<float>( obj.position.x );
+		createMsg.Write<float>( obj.position.y );
+		conn->SendMessageToThem( createMsg );
+	}
+
+	return SHOULD_NOT_UNSUB;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+uint32_t NetLoadTest::GetTotalReliablesResent() const
+{
+	uint32_t total = m_host->GetNumReliablesResent();
+	for each ( const NetLoadTestBot& bot in m_bots )
+		total += bot.session->GetNumReliablesResent();
+
+	return total;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+static float GetPercentile( const std::vector< float >& sortedSamples, float percentile01 )
+{
+	if ( sortedSamples.empty() )
+		return 0.f;
+
+	size_t sampleIndex = (size_t)( percentile01 * ( sortedSamples.size() - 1 ) + .5f );
+	return sortedSamples[ sampleIndex ];
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetLoadTest::PrintReport()
+{
+	float seconds = ( m_secondsSinceReport > 0.f ) ? m_secondsSinceReport : 1.f;
+
+	uint64_t bytesSent = m_host->GetNumBytesSent();
+	uint64_t bytesReceived = m_host->GetNumBytesReceived();
+	for each ( const NetLoadTestBot& bot in m_bots )
+	{
+		bytesSent += bot.session->GetNumBytesSent();
+		bytesReceived += bot.session->GetNumBytesReceived();
+	}
+	uint32_t reliablesResent = GetTotalReliablesResent();
+
+	float avgFrameMs = 0.f;
+	float maxFrameMs = 0.f;
+	for each ( float frameMs in m_frameSamplesMs )
+	{
+		avgFrameMs += frameMs;
+		maxFrameMs = ( frameMs > maxFrameMs ) ? frameMs : maxFrameMs;
+	}
+	if ( !m_frameSamplesMs.empty() )
+		avgFrameMs /= m_frameSamplesMs.size();
+
+	std::sort( m_latencySamplesMs.begin(), m_latencySamplesMs.end() );
+
+	int numBotsConnected = m_host->GetNumConnected() - 1; //Less the host's own.
+	LogAndShowPrintfWithTag( "NetLoadTest", "Over %.1fs, %d/%u bots connected, %u objects, %d bot churns:",
+							 seconds, numBotsConnected, m_bots.size(), m_objects.size(), m_numChurnsSinceReport );
+	LogAndShowPrintfWithTag( "NetLoadTest", "  Session updates: avg %.3fms, max %.3fms per frame.", avgFrameMs, maxFrameMs );
+	LogAndShowPrintfWithTag( "NetLoadTest", "  Sent %.1f KB/s, received %.1f KB/s, %u reliables resent.",
+							 ( bytesSent - m_bytesSentAtReport ) / 1024.f / seconds, ( bytesReceived - m_bytesReceivedAtReport ) / 1024.f / seconds, reliablesResent - m_reliablesResentAtReport );
+	LogAndShowPrintfWithTag( "NetLoadTest", "  Input round trip over %u samples: p50 %.1fms, p90 %.1fms, p99 %.1fms, max %.1fms.", m_latencySamplesMs.size(),
+							 GetPercentile( m_latencySamplesMs, .5f ), GetPercentile( m_latencySamplesMs, .9f ), GetPercentile( m_latencySamplesMs, .99f ), GetPercentile( m_latencySamplesMs, 1.f ) );
+
+	m_secondsSinceReport = 0.f;
+	m_latencySamplesMs.clear();
+	m_frameSamplesMs.clear();
+	m_bytesSentAtReport = bytesSent;
+	m_bytesReceivedAtReport = bytesReceived;
+	m_reliablesResentAtReport = reliablesResent;
+	m_numChurnsSinceReport = 0;
+}
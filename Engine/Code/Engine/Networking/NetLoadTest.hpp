@@ -0,0 +1,98 @@
+#pragma once
+
+
+#include "Engine/Networking/NetSession.hpp"
+#include "Engine/Core/EngineEvent.hpp"
+#include "Engine/Math/Vector2.hpp"
+#include <vector>
+
+
+//-----------------------------------------------------------------------------
+#define LOADTEST_PORT (GAME_PORT + 2 * PORT_SCAN_RANGE) //Clear of where a running game session would scan to.
+#define LOADTEST_INORDER_CHANNEL (1)
+#define LOADTEST_REPORT_SECONDS (5.f)
+#define LOADTEST_DEFAULT_NUM_OBJECTS (32)
+#define LOADTEST_OBJECT_CHURN_PER_SECOND (4.f) //Destroy-and-recreate pairs, like NetObjects entering/leaving a client's view.
+#define LOADTEST_MEAN_SECONDS_BETWEEN_BOT_CHURN (20.f) //How long a bot stays before leaving, and the same again before rejoining.
+
+
+//-----------------------------------------------------------------------------
+enum NetLoadTestMessageType : uint8_t //Mirrors the shapes of the game's traffic, since TheGame and NetObjectSystem are one per process.
+{
+	NETMSG_LOADTEST_BOT_INPUT = NetCoreMessageType::MAX_CORE_NETMSG_TYPES, //Like PlayerController updates: reliable, in-order, every tick.
+	NETMSG_LOADTEST_INPUT_ECHO, //The host returns each input's timestamp, giving the bot a round trip through both reliable queues.
+	NETMSG_LOADTEST_OBJECT_CREATE, //Like NetObject creates and destroys: reliable, in-order, to everyone.
+	NETMSG_LOADTEST_OBJECT_DESTROY,
+	NETMSG_LOADTEST_OBJECT_UPDATE //Like NetObject update batches: unreliable, replaceable per object.
+};
+
+
+//-----------------------------------------------------------------------------
+struct NetLoadTestBot
+{
+	NetSession* session;
+	char username[ MAX_GUID_LENGTH ];
+	float secondsUntilChurn; //Leaves when it runs out if connected, rejoins if not.
+};
+
+
+//-----------------------------------------------------------------------------
+struct NetLoadTestObject
+{
+	uint16_t id;
+	Vector2f position;
+	Vector2f velocity;
+};
+
+
+//-----------------------------------------------------------------------------
+class NetLoadTest //Hosts and joins bot NetSessions over loopback in this process, and reports how the engine holds up.
+{
+public:
+	static NetLoadTest* /*CreateOrGet*/Instance();
+	static void RegisterConsoleCommands(); //Called in NetSystem::Startup.
+
+	bool Start( int numBots, float durationSeconds, int numObjects ); //Non-positive duration runs until Stop().
+	void Stop(); //Prints a final report.
+	bool IsRunning() const { return m_host != nullptr; }
+	void Update( float deltaSeconds ); //Called in TheEngine::Update, drives every session it made.
+	void PrintReport();
+
+	void OnInputReceived( const NetSender& from, NetMessage& inputMsg );
+	void OnInputEchoReceived( const NetSender& from, NetMessage& echoMsg );
+
+
+private:
+	NetLoadTest();
+	static NetLoadTest* s_theLoadTest;
+
+	void RegisterLoadTestMessages( NetSession* );
+	void ShutdownSession( NetSession* ); //Leaves if it can, then shuts down only that session, cf. NetSession::SessionShutdown_Handler.
+	bool IsOurSession( NetSession* ) const;
+	void UpdateObjects( float deltaSeconds );
+	void UpdateBotChurn( float deltaSeconds );
+	void CreateObject();
+	void DestroyObject( int objectIndex );
+	uint32_t GetTotalReliablesResent() const;
+
+	bool OnNetworkTick_Handler( EngineEvent* );
+	bool OnConnectionJoined_Handler( EngineEvent* ); //Catches a bot up on the host's objects.
+
+	NetSession* m_host;
+	std::vector< NetLoadTestBot > m_bots;
+	std::vector< NetLoadTestObject > m_objects;
+	uint16_t m_nextObjectID;
+	int m_numObjectsWanted;
+	float m_secondsRemaining;
+	bool m_runsUntilStopped;
+	float m_objectChurnAccumulator;
+
+	//Reset each report.
+	float m_secondsSinceReport;
+	std::vector< float > m_latencySamplesMs;
+	std::vector< float > m_frameSamplesMs;
+	uint64_t m_bytesSentAtReport; //Summed across every session, bots included.
+	uint64_t m_bytesReceivedAtReport;
+	uint32_t m_reliablesResentAtReport;
+	int m_numChurnsSinceReport;
+};
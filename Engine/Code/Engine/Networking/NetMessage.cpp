@@ -1,6 +1,7 @@
 #include "Engine/Networking/NetMessage.hpp"
 #include "Engine/Networking/NetSession.hpp"
 #include "Engine/Networking/NetConnectionUtils.hpp"
+#include "Engine/Memory/BitPacker.hpp"
 
 
 //--------------------------------------------------------------------------------------------------------------
@@ -8,6 +9,7 @@ STATIC void NetMessage::Duplicate( const NetMessage& msg, NetMessage& out_cloneM
 {
 	out_cloneMsg.m_msgHeader = msg.m_msgHeader; //Be sure struct has no ptr if adding to it in future.
 	out_cloneMsg.SetMessageDefinition( &msg.m_defn );
+	out_cloneMsg.m_replacementKey = msg.m_replacementKey;
 
 	int numValidBufferBytes = msg.GetTotalReadableBytes();
 	for ( int byteIndex = 0; byteIndex < numValidBufferBytes; byteIndex++ )
@@ -17,12 +19,39 @@ STATIC void NetMessage::Duplicate( const NetMessage& msg, NetMessage& out_cloneM
 }
 
 
+//--------------------------------------------------------------------------------------------------------------
+STATIC SharedNetMessagePayload* NetMessage::CreateSharedPayload( const NetMessage& msg )
+{
+	SharedNetMessagePayload* sharedPayload = new SharedNetMessagePayload();
+
+	sharedPayload->numBytes = msg.GetTotalReadableBytes();
+	memcpy( sharedPayload->data, msg.m_msgData, sharedPayload->numBytes );
+	sharedPayload->numReferences = 1;
+
+	return sharedPayload;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+STATIC void NetMessage::ReleaseSharedPayload( SharedNetMessagePayload* sharedPayload )
+{
+	if ( sharedPayload == nullptr )
+		return;
+
+	if ( --sharedPayload->numReferences == 0 )
+		delete sharedPayload;
+}
+
+
 //--------------------------------------------------------------------------------------------------------------
 NetMessage::NetMessage( uint8_t id /*= MAX_CORE_NETMSG_TYPES */ )
 	: BytePacker( MAX_MESSAGE_SIZE )
 	, m_msgHeader( id )
 	, m_msgData( new byte_t[ MAX_MESSAGE_SIZE ] )
+	, m_ownsBuffer( true )
 	, m_lastSentTimestampMilliseconds( 0 )
+	, m_replacementKey( 0 )
+	, m_sharedPayload( nullptr )
 {
 	SetBuffer( m_msgData ); //Has to come after allocating.
 }
@@ -33,7 +62,10 @@ NetMessage::NetMessage( uint8_t id, uint16_t totalMsgSize, byte_t* msgData, size
 	: BytePacker( totalMsgSize )
 	, m_msgHeader( id )
 	, m_msgData( msgData )
+	, m_ownsBuffer( false )
 	, m_lastSentTimestampMilliseconds( 0 )
+	, m_replacementKey( 0 )
+	, m_sharedPayload( nullptr )
 {
 	SetBuffer( m_msgData );
 	SetTotalReadableBytes( msgLength );
@@ -42,23 +74,102 @@ NetMessage::NetMessage( uint8_t id, uint16_t totalMsgSize, byte_t* msgData, size
 
 
 //--------------------------------------------------------------------------------------------------------------
-size_t NetMessage::GetHeaderSize( size_t sizeOfMessageLengthVariable )
+NetMessage::NetMessage( const NetMessage& headerSource, SharedNetMessagePayload* sharedPayload )
+	: BytePacker( MAX_MESSAGE_SIZE )
+	, m_msgHeader( headerSource.m_msgHeader )
+	, m_msgData( sharedPayload->data ) //No buffer of our own to allocate or copy into.
+	, m_ownsBuffer( false )
+	, m_defn( headerSource.m_defn )
+	, m_lastSentTimestampMilliseconds( 0 )
+	, m_replacementKey( headerSource.m_replacementKey )
+	, m_sharedPayload( sharedPayload )
+{
+	++m_sharedPayload->numReferences;
+	SetBuffer( m_msgData );
+	SetTotalReadableBytes( m_sharedPayload->numBytes );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+NetMessage::NetMessage( const NetMessage& other )
+	: BytePacker( other )
+	, m_msgHeader( other.m_msgHeader )
+	, m_msgData( other.m_msgData )
+	, m_ownsBuffer( other.m_ownsBuffer )
+	, m_defn( other.m_defn )
+	, m_lastSentTimestampMilliseconds( other.m_lastSentTimestampMilliseconds )
+	, m_replacementKey( other.m_replacementKey )
+	, m_sharedPayload( other.m_sharedPayload )
+{
+	if ( m_sharedPayload != nullptr )
+		++m_sharedPayload->numReferences;
+
+	if ( m_ownsBuffer ) //Else two messages would free the same buffer.
+	{
+		m_msgData = new byte_t[ MAX_MESSAGE_SIZE ];
+		memcpy( m_msgData, other.m_msgData, other.GetTotalReadableBytes() );
+		SetBuffer( m_msgData );
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+NetMessage::~NetMessage()
+{
+	if ( m_ownsBuffer )
+		delete[] m_msgData;
+
+	ReleaseSharedPayload( m_sharedPayload ); //e.g. When NetConnection's pools Delete the queued copy after sending it.
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetMessage::ResetAsView( uint8_t id, byte_t* payload, size_t payloadSize )
+{
+	ASSERT_OR_DIE( m_sharedPayload == nullptr, "ResetAsView would leak the message's shared payload reference!" );
+
+	if ( m_ownsBuffer )
+		delete[] m_msgData;
+	m_ownsBuffer = false;
+
+	m_msgHeader = MessageHeader( id );
+	m_msgData = payload;
+	SetBuffer( m_msgData );
+	SetTotalWritableBytes( 0 ); //Handlers can't scribble over the rest of the packet.
+	SetTotalReadableBytes( payloadSize );
+	ResetOffset();
+	//Don't neglect to call Finalize() to set msg definition based on m_id!
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+size_t NetMessage::GetHeaderSize() const
 {
 	//Would it be better to just precompute and store it on the defn when NetSession::RegisterMessage is called?
 
 	//Without breaking it up individually (as is the case when it's written out) struct packing becomes problematic.
-	size_t size = sizeOfMessageLengthVariable + sizeof( m_msgHeader.id );
+	size_t size = sizeof( m_msgHeader.id );
 
 	if ( IsReliable() )
+	{
 		size += sizeof( m_msgHeader.reliableID );
 
-	if ( IsInOrder() )
-		size += sizeof( m_msgHeader.sequenceID );
+		if ( IsInOrder() ) //Mirrors NetPacket::WriteMessageToBuffer, which only sends the sequenceID with a reliableID.
+			size += sizeof( m_msgHeader.sequenceID );
+	}
 
 	return size;
 }
 
 
+//--------------------------------------------------------------------------------------------------------------
+size_t NetMessage::GetTotalWireSize() const
+{
+	size_t bodySize = GetBodySize();
+	return BitPacker::GetVarUintSize( (uint32_t)bodySize ) + bodySize;
+}
+
+
 //--------------------------------------------------------------------------------------------------------------
 bool NetMessage::FinalizeMessageDefinition( NetSession* ns )
 {
@@ -90,7 +201,7 @@ bool NetMessage::WriteConnectionInfoMinusAddress( const NetConnectionInfo* info
 	if ( !successfulWrite )
 		return false;
 
-	successfulWrite = Write<uint8_t>( info->connectionIndex );
+	successfulWrite = Write<NetConnectionIndex>( info->connectionIndex );
 	return successfulWrite;
 }
 
@@ -109,6 +220,6 @@ bool NetMessage::ReadConnectionInfoMinusAddress( NetConnectionInfo* out_info ) /
 	for ( int i = 0; i < MAX_GUID_LENGTH; i++ )
 		out_info->guid[ i ] = guid[ i ];
 
-	bool successfulRead = Read<uint8_t>( &out_info->connectionIndex );
+	bool successfulRead = Read<NetConnectionIndex>( &out_info->connectionIndex );
 	return successfulRead;
 }
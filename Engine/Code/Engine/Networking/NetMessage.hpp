@@ -4,6 +4,7 @@
 #include "Engine/EngineCommon.hpp"
 #include "Engine/Memory/BytePacker.hpp"
 #include "Engine/Memory/BitUtils.hpp"
+#include <atomic>
 
 
 //-----------------------------------------------------------------------------
@@ -25,10 +26,20 @@ enum NetMessageOption : uint32_t //Describes "how" a message needs to be sent/re
 {
 	NETMSGOPT_NONE = 0,
 	NETMSGOPT_RELIABLE = (1 << 0), 
+	NETMSGOPT_REPLACEABLE = (1 << 1), //Unreliable only. Queuing one supersedes any still-unsent one with the same type and replacement key.
 	NUM_NETMSGOPTS
 };
 
 
+//-----------------------------------------------------------------------------
+enum NetMessagePriority : uint8_t //Orders unreliables within a packet, so under bandwidth pressure it's the least important ones dropped.
+{
+	NETMSG_PRIORITY_LOW,
+	NETMSG_PRIORITY_NORMAL,
+	NETMSG_PRIORITY_HIGH
+};
+
+
 //-----------------------------------------------------------------------------
 struct NetSender;
 class NetMessage;
@@ -45,11 +56,13 @@ struct NetMessageDefinition //Created by calls to NetSession::RegisterMessage.
 	NetMessageCallback* handler;
 	uint32_t controlFlags; //cf. NetMessageControl above. The "what" to send. Used while receiving, as parity bits.
 	uint32_t optionFlags; //e.g. RELIABLE -- The "how" to send. Used while sending.
+	uint8_t inOrderChannel; //Which of the NetConnection's sequences NETMSGCTRL_PROCESSED_INORDER messages are ordered within.
+	NetMessagePriority priority;
 };
 
 
 //-----------------------------------------------------------------------------
-struct MessageHeader //WARNING: DOES NOT INCLUDE THE MESSAGE LENGTH (hence GetHeaderSize's param).
+struct MessageHeader //WARNING: DOES NOT INCLUDE THE MESSAGE LENGTH (a varint written ahead of it, see GetTotalWireSize).
 {
 	MessageHeader() {}
 	MessageHeader( uint8_t msgTypeId, uint16_t msgReliableID = 0, uint16_t msgSequenceID = 0 )
@@ -66,31 +79,56 @@ struct MessageHeader //WARNING: DOES NOT INCLUDE THE MESSAGE LENGTH (hence GetHe
 };
 
 
+//-----------------------------------------------------------------------------
+struct SharedNetMessagePayload //Serialized once for a broadcast, then only read by each connection's queued copy of the message.
+{
+	byte_t data[ MAX_MESSAGE_SIZE ];
+	size_t numBytes;
+	std::atomic<int> numReferences; //Atomic since connections may release theirs from different threads.
+};
+
+
 //-----------------------------------------------------------------------------
 class NetMessage : public BytePacker
 {
 public:
 	static void Duplicate( const NetMessage& msg, NetMessage& out_cloneMsg );
+	static SharedNetMessagePayload* CreateSharedPayload( const NetMessage& msg ); //Starts with the caller's reference, drop it via ReleaseSharedPayload.
+	static void ReleaseSharedPayload( SharedNetMessagePayload* sharedPayload );
 
 	NetMessage( uint8_t id = NO_MSG_TYPE_ID ); //Supports either core engine-side or game-side message type enums.
-	NetMessage( uint8_t id, uint16_t totalMsgSize, byte_t* msgData, size_t msgLength );
+	NetMessage( uint8_t id, uint16_t totalMsgSize, byte_t* msgData, size_t msgLength ); //A view, msgData must outlive it.
+	NetMessage( const NetMessage& headerSource, SharedNetMessagePayload* sharedPayload ); //Copies only the header, references the payload.
+	NetMessage( const NetMessage& other ); //Deep copies an owned buffer, else shares the view or payload like other does.
+	NetMessage& operator=( const NetMessage& ) = delete; //Use Duplicate, or ResetAsView on received ones.
+	~NetMessage(); //Frees an owned buffer, releases any shared payload.
+
+	void ResetAsView( uint8_t id, byte_t* payload, size_t payloadSize ); //Read-only, pointing straight into e.g. a received packet.
+	bool IsView() const { return !m_ownsBuffer && ( m_sharedPayload == nullptr ); } //Copy it (Duplicate) to hold onto it past its buffer.
 	
 	bool NeedsConnection() const { return ( GET_BIT_AT_BITFIELD_WITHOUT_INDEX_MASKED( m_defn.controlFlags, NETMSGCTRL_PROCESSED_CONNECTIONLESS ) == 0 ); }
 	bool IsInOrder() const { return ( GET_BIT_AT_BITFIELD_WITHOUT_INDEX_MASKED( m_defn.controlFlags, NETMSGCTRL_PROCESSED_INORDER ) != 0 ); }
 	bool IsReliable() const { return ( GET_BIT_AT_BITFIELD_WITHOUT_INDEX_MASKED( m_defn.optionFlags, NETMSGOPT_RELIABLE ) != 0 ); }
+	bool IsReplaceable() const { return ( GET_BIT_AT_BITFIELD_WITHOUT_INDEX_MASKED( m_defn.optionFlags, NETMSGOPT_REPLACEABLE ) != 0 ); }
 	void Process( const NetSender& from ) { m_defn.handler( from, *this/*Won't copy because handler is pass-by-ref, not by-val.*/ ); }
 
 	uint8_t GetTypeID() const { return m_msgHeader.id; }
 	uint16_t GetReliableID() const { return m_msgHeader.reliableID; }
 	uint16_t GetSequenceID() const { return m_msgHeader.sequenceID; }
-	size_t GetHeaderSize( size_t sizeOfMessageLengthVariable );
+	uint8_t GetInOrderChannel() const { return m_defn.inOrderChannel; } //Not sent, both sides know it from the message type.
+	NetMessagePriority GetPriority() const { return m_defn.priority; }
+	size_t GetHeaderSize() const; //Excludes the length prefix.
 	size_t GetPayloadSize() const { return GetTotalReadableBytes(); } //Payload size == how far we've written into the BytePacker'd buffer.
+	size_t GetBodySize() const { return GetHeaderSize() + GetPayloadSize(); } //What the length prefix holds.
+	size_t GetTotalWireSize() const; //Length prefix + header + payload, i.e. what NetPacket::WriteMessageToBuffer will take up.
 	byte_t* GetMessageBuffer() { return m_msgData; }
 	NetMessageDefinition GetMessageDefinition() const { return m_defn; }
 	uint32_t GetTimestamp() const { return m_lastSentTimestampMilliseconds; }
+	uint32_t GetReplacementKey() const { return m_replacementKey; }
 
 	bool FinalizeMessageDefinition( NetSession* );
 	void SetTimestamp( uint32_t ms ) { m_lastSentTimestampMilliseconds = ms; }
+	void SetReplacementKey( uint32_t key ) { m_replacementKey = key; } //e.g. An object's ID, so only its updates supersede each other.
 	void SetReliableID( uint16_t rid ) { m_msgHeader.reliableID = rid; }
 	void SetSequenceID( uint16_t sid ) { m_msgHeader.sequenceID = sid; }
 	void SetMessageDefinition( const NetMessageDefinition* defn ) { m_defn = *defn; }
@@ -102,8 +140,11 @@ public:
 private:
 
 	byte_t* m_msgData;
+	bool m_ownsBuffer; //Only the default ctor's MAX_MESSAGE_SIZE buffer, views and shared payloads point elsewhere.
 	MessageHeader m_msgHeader;
 	NetMessageDefinition m_defn;
 
 	uint32_t m_lastSentTimestampMilliseconds; //If reliable, time since this was last attempted to be sent.
+	uint32_t m_replacementKey; //If replaceable, which of its type's stream it belongs to. Local only, never sent.
+	SharedNetMessagePayload* m_sharedPayload; //When set, m_msgData points into it and must not be written.
 };
@@ -164,3 +164,24 @@ void OnLeaveReceived( const NetSender& from, NetMessage& )
 	LogAndShowPrintfWithTag( "NetSession", "Received leave message from username %s.", from.sourceConnection->GetGuidString().c_str() );
 	from.ourSession->Disconnect( from.sourceConnection );
 }
+
+
+//--------------------------------------------------------------------------------------------------------------
+void OnFragmentReceived( const NetSender& from, NetMessage& msg )
+{
+	from.sourceConnection->ReceiveFragment( from, msg ); //Needs a connection by its definition, so this is non-null.
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void OnClockSyncRequestReceived( const NetSender& from, NetMessage& msg )
+{
+	from.sourceConnection->ReceiveClockSyncRequest( msg ); //Needs a connection by its definition, so this is non-null.
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void OnClockSyncResponseReceived( const NetSender& from, NetMessage& msg )
+{
+	from.sourceConnection->ReceiveClockSyncResponse( msg );
+}
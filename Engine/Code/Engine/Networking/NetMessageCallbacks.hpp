@@ -15,4 +15,9 @@ extern void OnJoinRequestReceived( const NetSender& from, NetMessage& msg );
 extern void OnJoinAcceptReceived( const NetSender& from, NetMessage& msg );
 extern void OnJoinDenyReceived( const NetSender& from, NetMessage& msg );
 
-extern void OnLeaveReceived( const NetSender& from, NetMessage& msg );
\ No newline at end of file
+extern void OnLeaveReceived( const NetSender& from, NetMessage& msg );
+
+extern void OnFragmentReceived( const NetSender& from, NetMessage& msg );
+
+extern void OnClockSyncRequestReceived( const NetSender& from, NetMessage& msg );
+extern void OnClockSyncResponseReceived( const NetSender& from, NetMessage& msg );
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "Engine/Networking/NetPacket.hpp"
 #include "Engine/Networking/NetMessage.hpp"
 #include "Engine/Networking/NetSession.hpp"
+#include "Engine/Memory/BitPacker.hpp"
 
 
 
@@ -11,23 +12,24 @@ bool NetPacket::WriteMessageToBuffer( NetMessage& in_msg, NetSession* ns )
 	if ( !foundDefn )
 		return false;
 
-	uint16_t totalMessageSize;
-	uint16_t msgHeaderSize = (uint16_t)in_msg.GetHeaderSize( sizeof( totalMessageSize ) ); //Changes if rid/sid is also used.
-	uint16_t msgPayloadSize = (uint16_t)in_msg.GetPayloadSize();
-	totalMessageSize = msgHeaderSize + msgPayloadSize;
+	if ( m_numberOfMessages == UINT8_MAX )
+		return false; //The count's written as a uint8_t.
 
-	if ( GetWritableBytes() >= totalMessageSize ) //Else too big to write the message.
+	size_t msgPayloadSize = in_msg.GetPayloadSize();
+	if ( GetWritableBytes() >= in_msg.GetTotalWireSize() ) //Else too big to write the message.
 	{
-		Write<uint16_t>( totalMessageSize ); //Size first.
-		Write<uint8_t>( in_msg.GetTypeID() ); //ID second.
+		BitPacker headerBits( *this, BITPACKER_MODE_WRITE );
+		headerBits.WriteVarUint( (uint32_t)in_msg.GetBodySize() ); //Size first, usually just a byte.
+		headerBits.WriteBits( in_msg.GetTypeID(), sizeof( uint8_t ) * NUM_BITS_IN_BYTE ); //ID second.
 
 		if ( in_msg.IsReliable() )
 		{
-			Write<uint16_t>( in_msg.GetReliableID() );
+			headerBits.WriteBits( in_msg.GetReliableID(), sizeof( uint16_t ) * NUM_BITS_IN_BYTE );
 
 			if ( in_msg.IsInOrder() )
-				Write<uint16_t>( in_msg.GetSequenceID() ); //Unreliable in-order traffic supported differently, see class spec/notes.
+				headerBits.WriteBits( in_msg.GetSequenceID(), sizeof( uint16_t ) * NUM_BITS_IN_BYTE ); //Unreliable in-order traffic supported differently, see class spec/notes.
 		}
+		headerBits.FinishOnto( *this );
 		//End of writing message header.
 
 		WriteForwardAlongBuffer( in_msg.GetBuffer(), msgPayloadSize ); //The payload.
@@ -45,23 +47,30 @@ bool NetPacket::WriteMessageToBuffer( NetMessage& in_msg, NetSession* ns )
 //--------------------------------------------------------------------------------------------------------------
 bool NetPacket::WritePacketHeader( PacketHeader& ph )
 {
+	BitPacker headerBits( *this, BITPACKER_MODE_WRITE );
+
 	//ConnIndex first, so receiver knows who sent it and can get their pointer from their NetSession::m_connections.
-	bool success = Write<NetConnectionIndex>( ph.connectionIndex );
+	bool success = headerBits.WriteVarUint( ph.connectionIndex );
+	if ( !success )
+		return false;
+
+	success = headerBits.WriteBits( ph.ack, sizeof( ph.ack ) * NUM_BITS_IN_BYTE );
 	if ( !success )
 		return false;
 
-	success = Write<uint16_t>( ph.ack );
+	success = headerBits.WriteBits( ph.highestReceivedAck, sizeof( ph.highestReceivedAck ) * NUM_BITS_IN_BYTE );
 	if ( !success )
 		return false;
 
-	success = Write<uint16_t>( ph.highestReceivedAck );
+	success = headerBits.WriteBits( ph.previousReceivedAcksAsBitfield, sizeof( ph.previousReceivedAcksAsBitfield ) * NUM_BITS_IN_BYTE );
 	if ( !success )
 		return false;
 
-	success = Write<uint16_t>( ph.previousReceivedAcksAsBitfield );
+	success = headerBits.WriteVarUint( ph.highestReceivedAckHoldMilliseconds ); //Usually under a tick, so a byte or two.
 	if ( !success )
 		return false;
 
+	headerBits.FinishOnto( *this );
 	return true;
 }
 
@@ -69,51 +78,58 @@ bool NetPacket::WritePacketHeader( PacketHeader& ph )
 //--------------------------------------------------------------------------------------------------------------
 bool NetPacket::ReadMessageFromPacketBuffer( NetMessage& out_msg, NetSession* ns )
 {
-	uint16_t totalMessageSize;
-	bool hadEnoughRoom = Read<uint16_t>( &totalMessageSize );
+	BitPacker headerBits( *this, BITPACKER_MODE_READ );
+
+	uint32_t bodySize; //Everything after the length prefix: header, then payload.
+	bool hadEnoughRoom = headerBits.ReadVarUint( &bodySize );
 	if ( !hadEnoughRoom )
 		return false;
 
-	uint8_t msgType; //Not a CoreMessageType to support either that or also the GameMessageType enum.
-	hadEnoughRoom = Read<uint8_t>( &msgType );
+	uint32_t msgType; //Not a CoreMessageType to support either that or also the GameMessageType enum.
+	hadEnoughRoom = headerBits.ReadBits( &msgType, sizeof( uint8_t ) * NUM_BITS_IN_BYTE );
 	if ( !hadEnoughRoom )
 		return false;
 
-	NetMessageDefinition* defn = ns->FindDefinitionForMessageType( msgType );
+	NetMessageDefinition* defn = ns->FindDefinitionForMessageType( (uint8_t)msgType );
 	if ( defn == nullptr )
 		return false;
-	out_msg.SetMessageDefinition( defn ); //Necessary to call below function.
-	size_t headerSize = out_msg.GetHeaderSize( sizeof( totalMessageSize ) );
-	size_t payloadSize = totalMessageSize - headerSize;
-
-	out_msg = NetMessage( msgType, totalMessageSize, GetIoHead(), payloadSize ); //Takes a ptr to take the packet buffer in-place.
-
-	//Handle Variable Fields (e.g. reliableID if msg.IsReliable, which requires valid msg defn to work)
-	bool foundDefn = out_msg.FinalizeMessageDefinition( ns );
-	if ( !foundDefn ) //Sanity check.
+	out_msg.SetMessageDefinition( defn ); //Necessary to call below functions.
+	size_t headerSize = out_msg.GetHeaderSize();
+	if ( bodySize < headerSize )
 		return false;
+	size_t payloadSize = bodySize - headerSize;
 
+	//Handle Variable Fields (e.g. reliableID if msg.IsReliable, which requires valid msg defn to work)
+	uint32_t reliableID = 0;
+	uint32_t sequenceID = 0;
 	if ( out_msg.IsReliable() )
 	{
-		uint16_t reliableID;
-		hadEnoughRoom = Read<uint16_t>( &reliableID ); //Because at this point we haven't advanced packet's ioHead since reading msgType.
+		hadEnoughRoom = headerBits.ReadBits( &reliableID, sizeof( uint16_t ) * NUM_BITS_IN_BYTE );
 		if ( !hadEnoughRoom )
 			return false;
-		out_msg.SetReliableID( reliableID );
 
 		if ( out_msg.IsInOrder() )
 		{
-			uint16_t sequenceID;
-			hadEnoughRoom = Read<uint16_t>( &sequenceID );
+			hadEnoughRoom = headerBits.ReadBits( &sequenceID, sizeof( uint16_t ) * NUM_BITS_IN_BYTE );
 			if ( !hadEnoughRoom )
 				return false;
-			out_msg.SetSequenceID( sequenceID );
 		}
-
-		out_msg.SetBuffer( GetIoHead() ); //Moves where the message believes its payload to start, to after the rID.
 	}
+	headerBits.FinishOnto( *this ); //Packet I/O head now sits at the start of the payload.
 	//End Message Header Variable Field Handling
 
+	if ( payloadSize > GetReadableBytes() )
+		return false;
+
+	out_msg.ResetAsView( (uint8_t)msgType, GetIoHead(), payloadSize ); //Points into the packet buffer in-place, nothing copied.
+
+	bool foundDefn = out_msg.FinalizeMessageDefinition( ns );
+	if ( !foundDefn ) //Sanity check.
+		return false;
+
+	out_msg.SetReliableID( (uint16_t)reliableID );
+	out_msg.SetSequenceID( (uint16_t)sequenceID );
+
 	this->AdvanceOffset( payloadSize ); //Since we never used Read() on it, still need to advance this offset past payload.
 		//Note this is for the packet, NOT out_msg -- we will allow NetMessage::Read functions to advance over its own buffer.
 		//Also note this comes AFTER variable fields in the message header.
@@ -125,22 +141,36 @@ bool NetPacket::ReadMessageFromPacketBuffer( NetMessage& out_msg, NetSession* ns
 //--------------------------------------------------------------------------------------------------------------
 bool NetPacket::ReadPacketHeader( PacketHeader& ph )
 {
-	bool success = Read<NetConnectionIndex>( &ph.connectionIndex );
+	BitPacker headerBits( *this, BITPACKER_MODE_READ );
+
+	uint32_t connectionIndex;
+	bool success = headerBits.ReadVarUint( &connectionIndex );
 	if ( !success )
 		return false;
+	ph.connectionIndex = (NetConnectionIndex)connectionIndex;
 
-	success = Read<uint16_t>( &ph.ack );
+	uint32_t field;
+	success = headerBits.ReadBits( &field, sizeof( ph.ack ) * NUM_BITS_IN_BYTE );
 	if ( !success )
 		return false;
+	ph.ack = (uint16_t)field;
 
-	success = Read<uint16_t>( &ph.highestReceivedAck );
+	success = headerBits.ReadBits( &field, sizeof( ph.highestReceivedAck ) * NUM_BITS_IN_BYTE );
 	if ( !success )
 		return false;
+	ph.highestReceivedAck = (uint16_t)field;
 
-	success = Read<uint16_t>( &ph.previousReceivedAcksAsBitfield );
+	success = headerBits.ReadBits( &field, sizeof( ph.previousReceivedAcksAsBitfield ) * NUM_BITS_IN_BYTE );
 	if ( !success )
 		return false;
+	ph.previousReceivedAcksAsBitfield = (AckBitfield)field;
 
+	success = headerBits.ReadVarUint( &field );
+	if ( !success )
+		return false;
+	ph.highestReceivedAckHoldMilliseconds = (uint16_t)GetMin( field, (uint32_t)UINT16_MAX );
+
+	headerBits.FinishOnto( *this );
 	return true;
 }
 
@@ -148,26 +178,25 @@ bool NetPacket::ReadPacketHeader( PacketHeader& ph )
 //--------------------------------------------------------------------------------------------------------------
 bool NetPacket::ValidateLength( const PacketHeader& ph, size_t expectedPacketSize )
 {
-	UNREFERENCED( ph ); //It gets compiled out here, but it's actually needed for below sizeof's--they're just compiled out, hence it seemed unreferences.
-
-	//WARNING: keep validationOffset up to date with PacketHeader or this will likely return false negatives!
-	//NOT using sizeof( PacketHeader ) because packing uint8 with uint16 makes the retval of sizeof different.
-	size_t offsetBeforeEnteringFunction = sizeof( m_numberOfMessages ) //We know we're this many bytes into the packet (i.e. where m_ioOffset is) here.
-		+ sizeof( ph.ack )
-		+ sizeof( ph.connectionIndex )
-		+ sizeof( ph.highestReceivedAck )
-		+ sizeof( ph.previousReceivedAcksAsBitfield );
-		//i.e. You better have made sure that ReadPacketHeader and ReadNumMessages came before the call to this function did. >:(
+	UNREFERENCED( ph );
 
+	//We know we're this many bytes into the packet (i.e. where m_ioOffset is) here, since the header is variable-length now.
+	//i.e. You better have made sure that ReadPacketHeader and ReadNumMessages came before the call to this function did. >:(
+	size_t offsetBeforeEnteringFunction = GetIoHead() - GetBuffer();
 
 	size_t validationOffset = offsetBeforeEnteringFunction;
 	for ( int msgIndex = 0; msgIndex < m_numberOfMessages; msgIndex++ )
 	{
-		uint16_t totalMessageSize;
-		Read<uint16_t>( &totalMessageSize );
-		AdvanceOffset( totalMessageSize - sizeof( totalMessageSize ) ); //Cross over NOT totalMessageSize but yes msg id in the header as well as the msg payload!
-		validationOffset += totalMessageSize; //Need this for below, but need to use AdvanceOffset to use Read<> for endian-correct parsing. 
-			//This doesn't subtract sizeof (msgSize) because Read<> doesn't advance it.
+		BitPacker lengthBits( *this, BITPACKER_MODE_READ );
+		uint32_t bodySize;
+		if ( !lengthBits.ReadVarUint( &bodySize ) )
+		{
+			ResetOffset( offsetBeforeEnteringFunction );
+			return false; //Ran off the end of the packet.
+		}
+		lengthBits.FinishOnto( *this );
+		AdvanceOffset( bodySize ); //Cross over the msg id in the header as well as the msg payload!
+		validationOffset += lengthBits.GetNumBytesUsed() + bodySize;
 	}
 	
 	ResetOffset( offsetBeforeEnteringFunction ); //Get it back where it was before calling this function.
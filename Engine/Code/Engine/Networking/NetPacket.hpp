@@ -28,16 +28,17 @@ class NetSession;
 //-----------------------------------------------------------------------------
 struct PacketHeader
 {
-	PacketHeader() : ack( INVALID_PACKET_ACK ) {}
+	PacketHeader() : ack( INVALID_PACKET_ACK ), highestReceivedAckHoldMilliseconds( 0 ) {}
 
-	uint8_t connectionIndex; //From A3.
+	NetConnectionIndex connectionIndex; //From A3. Written as a VarUint, so low indices still take one byte.
 
 	//A4 -- these are set in NetConnection::SendPacket when writing packet header!
 	uint16_t ack/*OfThisPacket*/; //Every packet we send out uses a sequential ack # for its #th packet.
 		//KEY for unreliables: if the ack # is invalid, we do not expect an acknowledging response.
 	uint16_t highestReceivedAck/*OnSendingSide*/;
-	uint16_t previousReceivedAcksAsBitfield/*OnSendingSide*/; 
-		//e.g. if highestAck is 3, is_set(pRAAB[15]) == whether we received an ack for #2.
+	AckBitfield previousReceivedAcksAsBitfield/*OnSendingSide*/; 
+		//e.g. if highestAck is 3, is_set(pRAAB[0]) == whether we received an ack for #2.
+	uint16_t highestReceivedAckHoldMilliseconds; //How long highestReceivedAck sat with us before this packet, i.e. our tick's wait, for them to take out of RTT.
 
 	//No member for # messages, because we calculate that on send.
 };
@@ -51,13 +52,14 @@ public:
 	size_t GetHeaderSize() const { return sizeof( m_numberOfMessages ); }
 	byte_t* GetPayloadBuffer() const { return (byte_t*)m_packetBuffer; }
 	uint8_t GetTotalAddedMessages() const { return m_numberOfMessages; }
+	void ResetForWriting() { ResetOffset(); SetTotalReadableBytes( 0 ); m_numberOfMessages = 0; } //Reuse, since copying one would leave it pointing at the original's buffer.
 
 	bool ReadNumMessages() { return Read<uint8_t>( &m_numberOfMessages ); }
 
 	bool ReadPacketHeader( PacketHeader& ph );
 	bool WritePacketHeader( PacketHeader& ph );
 
-	bool ReadMessageFromPacketBuffer( NetMessage& out_msg, NetSession* );
+	bool ReadMessageFromPacketBuffer( NetMessage& out_msg, NetSession* ); //out_msg becomes a view, only valid as long as this packet is.
 	bool WriteMessageToBuffer( NetMessage& in_msg, NetSession* );
 	bool ValidateLength( const PacketHeader& ph, size_t expectedPacketSize );
 
@@ -10,6 +10,8 @@
 #include "Engine/Networking/PacketChannel.hpp"
 #include "Engine/Core/EngineEvent.hpp"
 #include "Engine/Tools/StateMachine/State.hpp"
+#include "Engine/Time/Time.hpp"
+#include "Engine/Concurrency/JobUtils.hpp"
 
 
 //--------------------------------------------------------------------------------------------------------------
@@ -32,8 +34,11 @@ void NetSession::SessionRender()
 
 
 //--------------------------------------------------------------------------------------------------------------
-bool NetSession::SessionShutdown_Handler( EngineEvent* )
+bool NetSession::SessionShutdown_Handler( EngineEvent* ev )
 {
+	if ( ( ev != nullptr ) && !ev->IsIntendedForThis( this ) )
+		return SHOULD_NOT_UNSUB; //Another session's shutdown, a null event shuts down all of them.
+
 	//Breakpoint here to see whether this wrecks everything.
 	if ( IsRunning() )
 	{
@@ -53,13 +58,19 @@ bool NetSession::SessionShutdown_Handler( EngineEvent* )
 
 
 //--------------------------------------------------------------------------------------------------------------
-bool NetSession::SessionClearConnections_Handler( EngineEvent* )
+bool NetSession::SessionClearConnections_Handler( EngineEvent* ev )
 {
+	if ( !ev->IsIntendedForThis( this ) )
+		return SHOULD_NOT_UNSUB; //Every session shares the event name, cf. the ctor.
+
 	for each ( NetConnection*& conn in m_connections )
 	{
 		delete conn;
 		conn = nullptr; //Hence the by-ref, above.
 	}
+	m_connectionsByAddress.clear();
+	m_myConnection = nullptr; //Else a rejoin would start out pointing at freed connections.
+	m_hostConnection = nullptr;
 
 	//Only runs once by virtue of being an OnEnter command, but if we unsub it, future visits to this state won't come here.
 	const bool SHOULD_UNSUB = false; 
@@ -68,15 +79,21 @@ bool NetSession::SessionClearConnections_Handler( EngineEvent* )
 
 
 //--------------------------------------------------------------------------------------------------------------
-bool NetSession::Session_StartJoiningTimeoutStopwatch( EngineEvent* )
+bool NetSession::Session_StartJoiningTimeoutStopwatch( EngineEvent* ev )
 {
+	if ( !ev->IsIntendedForThis( this ) )
+		return SHOULD_NOT_UNSUB;
+
 	m_joiningStateTimeLimit.Start();
 
 	const bool SHOULD_UNSUB = false;
 	return SHOULD_UNSUB;
 }
-bool NetSession::Session_OnJoiningTimeoutStopwatchEnded( EngineEvent* )
+bool NetSession::Session_OnJoiningTimeoutStopwatchEnded( EngineEvent* ev )
 {
+	if ( !ev->IsIntendedForThis( this ) )
+		return SHOULD_NOT_UNSUB;
+
 	if ( IsInJoiningState() ) //Else proceeds as joined, without interference from this event.
 	{
 		LogAndShowPrintfWithTag( "NetSession", "Joining state timed out." );
@@ -92,28 +109,33 @@ bool NetSession::Session_OnJoiningTimeoutStopwatchEnded( EngineEvent* )
 NetSession::NetSession( const char* sessionName )
 	: m_sessionName( sessionName )
 	, m_usesTimeouts( true )
-	, m_secondsSinceLastUpdate( 0.f )
-	, m_secondsBetweenTicks( DEFAULT_TICK_RATE_SECONDS )
 	, m_myConnection( nullptr )
 	, m_hostConnection( nullptr )
 	, m_isListening( false )
 	, m_lastSentRequestNuonce( 0 )
-	, m_numAllowedConnections( MAX_CONNECTIONS )
-	, m_joiningStateTimeLimit( 15.f/*durationSeconds*/, "NetSession_OnJoiningTimeoutStopwatchEnded" )
+	, m_numAllowedConnections( DEFAULT_NUM_ALLOWED_CONNECTIONS )
+	, m_joiningStateTimeLimit( 15.f/*durationSeconds*/, "NetSession_OnJoiningTimeoutStopwatchEnded", this )
+	, m_numBytesSent( 0 )
+	, m_numBytesReceived( 0 )
+	, m_numReliablesResent( 0 )
+	, m_myPacketChannel( nullptr )
+	, m_isReplaying( false )
 {
 	memset( m_validMessages, 0, MAX_PROTOCOL_DEFNS * sizeof( NetMessageDefinition ) );
-	memset( m_connections, 0, MAX_CONNECTIONS * sizeof( NetConnection* ) );
+	memset( &m_replayAddress, 0, sizeof( sockaddr_in ) );
+	memset( m_messageTypeStats, 0, sizeof( m_messageTypeStats ) );
+	m_connections.resize( m_numAllowedConnections, nullptr );
 
 	m_sessionStateMachine.CreateState( "NetSessionState_Invalid", true );
 
 	State* disconnectedState = m_sessionStateMachine.CreateState( "NetSessionState_Disconnected" );
 	TheEventSystem::Instance()->RegisterEvent< NetSession, &NetSession::SessionClearConnections_Handler >( "NetSession_CleanupConnections", this );
-	disconnectedState->AddStateCommand( STATE_STAGE_ENTERING, StateCommand( "NetSession_CleanupConnections" ) );
+	disconnectedState->AddStateCommand( STATE_STAGE_ENTERING, StateCommand( "NetSession_CleanupConnections", this ) ); //Addressed to us, so other sessions ignore it.
 
 	State* joiningState = m_sessionStateMachine.CreateState( "NetSessionState_Joining" );
 	TheEventSystem::Instance()->RegisterEvent< NetSession, &NetSession::Session_StartJoiningTimeoutStopwatch >( "NetSession_StartJoiningTimeoutStopwatch", this );
 	TheEventSystem::Instance()->RegisterEvent< NetSession, &NetSession::Session_OnJoiningTimeoutStopwatchEnded >( "NetSession_OnJoiningTimeoutStopwatchEnded", this );
-	joiningState->AddStateCommand( STATE_STAGE_ENTERING, StateCommand( "NetSession_StartJoiningTimeoutStopwatch" ) );
+	joiningState->AddStateCommand( STATE_STAGE_ENTERING, StateCommand( "NetSession_StartJoiningTimeoutStopwatch", this ) );
 
 
 	m_sessionStateMachine.CreateState( "NetSessionState_Connected" );
@@ -124,7 +146,13 @@ NetSession::NetSession( const char* sessionName )
 	RegisterMessage( NETMSG_JOIN_REQUEST, "joinRequest", OnJoinRequestReceived, NETMSGCTRL_PROCESSED_CONNECTIONLESS, NETMSGOPT_RELIABLE );
 	RegisterMessage( NETMSG_JOIN_ACCEPT, "joinAccept", OnJoinAcceptReceived, NETMSGCTRL_NONE, NETMSGOPT_RELIABLE );
 	RegisterMessage( NETMSG_JOIN_DENY, "joinDeny", OnJoinDenyReceived, NETMSGCTRL_NONE, NETMSGOPT_NONE );
-	RegisterMessage( NETMSG_LEAVE, "leave", OnLeaveReceived, NETMSGCTRL_NONE, NETMSGOPT_NONE );
+	RegisterMessage( NETMSG_LEAVE, "leave", OnLeaveReceived, NETMSGCTRL_NONE, NETMSGOPT_NONE, 0, NETMSG_PRIORITY_HIGH ); //Else FlushUnreliables may drop it for game traffic.
+
+	RegisterMessage( NETMSG_FRAGMENT, "fragment", OnFragmentReceived, NETMSGCTRL_PROCESSED_INORDER, NETMSGOPT_RELIABLE, FRAGMENT_INORDER_CHANNEL );
+
+	//Unreliable, a lost one is just a missing sample. High priority, since they're stamped as their packet's built and a later packet would skew them.
+	RegisterMessage( NETMSG_CLOCK_SYNC_REQUEST, "clockSyncRequest", OnClockSyncRequestReceived, NETMSGCTRL_NONE, NETMSGOPT_NONE, 0, NETMSG_PRIORITY_HIGH );
+	RegisterMessage( NETMSG_CLOCK_SYNC_RESPONSE, "clockSyncResponse", OnClockSyncResponseReceived, NETMSGCTRL_NONE, NETMSGOPT_NONE, 0, NETMSG_PRIORITY_HIGH );
 }
 
 
@@ -197,7 +225,7 @@ void NetSession::Connect( NetConnection* newConn, NetConnectionIndex newIndex )
 		//If this was me, though, trigger (my view of) everyone else.
 		if ( newConn->IsMe() )
 		{
-			for ( size_t i = 0; i < MAX_CONNECTIONS; i++ )
+			for ( size_t i = 0; i < m_connections.size(); i++ )
 			{
 				NetConnection* otherConn = m_connections[ i ];
 				if ( ( otherConn != nullptr ) && ( otherConn != newConn ) && ( !IsHost( otherConn ) ) ) 
@@ -224,7 +252,7 @@ void NetSession::Disconnect( NetConnection* paramConn )
 		return;
 
 	NetConnectionIndex paramConnIndex = paramConn->GetIndex();
-	if ( paramConn != m_connections[ paramConnIndex ] )
+	if ( paramConn != GetIndexedConnection( paramConnIndex ) )
 	{
 		ERROR_RECOVERABLE( "Imposter or outdated m_connections in NetSession::Disconnect!" );
 		return;
@@ -249,7 +277,7 @@ void NetSession::Disconnect( NetConnection* paramConn )
 
 	if ( paramIsMe ) //Make sure (my view of) all others (!me && !host) get disconnected prior to me.
 	{
-		for ( size_t i = 0; i < MAX_CONNECTIONS; i++ )
+		for ( size_t i = 0; i < m_connections.size(); i++ )
 		{
 			NetConnection* otherConn = m_connections[ i ];
 			if ( ( otherConn != nullptr ) && ( !otherConn->IsMe() ) && ( !IsHost( otherConn ) ) )
@@ -292,12 +320,18 @@ void NetSession::SendMessageToHost( NetMessage& msg )
 //--------------------------------------------------------------------------------------------------------------
 void NetSession::SendToAllConnections( NetMessage& msg )
 {
+	//Copy the payload out once, and every connection's queue references it instead of copying it again.
+	//Unless it's too big to share, in which case each connection fragments it, cf. NetConnection::SendFragmentsToThem.
+	SharedNetMessagePayload* sharedPayload = ( msg.GetPayloadSize() > MAX_MESSAGE_SIZE ) ? nullptr : NetMessage::CreateSharedPayload( msg );
+
 	for ( NetConnectionIndex connIndex = 0; connIndex < m_numAllowedConnections; connIndex++ )
 	{
 		NetConnection* currentConn = GetIndexedConnection( connIndex );
 		if ( currentConn != nullptr )
-			currentConn->SendMessageToThem( msg ); //Note this includes our own connection, even if hosting!
+			currentConn->SendMessageToThem( msg, sharedPayload ); //Note this includes our own connection, even if hosting!
 	}
+
+	NetMessage::ReleaseSharedPayload( sharedPayload ); //Freed here if nobody queued it, else by whichever connection sends it last.
 }
 
 
@@ -375,9 +409,16 @@ void NetSession::CleanupAfterJoinRequestDenied( NetMessage& denyMsg )
 NetSession::~NetSession()
 {
 	//Be sure that the shutdown event is triggered or else the below delete will be deferenced by session's update's IsRunning()!
-	m_myPacketChannel->Unbind();
-	delete m_myPacketChannel;
-	m_myPacketChannel = nullptr;
+	StopCapture();
+	if ( m_myPacketChannel != nullptr ) //Never made when replaying.
+	{
+		m_myPacketChannel->Unbind();
+		delete m_myPacketChannel;
+		m_myPacketChannel = nullptr;
+	}
+
+	for each ( NetTrafficStats* stats in m_messageTypeStats )
+		delete stats;
 }
 
 
@@ -411,7 +452,8 @@ void NetSession::SendMessageDirect( const sockaddr_in& addr, NetMessage& msg )
 	//Sends IMMEDIATELY, hence "Direct" in method name. Other sends need not necessarily do so.
 	if ( successfulWrite )
 	{
-		m_myPacketChannel->SendTo( addr, currentPacket.GetPayloadBuffer(), currentPacket.GetTotalReadableBytes() );
+		CountMessageSentDirect( msg );
+		SendTo( addr, currentPacket.GetPayloadBuffer(), currentPacket.GetTotalReadableBytes() );
 	}
 	else LogAndShowPrintfWithTag( "NetSession", "WARNING: NetPacket::WriteMessageToBuffer failed in SendMessageDirect!" );
 }
@@ -457,13 +499,14 @@ void NetSession::SendMessagesDirect( const sockaddr_in& addr, NetMessage msgs[],
 		if ( !successfulWrite ) //sendto and start anew.
 		{
 			currentPacket.WriteAtBookmark( numMsgsOffset, currentPacket.GetTotalAddedMessages() );
-			m_myPacketChannel->SendTo( addr, currentPacket.GetPayloadBuffer(), currentPacket.GetTotalReadableBytes() ); //Dispatch filled packet.
+			SendTo( addr, currentPacket.GetPayloadBuffer(), currentPacket.GetTotalReadableBytes() ); //Dispatch filled packet.
 			currentPacket = NetPacket(); //Start new packet.
 		}
+		else CountMessageSentDirect( msg );
 	}
 
 	currentPacket.WriteAtBookmark( numMsgsOffset, currentPacket.GetTotalAddedMessages() );
-	m_myPacketChannel->SendTo( addr, currentPacket.GetPayloadBuffer(), currentPacket.GetTotalReadableBytes() ); //Get that last packet sent.
+	SendTo( addr, currentPacket.GetPayloadBuffer(), currentPacket.GetTotalReadableBytes() ); //Get that last packet sent.
 }
 
 
@@ -481,27 +524,38 @@ NetMessageDefinition* NetSession::FindDefinitionForMessageType( uint8_t idIndex
 //--------------------------------------------------------------------------------------------------------------
 NetConnection* NetSession::FindConnectionByAddressAndPort( sockaddr_in addr )
 {
-	for each ( NetConnection* conn in m_connections )
+	auto found = m_connectionsByAddress.find( GetAddressKey( addr ) );
+	return ( found == m_connectionsByAddress.end() ) ? nullptr : found->second;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetSession::SetIndexedConnection( NetConnectionIndex index, NetConnection* conn )
+{
+	if ( index >= m_connections.size() )
+		return;
+
+	NetConnection*& slot = m_connections[ index ];
+	if ( slot != nullptr )
 	{
-		if ( conn == nullptr )
-			continue;
-		
-		sockaddr_in connAddr = conn->GetAddressObject();
-		if ( connAddr.sin_addr.S_un.S_addr == addr.sin_addr.S_un.S_addr )
-		{
-			if ( connAddr.sin_port == addr.sin_port )
-				return conn;
-		}
+		auto found = m_connectionsByAddress.find( GetAddressKey( slot->GetAddressObject() ) );
+		if ( ( found != m_connectionsByAddress.end() ) && ( found->second == slot ) ) //Don't erase whoever took over the address since.
+			m_connectionsByAddress.erase( found );
 	}
 
-	return nullptr;
+	slot = conn;
+	if ( conn != nullptr )
+		m_connectionsByAddress[ GetAddressKey( conn->GetAddressObject() ) ] = conn;
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 void NetSession::GetAddressObject( sockaddr_in* out_addr ) const
 {
-	m_myPacketChannel->GetAddressObject( out_addr );
+	if ( m_isReplaying )
+		*out_addr = m_replayAddress;
+	else
+		m_myPacketChannel->GetAddressObject( out_addr );
 }
 
 
@@ -533,12 +587,7 @@ bool NetSession::Start( uint16_t portNum, unsigned int numAllowedConnections )
 	{
 		SetNumAllowedConnections( numAllowedConnections );
 
-		//We may not mind updating/rendering alongside other sessions registered to these events, but shutdowns may need to occur separately.
-		if ( TheEventSystem::Instance()->IsEventRegistered( "OnNetSessionShutdown" ) )
-		{
-			LogAndShowPrintfWithTag( "NetSession", "Please address separating session shutdown event subscribers before using multiple sessions!" );
-			return false;
-		}
+		//Other sessions share this event, so trigger it with an EngineEvent addressed to the one shutting down, cf. SessionShutdown_Handler.
 		TheEventSystem::Instance()->RegisterEvent<NetSession, &NetSession::SessionShutdown_Handler >( "OnNetSessionShutdown", this );
 
 		m_sessionStateMachine.SetCurrentState( "NetSessionState_Disconnected" );
@@ -559,10 +608,13 @@ bool NetSession::Host( const char* username )
 
 	//Actually make host conn for ourselves, assuming it will succeed, switch state to Connected.
 	sockaddr_in to;
-	m_myPacketChannel->GetAddressObject( &to );
+	GetAddressObject( &to );
 	m_hostConnection = CreateConnection( 0, username, to ); //State switched inside this.
 	if ( m_hostConnection != nullptr )
 	{
+		if ( IsCapturing() )
+			m_capture.WriteHost( username );
+
 		Connect( m_hostConnection, 0 );
 		LogAndShowPrintfWithTag( "NetSession", "NetSession created host connection at its own socket." );
 		m_sessionStateMachine.SetCurrentState( "NetSessionState_Connected" );
@@ -589,6 +641,8 @@ bool NetSession::StartListening()
 		return false;
 	}
 	m_isListening = true;
+	if ( IsCapturing() )
+		m_capture.WriteRecord( NETCAPTURE_RECORD_START_LISTENING );
 	return true;
 }
 
@@ -607,6 +661,8 @@ bool NetSession::StopListening()
 		return false;
 	}
 	m_isListening = false;
+	if ( IsCapturing() )
+		m_capture.WriteRecord( NETCAPTURE_RECORD_STOP_LISTENING );
 	return true;
 }
 
@@ -620,12 +676,15 @@ bool NetSession::Join( const char* username, sockaddr_in& hostAddr )
 		return false;
 	}
 
+	if ( IsCapturing() )
+		m_capture.WriteJoin( username, hostAddr );
+
 	//Create an empty host conn, assuming index 0.
 	m_hostConnection = CreateConnection( 0, "", hostAddr );
 
 	//Create a conn for me as the joiner.
 	sockaddr_in to;
-	m_myPacketChannel->GetAddressObject( &to );
+	GetAddressObject( &to );
 	m_myConnection = CreateConnection( INVALID_CONNECTION_INDEX, username, to );
 
 	//Send join request message to host.
@@ -648,6 +707,9 @@ bool NetSession::Leave()
 		return false;
 	}
 
+	if ( IsCapturing() )
+		m_capture.WriteRecord( NETCAPTURE_RECORD_LEAVE ); //Before StopListening below records itself, which replaying then skips.
+
 	if ( IsMyConnectionHosting() )
 		StopListening();
 
@@ -658,15 +720,17 @@ bool NetSession::Leave()
 		// If I'm the host - needs to tell everyone who !isMe.
 		// If I'm in P2P - needs to tell everyone who !isMe.
 		// If I'm the client - needs to tell host, but may as well write more general case.
+	SharedNetMessagePayload* sharedPayload = NetMessage::CreateSharedPayload( leaveMsg );
 	for each ( NetConnection* conn in m_connections )
 	{
 		if ( conn == nullptr )
 			continue;
 
-		conn->SendMessageToThem( leaveMsg );
+		conn->SendMessageToThem( leaveMsg, sharedPayload );
 		if ( !conn->IsMe() )
 			conn->FlushUnreliables();
 	}
+	NetMessage::ReleaseSharedPayload( sharedPayload );
 
 	Disconnect( m_myConnection ); //Updates state machine to Disconnected inside here.
 	return true;
@@ -685,6 +749,8 @@ bool NetSession::Update( float deltaSeconds )
 {
 	bool didTickNetwork = false;
 
+	RollTrafficStats(); //Ahead of anything that counts into them, so each second's bucket closes on time.
+
 	//Unlike TCP, no checking for [dis]connections.
 	ReceivePackets();
 
@@ -694,56 +760,121 @@ bool NetSession::Update( float deltaSeconds )
 	if ( !m_joiningStateTimeLimit.IsPaused() )
 		m_joiningStateTimeLimit.Update( deltaSeconds );
 
-	m_secondsSinceLastUpdate += deltaSeconds;
-	if ( m_secondsSinceLastUpdate > m_secondsBetweenTicks )
+	//Each connection ticks at its own congestion-controlled rate, and out of phase with the others, cf. NetConnection::UpdateTickTimer.
+	//Every tick handler runs before any packet is built, so the game's done queueing messages by the time ConstructPackets goes wide.
+	m_tickedConnectionIndices.clear();
+	for each ( NetConnection* cp in m_connections )
 	{
-		for each ( NetConnection* cp in m_connections )
+		if ( cp == nullptr )
+			continue;
+
+		if ( !cp->UpdateTickTimer( deltaSeconds ) )
+			continue;
+		float secondsSinceConnectionTick = cp->GetSecondsBetweenLastTicks();
+
+		const double SECONDS_UNTIL_TIMEOUT = 15.0;
+		const double SECONDS_UNTIL_BAD = 5.0;
+		if ( cp->IsConnectionConfirmed() && !cp->IsMe() ) //Don't timeout yourself!
 		{
-			if ( cp == nullptr )
+			double timeLastSeen = cp->GetSecondsSinceLastRecv();
+			cp->AddSecondsSinceLastRecv( secondsSinceConnectionTick ); //Will be overwritten in ConfirmAndWake if we recv from cp.
+			if ( m_usesTimeouts && ( timeLastSeen > SECONDS_UNTIL_TIMEOUT ) )
+			{
+				LogAndShowPrintfWithTag( "NetSession", "Disconnecting %s at connection #%u.", cp->GetGuidString().c_str(), cp->GetIndex() );
+				Disconnect( cp );
 				continue;
+			}
 
-			const double SECONDS_UNTIL_TIMEOUT = 15.0;
-			const double SECONDS_UNTIL_BAD = 5.0;
-			if ( cp->IsConnectionConfirmed() && !cp->IsMe() ) //Don't timeout yourself!
-			{
-				double timeLastSeen = cp->GetSecondsSinceLastRecv();
-				cp->AddSecondsSinceLastRecv( deltaSeconds ); //Will be overwritten in ConfirmAndWake if we recv from cp.
-				if ( m_usesTimeouts && ( timeLastSeen > SECONDS_UNTIL_TIMEOUT ) )
-				{
-					LogAndShowPrintfWithTag( "NetSession", "Disconnecting %s at connection #%u.", cp->GetGuidString().c_str(), cp->GetIndex() );
-					Disconnect( cp );
-					continue;
-				}
 
+			if ( timeLastSeen > SECONDS_UNTIL_BAD )
+				cp->SetAsBadConnection(); //Only sent heartbeats until it responds.
+		}
 
-				if ( timeLastSeen > SECONDS_UNTIL_BAD )
-					cp->SetAsBadConnection(); //Only sent heartbeats until it responds.
-			}
+		EngineEventNetworked ev( cp );
+		ev.SetDeltaSeconds( secondsSinceConnectionTick );
+		TheEventSystem::Instance()->TriggerEvent( "OnNetworkTick", &ev ); //Make sure game-side is subbed to this!
+		didTickNetwork = true;
 
-			EngineEventNetworked ev( cp );
-			ev.SetDeltaSeconds( deltaSeconds );
-			TheEventSystem::Instance()->TriggerEvent( "OnNetworkTick", &ev ); //Make sure game-side is subbed to this!
-			didTickNetwork = true;
+		m_tickedConnectionIndices.push_back( cp->GetIndex() );
+	}
 
-			cp->ConstructAndSendPacket(); //Could add a whole bunch over multiple frames. Our first step toward packet consolidation.
-		}
-	
-		m_secondsSinceLastUpdate = 0.f; //May want a non-global tick rate to send packets more slowly to congested peers.
+	m_connectionsToSend.clear();
+	for each ( NetConnectionIndex connIndex in m_tickedConnectionIndices )
+	{
+		NetConnection* cp = GetIndexedConnection( connIndex );
+		if ( cp == nullptr )
+			continue;
+
+		cp->PrepareToConstructPacket(); //Only now, since a later connection's tick handler may still have queued to this one.
+		m_connectionsToSend.push_back( cp );
 	}
 
+	ConstructPackets( m_connectionsToSend );
+
+	for each ( NetConnection* cp in m_connectionsToSend )
+		cp->SendConstructedPacket(); //One batch on this thread, since the socket, capture and simulated lag/loss are shared.
+
 	return didTickNetwork;
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
-bool NetSession::SetNumAllowedConnections( int newVal )
+static void ConstructPacketsJob( Job* job )
+{
+	NetConnection** connections = job->Read<NetConnection**>();
+	size_t numConnections = job->Read<size_t>();
+
+	for ( size_t connIndex = 0; connIndex < numConnections; connIndex++ )
+		connections[ connIndex ]->ConstructPacket();
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetSession::ConstructPackets( std::vector< NetConnection* >& connections )
 {
-	if ( ( newVal > 0 ) && ( newVal < MAX_CONNECTIONS ) )
+	JobSystem* jobSystem = JobSystem::Instance();
+	size_t numConnections = connections.size();
+	if ( !jobSystem->IsRunning() || ( numConnections < ( MIN_CONNECTIONS_PER_PACKET_JOB * 2 ) ) )
 	{
-		m_numAllowedConnections = newVal;
-		return true;
+		for each ( NetConnection* cp in connections )
+			cp->ConstructPacket();
+		return;
 	}
-	return false;
+
+	size_t numBatches = GetMin( numConnections / MIN_CONNECTIONS_PER_PACKET_JOB, (size_t)MAX_PACKET_JOBS + 1 ); //+1 for the batch we keep.
+	size_t connectionsPerBatch = ( numConnections + numBatches - 1 ) / numBatches;
+
+	//The first batch stays on this thread, which would otherwise only be waiting.
+	m_packetJobs.clear();
+	for ( size_t firstIndex = connectionsPerBatch; firstIndex < numConnections; firstIndex += connectionsPerBatch )
+	{
+		Job* job = jobSystem->CreateJob( JOB_CATEGORY_GENERIC, ConstructPacketsJob );
+		job->Write<NetConnection**>( &connections[ firstIndex ] );
+		job->Write<size_t>( GetMin( connectionsPerBatch, numConnections - firstIndex ) );
+		jobSystem->DispatchJob( job );
+		m_packetJobs.push_back( job );
+	}
+
+	for ( size_t connIndex = 0; connIndex < connectionsPerBatch; connIndex++ )
+		connections[ connIndex ]->ConstructPacket();
+
+	jobSystem->WaitOnJobsForCompletion( m_packetJobs ); //Helps run whichever are still queued.
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool NetSession::SetNumAllowedConnections( int newVal )
+{
+	if ( ( newVal <= 0 ) || ( newVal > MAX_CONNECTIONS ) )
+		return false;
+
+	for ( size_t connIndex = newVal; connIndex < m_connections.size(); connIndex++ )
+		if ( m_connections[ connIndex ] != nullptr )
+			return false; //Would orphan a live connection.
+
+	m_numAllowedConnections = newVal;
+	m_connections.resize( newVal, nullptr );
+	return true;
 }
 
 
@@ -755,8 +886,8 @@ NetConnection* NetSession::AddConnection( const std::string& joineeGuid, sockadd
 		if ( GetIndexedConnection( connIndex ) != nullptr ) //Slot already filled.
 			continue;
 
-		NetConnection*& newConn = m_connections[ connIndex ];
-		newConn = new NetConnection( this, connIndex, joineeGuid.c_str(), joineeAddr );
+		NetConnection* newConn = new NetConnection( this, connIndex, joineeGuid.c_str(), joineeAddr );
+		SetIndexedConnection( connIndex, newConn );
 		return newConn;
 	}
 
@@ -768,7 +899,7 @@ NetConnection* NetSession::AddConnection( const std::string& joineeGuid, sockadd
 NetConnection* NetSession::CreateConnection( NetConnectionIndex connectionIndex, const char* guid, sockaddr_in addr )
 {
 	//All the cartwheels around invalid index allow a joining connection to make themselves a temp until host assigns their index.
-	ASSERT_OR_DIE( ( connectionIndex < MAX_CONNECTIONS ) || ( connectionIndex == INVALID_CONNECTION_INDEX ), nullptr );
+	ASSERT_OR_DIE( ( connectionIndex < m_connections.size() ) || ( connectionIndex == INVALID_CONNECTION_INDEX ), nullptr );
 
 	if ( connectionIndex != INVALID_CONNECTION_INDEX )
 	{
@@ -791,14 +922,14 @@ NetConnection* NetSession::CreateConnection( NetConnectionIndex connectionIndex,
 //--------------------------------------------------------------------------------------------------------------
 bool NetSession::DestroyConnection( NetConnectionIndex connectionIndex )
 {
-	ASSERT_OR_DIE( connectionIndex < MAX_CONNECTIONS, nullptr );
+	ASSERT_OR_DIE( connectionIndex < m_connections.size(), nullptr );
 
 	NetConnection* conn = GetIndexedConnection( connectionIndex );
 	if ( conn  == nullptr )
 		return false; //Did not exist.
 
+	SetIndexedConnection( connectionIndex, nullptr ); //Before the delete, since it reads conn's address to unhash it.
 	delete conn;
-	SetIndexedConnection( connectionIndex, nullptr );
 
 	return true;
 }
@@ -814,6 +945,14 @@ void NetSession::SendPacket( const sockaddr_in& targetAddr, const NetPacket& pac
 //--------------------------------------------------------------------------------------------------------------
 size_t NetSession::SendTo( sockaddr_in const& targetAddr, void const* data, const size_t dataSize )
 {
+	m_numBytesSent += dataSize; //What we asked to send, i.e. before PacketChannel's simulated loss.
+
+	if ( m_isReplaying )
+		return dataSize; //The capture already holds whatever was sent.
+
+	if ( IsCapturing() )
+		m_capture.WritePacket( NETCAPTURE_RECORD_PACKET_SENT, targetAddr, data, dataSize );
+
 	return m_myPacketChannel->SendTo( targetAddr, data, dataSize );
 }
 
@@ -884,6 +1023,9 @@ float NetSession::GetSimulatedMinAdditionalLoss() const
 //--------------------------------------------------------------------------------------------------------------
 void NetSession::ReceivePackets()
 {
+	if ( m_isReplaying )
+		return; //No socket, ReplayCapture feeds us.
+
 	NetPacket packet;
 	NetSender from;
 	from.ourSession = this;
@@ -892,6 +1034,11 @@ void NetSession::ReceivePackets()
 
 	while ( bytesRead > 0 ) //bytesRead == packetLength, implying we can apply some validation with it.
 	{
+		m_numBytesReceived += bytesRead;
+
+		if ( IsCapturing() )
+			m_capture.WritePacket( NETCAPTURE_RECORD_PACKET_RECEIVED, from.sourceAddr, packet.GetPayloadBuffer(), bytesRead );
+
 		bool success = TryProcessPacket( packet, bytesRead, from );
 		if ( !success )
 			break;
@@ -922,7 +1069,7 @@ bool NetSession::TryProcessPacket( NetPacket &packet, size_t bytesRead, NetSende
 	if ( !lengthMatched )
 		return false; //Don't want to mark it as received, since even the ID might be corrupt.
 
-	NetMessage msg;
+	NetMessage msg( NO_MSG_TYPE_ID, 0, nullptr, 0 ); //Reused as a view onto each message in turn, see ReadMessageFromPacketBuffer.
 	uint8_t msgCount = packet.GetTotalAddedMessages();
 //	if ( msgCount >= 8 )
 //		LogAndShowPrintfWithTag( "InOrderTesting", "Received packet with 8+ messages." );
@@ -932,6 +1079,11 @@ bool NetSession::TryProcessPacket( NetPacket &packet, size_t bytesRead, NetSende
 		if ( !successfulRead )
 			break;
 
+		CountMessageTraffic( msg.GetTypeID(), NETSTAT_MESSAGES_RECEIVED );
+		CountMessageTraffic( msg.GetTypeID(), NETSTAT_BYTES_RECEIVED, (uint32_t)msg.GetTotalWireSize() );
+		if ( from.sourceConnection != nullptr )
+			from.sourceConnection->GetTrafficStats().Add( NETSTAT_MESSAGES_RECEIVED );
+
 		if ( NetSession::CanProcessMessage( from, msg ) ) //Reliable traffic safeguards on this NetSession, e.g. vs double-processing.
 		{
 			if ( from.sourceConnection != nullptr )
@@ -963,6 +1115,7 @@ bool NetSession::TryProcessPacket( NetPacket &packet, size_t bytesRead, NetSende
 
 	if ( from.sourceConnection != nullptr )
 	{
+		from.sourceConnection->GetTrafficStats().Add( NETSTAT_BYTES_RECEIVED, (uint32_t)bytesRead );
 		from.sourceConnection->MarkPacketReceived( ph );
 		from.sourceConnection->ConfirmAndWakeConnection(); //For timeout logic.
 	}
@@ -972,6 +1125,58 @@ bool NetSession::TryProcessPacket( NetPacket &packet, size_t bytesRead, NetSende
 }
 
 
+//--------------------------------------------------------------------------------------------------------------
+double NetSession::GetHostTimeSeconds() const
+{
+	if ( IsMyConnectionHosting() || ( m_hostConnection == nullptr ) )
+		return GetCurrentTimeSeconds();
+
+	return m_hostConnection->GetRemoteTimeSeconds();
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool NetSession::HasHostTimeEstimate() const
+{
+	if ( IsMyConnectionHosting() )
+		return true;
+
+	return ( m_hostConnection != nullptr ) && m_hostConnection->GetClockSync().HasEstimate();
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetSession::CountMessageTraffic( uint8_t msgTypeID, NetTrafficStatType stat, uint32_t amount /*= 1*/ )
+{
+	NetTrafficStats* stats = m_messageTypeStats[ msgTypeID ];
+	if ( stats != nullptr )
+		stats->Add( stat, amount );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetSession::CountMessageSentDirect( const NetMessage& msg )
+{
+	CountMessageTraffic( msg.GetTypeID(), NETSTAT_MESSAGES_SENT );
+	CountMessageTraffic( msg.GetTypeID(), NETSTAT_BYTES_SENT, (uint32_t)msg.GetTotalWireSize() );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetSession::RollTrafficStats()
+{
+	double nowSeconds = GetCurrentTimeSeconds();
+
+	for each ( NetTrafficStats* stats in m_messageTypeStats )
+		if ( stats != nullptr )
+			stats->Roll( nowSeconds );
+
+	for each ( NetConnection* conn in m_connections )
+		if ( conn != nullptr )
+			conn->GetTrafficStats().Roll( nowSeconds );
+}
+
+
 //--------------------------------------------------------------------------------------------------------------
 STATIC bool NetSession::CanProcessMessage( NetSender& from, NetMessage& msg )
 {
@@ -987,7 +1192,8 @@ STATIC bool NetSession::CanProcessMessage( NetSender& from, NetMessage& msg )
 
 
 //--------------------------------------------------------------------------------------------------------------
-void NetSession::RegisterMessage( uint8_t id, const char* debugName, NetMessageCallback* handler, uint32_t controlFlags, uint32_t optionFlags )
+void NetSession::RegisterMessage( uint8_t id, const char* debugName, NetMessageCallback* handler, uint32_t controlFlags, uint32_t optionFlags, 
+								  uint8_t inOrderChannel /*= 0*/, NetMessagePriority priority /*= NETMSG_PRIORITY_NORMAL*/ )
 {
 	ASSERT_OR_DIE( m_sessionStateMachine.GetCurrentState() != nullptr, "Calling RegisterMessage before setting NetSession states!" );
 
@@ -1004,13 +1210,137 @@ void NetSession::RegisterMessage( uint8_t id, const char* debugName, NetMessageC
 	ref.handler = handler; //Check to see if this is nullptr by the ctor? Then we can do isValid checks off that!
 	ref.controlFlags = controlFlags;
 	ref.optionFlags = optionFlags;
+	ref.priority = priority;
+
+	if ( m_messageTypeStats[ id ] == nullptr )
+		m_messageTypeStats[ id ] = new NetTrafficStats();
+
+	if ( inOrderChannel >= MAX_INORDER_CHANNELS )
+	{
+		ERROR_RECOVERABLE( Stringf( "In-order channel %u for message %s exceeds MAX_INORDER_CHANNELS, using channel 0.", inOrderChannel, debugName ) );
+		inOrderChannel = 0;
+	}
+	ref.inOrderChannel = inOrderChannel;
+
+	bool isReliable = ( GET_BIT_AT_BITFIELD_WITHOUT_INDEX_MASKED( optionFlags, NETMSGOPT_RELIABLE ) != 0 );
+	bool isReplaceable = ( GET_BIT_AT_BITFIELD_WITHOUT_INDEX_MASKED( optionFlags, NETMSGOPT_REPLACEABLE ) != 0 );
+	ASSERT_RECOVERABLE( !( isReliable && isReplaceable ), "Reliable messages can't be replaceable, every one of them must arrive!" );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 bool NetSession::IsRunning()
 {
-	return m_myPacketChannel->IsBound();
+	return m_isReplaying || ( ( m_myPacketChannel != nullptr ) && m_myPacketChannel->IsBound() );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool NetSession::StartCapture( const char* filename )
+{
+	if ( !m_sessionStateMachine.IsInState( "NetSessionState_Disconnected" ) || m_isReplaying )
+	{
+		LogAndShowPrintfWithTag( "NetSession", "Wrong state in NetSession::StartCapture, needs to be after Start and before Host or Join!" );
+		return false;
+	}
+
+	sockaddr_in myAddr;
+	GetAddressObject( &myAddr );
+	if ( !m_capture.OpenForWriting( filename, myAddr, (uint16_t)m_numAllowedConnections ) )
+	{
+		LogAndShowPrintfWithTag( "NetSession", "Could not open %s for capturing.", filename );
+		return false;
+	}
+
+	LogAndShowPrintfWithTag( "NetSession", "Capturing to %s.", filename );
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool NetSession::ReplayCapture( const char* filename, NetCaptureReplayStats& out_stats )
+{
+	if ( !m_sessionStateMachine.IsInState( "NetSessionState_Invalid" ) )
+	{
+		LogAndShowPrintfWithTag( "NetSession", "Wrong state in NetSession::ReplayCapture, needs a session that was never started!" );
+		return false;
+	}
+
+	NetCapture capture; //Loads it all up front, so the timing below never includes the disk.
+	if ( !capture.LoadFromFile( filename ) )
+	{
+		LogAndShowPrintfWithTag( "NetSession", "Could not load capture %s.", filename );
+		return false;
+	}
+
+	//What Start() would do, minus the socket.
+	m_isReplaying = true;
+	m_replayAddress = capture.GetSessionAddress();
+	SetNumAllowedConnections( capture.GetNumAllowedConnections() );
+	TheEventSystem::Instance()->RegisterEvent<NetSession, &NetSession::SessionShutdown_Handler >( "OnNetSessionShutdown", this );
+	m_sessionStateMachine.SetCurrentState( "NetSessionState_Disconnected" );
+
+	const std::vector< NetCaptureRecord >& records = capture.GetRecords();
+	if ( !records.empty() )
+		out_stats.capturedSeconds = records.back().secondsSinceCaptureStart - records.front().secondsSinceCaptureStart;
+
+	NetPacket packet;
+	NetSender from;
+	from.ourSession = this;
+
+	double replayStartSeconds = GetCurrentTimeSeconds();
+	for each ( const NetCaptureRecord& record in records )
+	{
+		switch ( record.type )
+		{
+		case NETCAPTURE_RECORD_PACKET_RECEIVED:
+		{
+			if ( record.payloadSize > MAX_PACKET_SIZE )
+			{
+				++out_stats.numPacketsRejected;
+				break;
+			}
+
+			from.sourceAddr = record.addr;
+			from.sourceConnection = nullptr;
+			memcpy( packet.GetPayloadBuffer(), capture.GetPayload( record ), record.payloadSize );
+			m_numBytesReceived += record.payloadSize;
+
+			if ( TryProcessPacket( packet, record.payloadSize, from ) )
+				++out_stats.numPacketsReplayed;
+			else
+				++out_stats.numPacketsRejected;
+			out_stats.numBytesReplayed += record.payloadSize;
+			break;
+		}
+		case NETCAPTURE_RECORD_PACKET_SENT:
+			++out_stats.numPacketsSkipped; //Replaying makes its own, which SendTo drops.
+			break;
+		case NETCAPTURE_RECORD_HOST:
+			Host( record.username.c_str() );
+			break;
+		case NETCAPTURE_RECORD_JOIN:
+		{
+			sockaddr_in hostAddr = record.addr;
+			Join( record.username.c_str(), hostAddr );
+			break;
+		}
+		case NETCAPTURE_RECORD_LEAVE:
+			Leave();
+			break;
+		case NETCAPTURE_RECORD_START_LISTENING:
+			if ( !IsListening() )
+				StartListening();
+			break;
+		case NETCAPTURE_RECORD_STOP_LISTENING:
+			if ( IsListening() )
+				StopListening(); //Else Leave already did.
+			break;
+		}
+	}
+	out_stats.replaySeconds = GetCurrentTimeSeconds() - replayStartSeconds;
+
+	return true;
 }
 
 
@@ -4,15 +4,21 @@
 #include "Engine/Networking/NetMessage.hpp"
 #include "Engine/Networking/NetSystem.hpp"
 #include "Engine/Networking/NetConnection.hpp"
+#include "Engine/Networking/NetCapture.hpp"
 #include "Engine/Core/EngineEvent.hpp"
 #include "Engine/Tools/StateMachine/StateMachine.hpp"
 #include "Engine/Time/Stopwatch.hpp"
+#include <unordered_map>
+#include <vector>
 
 
 #define GAME_PORT					(4334) //Use port scanning if connecting to this fails.
 #define PORT_SCAN_RANGE				(8) //Max # ports to increment up to looking for a free socket.
 #define MAX_PROTOCOL_DEFNS			(256)
-#define MAX_CONNECTIONS				(64) //This means concurrent connections.
+#define MAX_CONNECTIONS				(4096) //Hard cap on concurrent connections, must stay below INVALID_CONNECTION_INDEX.
+#define DEFAULT_NUM_ALLOWED_CONNECTIONS (64) //Until Start() configures the session's actual limit.
+#define MIN_CONNECTIONS_PER_PACKET_JOB (8) //Any fewer and handing the job off costs more than building its packets, cf. NetSession::ConstructPackets.
+#define MAX_PACKET_JOBS				(32) //Per Update, well under JobSystem's MAX_NUM_JOBS at MAX_CONNECTIONS.
 
 
 //-----------------------------------------------------------------------------
@@ -21,6 +27,7 @@ class PacketChannel;
 class NetPacket;
 class NetSession;
 class Command;
+struct Job;
 // extern NetSession* g_theNetSession; //Needed it exposed for game-side NetSessionStart command.
 // 	//Just one for now. Can actually have more with various msgtypes registered to them.
 // 	//e.g. A group session for when a guild gathers for private chat system handling msgtypes unneeded when playing alone.
@@ -72,6 +79,13 @@ public:
 	bool IsRunning();
 	~NetSession();
 
+	bool StartCapture( const char* filename ); //Records every datagram in and out, plus our own Host/Join/Leave calls. Call between Start and Host/Join.
+	void StopCapture() { m_capture.Close(); }
+	bool IsCapturing() const { return m_capture.IsWriting(); }
+	bool ReplayCapture( const char* filename, NetCaptureReplayStats& out_stats ); //In place of Start, with the captured session's messages registered.
+		//Feeds what it received straight into TryProcessPacket as fast as it can, and drops whatever we'd send, so no socket gets involved.
+	bool IsReplaying() const { return m_isReplaying; }
+
 	bool SessionUpdate( float deltaSeconds );
 	void SessionRender();
 	bool SessionShutdown_Handler( EngineEvent* );
@@ -79,17 +93,19 @@ public:
 	bool Session_StartJoiningTimeoutStopwatch( EngineEvent* );
 	bool Session_OnJoiningTimeoutStopwatchEnded( EngineEvent* );
 
-	void RegisterMessage( uint8_t id, const char* debugName, NetMessageCallback* handler, uint32_t controlFlags, uint32_t optionFlags );
+	void RegisterMessage( uint8_t id, const char* debugName, NetMessageCallback* handler, uint32_t controlFlags, uint32_t optionFlags, 
+						  uint8_t inOrderChannel = 0, NetMessagePriority priority = NETMSG_PRIORITY_NORMAL );
+		//Give unrelated in-order streams different channels, so a loss on one doesn't hold up the others.
 	void SendMessageDirect( const sockaddr_in& addr, NetMessage& msg );
 	void SendMessagesDirect( const sockaddr_in& addr, NetMessage msgs[], int numMessages ); //Multiple messages sent in one or more packets based on MTUs.
 	NetMessageDefinition* FindDefinitionForMessageType( uint8_t idIndex );
 		//Note we don't take in a NetCoreMessageType or a GameMessageType, to support both enum via their base type.
 
 	const char* GetName() const { return m_sessionName; }
-	NetConnection* GetIndexedConnection( NetConnectionIndex index ) { return ( index >= MAX_CONNECTIONS ) ? nullptr : m_connections[ index ]; }
-	NetConnection* FindConnectionByAddressAndPort( sockaddr_in addr ); //Port is inside sockaddr_in struct, name is just for clarity.
+	NetConnection* GetIndexedConnection( NetConnectionIndex index ) { return ( index >= m_connections.size() ) ? nullptr : m_connections[ index ]; }
+	NetConnection* FindConnectionByAddressAndPort( sockaddr_in addr ); //Port is inside sockaddr_in struct, name is just for clarity. Hashed, since it runs per packet.
 	NetConnection* GetMyConnection() const { return m_myConnection; }
-	int8_t GetMyConnectionIndex() const { return ( m_myConnection ? m_myConnection->GetIndex() : INVALID_CONNECTION_INDEX ); }
+	NetConnectionIndex GetMyConnectionIndex() const { return ( m_myConnection ? m_myConnection->GetIndex() : INVALID_CONNECTION_INDEX ); }
 	void GetAddressObject( sockaddr_in* out_addr ) const;
 	void GetConnectionAddress( char* out_addrStrBuffer, size_t bufferSize ) const;
 	bool Update( float deltaSeconds ); //Unlike TCP, no checking for [dis]connections.
@@ -112,16 +128,27 @@ public:
 	void SetSimulatedAdditionalLoss( float lossPercentile01 );
 	bool ToggleTimeouts() { m_usesTimeouts = !m_usesTimeouts; return m_usesTimeouts; }
 
-	bool SetNumAllowedConnections( int newVal ); //Can't exceed but can go lower than MAX_CONNECTIONS.
+	bool SetNumAllowedConnections( int newVal ); //Can't exceed but can go lower than MAX_CONNECTIONS. Can't drop a slot still in use.
+	int GetNumAllowedConnections() const { return m_numAllowedConnections; }
 	bool SetSessionStateConnected() { return m_sessionStateMachine.SetCurrentState( "NetSessionState_Connected" ); }
 	NetConnection* AddConnection( const std::string& joineeGuid, sockaddr_in joineeAddr );
 	bool IsHost( NetConnection* connToCheck ) const;
 	bool IsMyConnectionHosting() const { return IsHost( m_myConnection ); }
 	bool IsInJoiningState() const { return m_sessionStateMachine.IsInState( "NetSessionState_Joining" ); }
+	bool IsInConnectedState() const { return m_sessionStateMachine.IsInState( "NetSessionState_Connected" ); }
 	bool IsListening() const { return m_isListening; }
 	bool IsFull() const { return GetNumConnected() > m_numAllowedConnections; }
 	bool HasGuid( const std::string& guid ) const;
 	int GetNumConnected() const;
+	uint64_t GetNumBytesSent() const { return m_numBytesSent; } //Totals since construction, every packet on our socket included.
+	uint64_t GetNumBytesReceived() const { return m_numBytesReceived; }
+	uint32_t GetNumReliablesResent() const { return m_numReliablesResent; } //Across every connection we've had, unlike NetConnection's.
+	void CountReliableResent() { ++m_numReliablesResent; } //Called by our connections.
+	void CountMessageTraffic( uint8_t msgTypeID, NetTrafficStatType stat, uint32_t amount = 1 ); //Called by our connections too.
+	const NetTrafficStats* GetMessageTypeStats( uint8_t msgTypeID ) const { return m_messageTypeStats[ msgTypeID ]; } //Null if never registered.
+	void PrintTrafficStats( bool useMinuteWindow ); //Per message type and per connection, busiest first, to the console.
+	double GetHostTimeSeconds() const; //The host's GetCurrentTimeSeconds, as best our connection to it can tell. Ours if we are the host.
+	bool HasHostTimeEstimate() const; //False until the first clock sync response, while GetHostTimeSeconds is still just our own clock.
 	const NetConnectionInfo* GetHostInfo() const { return ( m_hostConnection ? m_hostConnection->GetConnectionInfo() : nullptr ); }
 	void SendDeny( nuonce_t nuonceFromJoinRequest, JoinDenyReason reason, sockaddr_in toAddr );
 	NetConnection* GetHostConnection() { return m_hostConnection; }
@@ -138,13 +165,17 @@ public:
 private:	
 	void FinalizeDisconnect( NetConnection* conn );
 	size_t SendTo( const sockaddr_in& targetAddr, void const* data, const size_t dataSize );
-	void SetIndexedConnection( NetConnectionIndex index, NetConnection* conn ) { if ( index < MAX_CONNECTIONS ) m_connections[ index ] = conn; }
+	void SetIndexedConnection( NetConnectionIndex index, NetConnection* conn ); //Keeps m_connectionsByAddress in sync, so always go through here.
 	static bool CanProcessMessage( NetSender& from, NetMessage& msg );
 
 	void ReceivePackets(); //Like CheckForMessages in A1's RemoteCommandService.hpp.
 	bool TryProcessPacket( NetPacket &packet, size_t bytesRead, NetSender &from );
+	void CountMessageSentDirect( const NetMessage& msg ); //Connectionless sends only have per-message-type stats to count into.
+	void RollTrafficStats();
+	void ConstructPackets( std::vector< NetConnection* >& connections ); //Spread across JobSystem when it's running and there are enough to be worth it.
 
 	bool IsHost( sockaddr_in addrToCheck ) const;
+	static uint64_t GetAddressKey( const sockaddr_in& addr ) { return ( (uint64_t)addr.sin_addr.S_un.S_addr << 16 ) | addr.sin_port; } //IPv4 and port.
 
 	StateMachine m_sessionStateMachine;
 	PacketChannel* m_myPacketChannel; //Only one per session. Unlike TCP, in UDP everybody's megaphoning via their own socket.
@@ -156,14 +187,24 @@ private:
 	bool m_usesTimeouts;
 	NetConnection* m_hostConnection; //This way we don't assume host connIndex 0, as is false in the case of P2P game host migration.
 	NetConnection* m_myConnection;
-	NetConnection* m_connections[ MAX_CONNECTIONS ];
+	std::vector< NetConnection* > m_connections; //Sized to m_numAllowedConnections, indexed by NetConnectionIndex.
+	std::unordered_map< uint64_t, NetConnection* > m_connectionsByAddress; //Mirrors m_connections, keyed by GetAddressKey().
+	std::vector< NetConnectionIndex > m_tickedConnectionIndices; //Scratch for Update, kept so it doesn't allocate every frame.
+	std::vector< NetConnection* > m_connectionsToSend; //Ditto, looked back up from the indices since an OnNetworkTick handler may disconnect others.
+	std::vector< Job* > m_packetJobs; //Ditto, for ConstructPackets.
 
-	float m_secondsBetweenTicks; //i.e. network update ticks.
-	float m_secondsSinceLastUpdate;
 
 	const char* m_sessionName;
 	int m_numAllowedConnections;
 	bool m_isListening;
 	nuonce_t m_lastSentRequestNuonce;
 	Stopwatch m_joiningStateTimeLimit;
+	uint64_t m_numBytesSent;
+	uint64_t m_numBytesReceived;
+	uint32_t m_numReliablesResent;
+	NetTrafficStats* m_messageTypeStats[ MAX_PROTOCOL_DEFNS ]; //Made in RegisterMessage, so sessions only pay for the types they use.
+
+	NetCapture m_capture;
+	bool m_isReplaying;
+	sockaddr_in m_replayAddress; //The captured session's socket, standing in for ours so NetConnection::IsMe still holds.
 };
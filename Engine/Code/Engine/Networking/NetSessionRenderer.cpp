@@ -2,6 +2,63 @@
 #include "Engine/Networking/PacketChannel.hpp"
 #include "Engine/Renderer/TheRenderer.hpp"
 #include "Engine/Core/TheConsole.hpp"
+#include <algorithm>
+
+
+//--------------------------------------------------------------------------------------------------------------
+static uint32_t GetTrafficBytes( const NetTrafficStats* stats, bool useMinuteWindow ) //Sent and received, what we sort the busiest by.
+{
+	if ( useMinuteWindow )
+		return stats->GetLastMinute( NETSTAT_BYTES_SENT ) + stats->GetLastMinute( NETSTAT_BYTES_RECEIVED );
+	else
+		return stats->GetLastSecond( NETSTAT_BYTES_SENT ) + stats->GetLastSecond( NETSTAT_BYTES_RECEIVED );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+static std::string GetTrafficStatsString( const NetTrafficStats* stats, bool useMinuteWindow )
+{
+	uint32_t( NetTrafficStats::*getStat )( NetTrafficStatType ) const = useMinuteWindow ? &NetTrafficStats::GetLastMinute : &NetTrafficStats::GetLastSecond;
+
+	return Stringf( "sent[%uB in %u]\t recv[%uB in %u]\t resent[%u]\t dropped[%u]",
+		( stats->*getStat )( NETSTAT_BYTES_SENT ), ( stats->*getStat )( NETSTAT_MESSAGES_SENT ),
+		( stats->*getStat )( NETSTAT_BYTES_RECEIVED ), ( stats->*getStat )( NETSTAT_MESSAGES_RECEIVED ),
+		( stats->*getStat )( NETSTAT_RELIABLES_RESENT ), ( stats->*getStat )( NETSTAT_MESSAGES_DROPPED ) );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetSession::PrintTrafficStats( bool useMinuteWindow )
+{
+	std::vector< uint8_t > busiestTypeIDs;
+	for ( int msgTypeID = 0; msgTypeID < MAX_PROTOCOL_DEFNS; msgTypeID++ )
+	{
+		const NetTrafficStats* stats = m_messageTypeStats[ msgTypeID ];
+		if ( ( stats != nullptr ) && stats->HadTrafficInLastMinute() )
+			busiestTypeIDs.push_back( (uint8_t)msgTypeID );
+	}
+
+	std::stable_sort( busiestTypeIDs.begin(), busiestTypeIDs.end(), [ this, useMinuteWindow ]( uint8_t lhs, uint8_t rhs )
+	{
+		return GetTrafficBytes( m_messageTypeStats[ lhs ], useMinuteWindow ) > GetTrafficBytes( m_messageTypeStats[ rhs ], useMinuteWindow );
+	} );
+
+	g_theConsole->Printf( "%s traffic over the last %s, by message type:", m_sessionName, useMinuteWindow ? "minute" : "second" );
+	for each ( uint8_t msgTypeID in busiestTypeIDs )
+	{
+		const std::string& statsStr = GetTrafficStatsString( m_messageTypeStats[ msgTypeID ], useMinuteWindow );
+		g_theConsole->Printf( "  %3u %-24s %s", msgTypeID, m_validMessages[ msgTypeID ].debugName, statsStr.c_str() );
+	}
+
+	g_theConsole->Printf( "By connection (bytes are whole packets):" );
+	for each ( NetConnection* conn in m_connections )
+	{
+		if ( conn == nullptr )
+			continue;
+		const std::string& statsStr = GetTrafficStatsString( &conn->GetTrafficStats(), useMinuteWindow );
+		g_theConsole->Printf( "  %3u %-24s %s", conn->GetIndex(), conn->GetGuidString().c_str(), statsStr.c_str() );
+	}
+}
 
 
 //--------------------------------------------------------------------------------------------------------------
@@ -23,7 +80,7 @@ void NetSession::RenderDebug()
 
 	int connCount = GetNumConnected();
 
-	float currentTop = uniformStrHeight * ( 3 + connCount ) + 10; //(3 below fixed strs + x connection strs).
+	float currentTop = uniformStrHeight * ( 4 + connCount ) + 10; //(4 below fixed strs + x connection strs).
 	if ( g_theConsole->IsVisible() )
 		currentTop += g_theConsole->GetCurrentLogBoxTopLeft().y; //height is 0 at bottom of screen.
 	float currentLeft = 50;
@@ -36,7 +93,35 @@ void NetSession::RenderDebug()
 	g_theRenderer->DrawTextProportional2D( Vector2f( currentLeft, currentTop ),	simStr );
 	currentTop -= uniformStrHeight;
 
-	g_theRenderer->DrawTextProportional2D( Vector2f( currentLeft, currentTop ), Stringf("Connection Count: %d/%d", connCount, MAX_CONNECTIONS ) );
+	g_theRenderer->DrawTextProportional2D( Vector2f( currentLeft, currentTop ), Stringf("Connection Count: %d/%d", connCount, m_numAllowedConnections ) );
+	currentTop -= uniformStrHeight;
+
+	const int NUM_BUSIEST_TYPES_SHOWN = 3; //The rest are a NetSessionTraffic command away.
+	uint8_t busiestTypeIDs[ NUM_BUSIEST_TYPES_SHOWN ] = { 0 };
+	uint32_t busiestTypeBytes[ NUM_BUSIEST_TYPES_SHOWN ] = { 0 };
+	for ( int msgTypeID = 0; msgTypeID < MAX_PROTOCOL_DEFNS; msgTypeID++ )
+	{
+		if ( m_messageTypeStats[ msgTypeID ] == nullptr )
+			continue;
+
+		uint8_t typeID = (uint8_t)msgTypeID;
+		uint32_t bytes = GetTrafficBytes( m_messageTypeStats[ msgTypeID ], false );
+		for ( int rank = 0; rank < NUM_BUSIEST_TYPES_SHOWN; rank++ )
+		{
+			if ( bytes <= busiestTypeBytes[ rank ] )
+				continue;
+
+			std::swap( bytes, busiestTypeBytes[ rank ] ); //Bumps the rest down a rank.
+			std::swap( typeID, busiestTypeIDs[ rank ] );
+		}
+	}
+	std::string busiestStr = "Busiest (last 1s):";
+	for ( int rank = 0; rank < NUM_BUSIEST_TYPES_SHOWN; rank++ )
+	{
+		if ( busiestTypeBytes[ rank ] > 0 )
+			busiestStr += Stringf( "  %s %.1fKB/s", m_validMessages[ busiestTypeIDs[ rank ] ].debugName, busiestTypeBytes[ rank ] / 1024.f );
+	}
+	g_theRenderer->DrawTextProportional2D( Vector2f( currentLeft, currentTop ), busiestStr );
 	currentTop -= uniformStrHeight;
 
 	for each ( NetConnection* conn in m_connections )
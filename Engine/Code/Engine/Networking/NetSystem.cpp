@@ -5,6 +5,7 @@
 #include "Engine/Core/TheConsole.hpp"
 #include "Engine/Core/Command.hpp"
 #include "Engine/Networking/RemoteCommandService.hpp" //For console command registration and autostart.
+#include "Engine/Networking/NetLoadTest.hpp" //For console command registration.
 #include "Engine/Networking/NetSession.hpp" //For registering console commands.
 #include "Engine/Networking/PacketChannel.hpp" //For registering console commands.
 
@@ -57,6 +58,7 @@ STATIC bool NetSystem::Startup()
 
 	g_theConsole->RegisterCommand( "NetListTCPAddresses", NetListTCPAddresses );
 	RemoteCommandService::RegisterConsoleCommands();
+	NetLoadTest::RegisterConsoleCommands();
 	RemoteCommandService::Autoconnect();
 
 	return ( error != 0 );
@@ -0,0 +1,71 @@
+#include "Engine/Networking/NetTrafficStats.hpp"
+
+
+#include <string.h>
+
+
+//--------------------------------------------------------------------------------------------------------------
+NetTrafficStats::NetTrafficStats()
+{
+	Clear();
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetTrafficStats::Clear()
+{
+	memset( m_buckets, 0, sizeof( m_buckets ) );
+	memset( m_currentBucket, 0, sizeof( m_currentBucket ) );
+	memset( m_minuteTotals, 0, sizeof( m_minuteTotals ) );
+	m_newestBucketIndex = 0;
+	m_currentBucketStartSeconds = -1.0;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetTrafficStats::Roll( double nowSeconds )
+{
+	if ( m_currentBucketStartSeconds < 0.0 )
+	{
+		m_currentBucketStartSeconds = nowSeconds;
+		return;
+	}
+
+	int numSecondsPassed = (int)( nowSeconds - m_currentBucketStartSeconds );
+	if ( numSecondsPassed <= 0 )
+		return;
+
+	if ( numSecondsPassed > NETSTAT_WINDOW_SECONDS ) //e.g. a long hitch or breakpoint, every bucket would roll out anyway.
+	{
+		Clear();
+		m_currentBucketStartSeconds = nowSeconds;
+		return;
+	}
+
+	for ( int secondNum = 0; secondNum < numSecondsPassed; secondNum++ )
+	{
+		m_newestBucketIndex = ( m_newestBucketIndex + 1 ) % NETSTAT_WINDOW_SECONDS; //Overwrites the oldest.
+		uint32_t* bucket = m_buckets[ m_newestBucketIndex ];
+
+		for ( int stat = 0; stat < NUM_NETSTAT_TYPES; stat++ )
+		{
+			m_minuteTotals[ stat ] -= bucket[ stat ];
+			bucket[ stat ] = ( secondNum == 0 ) ? m_currentBucket[ stat ] : 0; //Any seconds after the first passed with no Update, so no traffic.
+			m_minuteTotals[ stat ] += bucket[ stat ];
+		}
+	}
+
+	memset( m_currentBucket, 0, sizeof( m_currentBucket ) );
+	m_currentBucketStartSeconds += numSecondsPassed;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool NetTrafficStats::HadTrafficInLastMinute() const
+{
+	for ( int stat = 0; stat < NUM_NETSTAT_TYPES; stat++ )
+		if ( m_minuteTotals[ stat ] > 0 )
+			return true;
+
+	return false;
+}
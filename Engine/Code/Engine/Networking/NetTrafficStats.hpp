@@ -0,0 +1,45 @@
+#pragma once
+
+
+#include <stdint.h>
+
+
+//-----------------------------------------------------------------------------
+#define NETSTAT_WINDOW_SECONDS (60) //One-second buckets, so the minute window is exact to the second.
+
+
+//-----------------------------------------------------------------------------
+enum NetTrafficStatType : uint8_t
+{
+	NETSTAT_BYTES_SENT, //Per message type: each message's wire size. Per connection: whole datagrams, packet headers included.
+	NETSTAT_BYTES_RECEIVED,
+	NETSTAT_MESSAGES_SENT, //Resends included.
+	NETSTAT_MESSAGES_RECEIVED,
+	NETSTAT_RELIABLES_RESENT,
+	NETSTAT_MESSAGES_DROPPED, //Unreliables that never found room in a packet, and reliables that never found room in the queue.
+	NUM_NETSTAT_TYPES
+};
+
+
+//-----------------------------------------------------------------------------
+class NetTrafficStats //Rolling totals over the last second and the last minute, cf. NetSession::GetMessageTypeStats and NetConnection::GetTrafficStats.
+{
+public:
+	NetTrafficStats();
+
+	void Add( NetTrafficStatType stat, uint32_t amount = 1 ) { m_currentBucket[ stat ] += amount; } //Never reads the clock, it's hit per message.
+	void Roll( double nowSeconds ); //Closes out the current bucket once a whole second has passed. Called each NetSession::Update.
+	void Clear();
+
+	uint32_t GetLastSecond( NetTrafficStatType stat ) const { return m_buckets[ m_newestBucketIndex ][ stat ]; } //The last whole second.
+	uint32_t GetLastMinute( NetTrafficStatType stat ) const { return m_minuteTotals[ stat ]; }
+	bool HadTrafficInLastMinute() const;
+
+
+private:
+	uint32_t m_buckets[ NETSTAT_WINDOW_SECONDS ][ NUM_NETSTAT_TYPES ];
+	uint32_t m_currentBucket[ NUM_NETSTAT_TYPES ]; //Still filling, not yet in either window.
+	uint32_t m_minuteTotals[ NUM_NETSTAT_TYPES ]; //Kept as buckets roll in and out, rather than summed on every Get.
+	int m_newestBucketIndex;
+	double m_currentBucketStartSeconds; //Negative until the first Roll.
+};
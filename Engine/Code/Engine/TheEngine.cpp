@@ -20,6 +20,7 @@
 //SD6
 #include "Engine/Networking/NetSystem.hpp"
 #include "Engine/Networking/RemoteCommandService.hpp"
+#include "Engine/Networking/NetLoadTest.hpp"
 #include "Engine/Core/TheEventSystem.hpp"
 
 
@@ -30,6 +31,7 @@ TheEngine* g_theEngine = nullptr;
 //--------------------------------------------------------------------------------------------------------------
 static void RegisterConsoleCommands()
 {
+#ifndef HEADLESS_SERVER //Their definitions live in FBXUtils and the renderer, which servers don't build.
 	//AES A1
 	g_theConsole->RegisterCommand( "FBXList", FBXList );
 
@@ -49,6 +51,7 @@ static void RegisterConsoleCommands()
 	//AES A5
 	g_theConsole->RegisterCommand( "AnimationLoadFromFile", AnimationLoadFromFile );
 	g_theConsole->RegisterCommand( "AnimationSaveLastAnimationMade", AnimationSaveLastAnimationMade );
+#endif
 
 	//SD5 A2
 	Logger::RegisterConsoleCommands();
@@ -63,6 +66,7 @@ void TheEngine::Startup( double screenWidth, double screenHeight )
 	//	Allocation/Constructor Calls
 	//-----------------------------------------------------------------------------
 
+#ifndef HEADLESS_SERVER //Servers draw and play nothing, so need neither a GL driver nor an audio device.
 	//Make sure Renderer ctor comes first so that default texture gets ID of 1. Args configure FBO dimensions.
 	g_theRenderer = new TheRenderer( screenWidth, screenHeight );
 	g_theDebugRenderCommands = new std::list< DebugRenderCommand* >();
@@ -71,14 +75,17 @@ void TheEngine::Startup( double screenWidth, double screenHeight )
 	// [static] SoundID musicID = g_theAudio->CreateOrGetSound( "Data/Audio/Yume Nikki mega mix (SD).mp3" );
 	// [g_bgMusicChannel =] g_theAudio->PlaySound( musicID );
 		//This is declared as AudioChannelHandle g_bgMusicChannel; necessary to track for things like turning on looping.
+#endif
 
 	g_theGame = new TheGame();
 
 	g_theInput = new TheInput();
+#ifndef HEADLESS_SERVER //Leave the cursor alone, there's no window to keep it in.
 	Vector2i screenCenter = Vector2i( (int)( screenWidth / 2.0 ), (int)( screenHeight / 2.0 ) );
 	g_theInput->SetCursorSnapToPos( screenCenter );
 	g_theInput->OnGainedFocus();
 	g_theInput->HideCursor();
+#endif
 
 #ifdef PLATFORM_RIFT_CV1
 	g_theConsole = new TheConsole(screenWidth/2., screenHeight/2., screenWidth, screenHeight);
@@ -96,9 +103,13 @@ void TheEngine::Startup( double screenWidth, double screenHeight )
 
 	SeedWindowsRNG();
 
+#ifdef HEADLESS_SERVER
+	g_theGame->Startup();
+#else
 	g_theRenderer->PreGameStartup();
 	g_theGame->Startup();
 	g_theRenderer->PostGameStartup();
+#endif
 }
 
 
@@ -119,6 +130,8 @@ void TheEngine::RunFrame( bool shouldRender /*= true*/ )
 		}
 	}
 	g_theRenderer->SubmitFrameToRift();
+#elif defined( HEADLESS_SERVER )
+	UNREFERENCED( shouldRender ); //Nothing to render with.
 #else
 	if ( shouldRender )
 		this->Render();
@@ -136,25 +149,35 @@ void TheEngine::Update( float deltaSeconds )
 	if ( !RemoteCommandService::Instance()->IsDisconnected() )
 		RemoteCommandService::Instance()->Update();
 
+	if ( NetLoadTest::Instance()->IsRunning() )
+		NetLoadTest::Instance()->Update( deltaSeconds );
+
+#ifndef HEADLESS_SERVER
 	g_theAudio->Update();
+#endif
 
 	if ( g_theInput->WasKeyPressedOnce( KEY_TO_TOGGLE_DEBUG_INFO ) ) 
 		g_inDebugMode = !g_inDebugMode;
 
 	g_theConsole->Update( deltaSeconds ); //Delta +='d into caret's alpha.
 
+#ifndef HEADLESS_SERVER
 	g_theRenderer->Update( deltaSeconds, g_theGame->GetActiveCamera3D() );
 		//Update uniforms for shader timers, scene MVP, and lights.
+#endif
 
 	TODO( "Explore passing in 0 to freeze, or other values to rewind, slow, etc." );
 	g_theGame->Update( deltaSeconds );
 
+#ifndef HEADLESS_SERVER
 	UpdateDebugCommands( deltaSeconds );
+#endif
 
 	Profiler::Instance()->EndSample( sample );
 }
 
 
+#ifndef HEADLESS_SERVER
 //--------------------------------------------------------------------------------------------------------------
 void TheEngine::RenderDebug3D()
 {
@@ -273,6 +296,7 @@ void TheEngine::Render()
 
 	//Main_Win32 should call TheApp's FlipAndPresent() next.
 }
+#endif
 
 
 //--------------------------------------------------------------------------------------------------------------
@@ -280,24 +304,32 @@ void TheEngine::Shutdown()
 {
 	//Any other subsystems that have their own Shutdown() equivalent call here.
 	NetSystem::Shutdown();
+#ifndef HEADLESS_SERVER
 	ClearDebugCommands();
+#endif
 	g_theGame->Shutdown();
+#ifndef HEADLESS_SERVER
 	g_theRenderer->Shutdown();
+#endif
 	g_theConsole->CleanupEntries();
 
 	//-----------------------------------------------------------------------------
 	delete g_theGame;
+#ifndef HEADLESS_SERVER
 	delete g_theAudio;
 	delete g_theRenderer;
 	delete g_theDebugRenderCommands;
+#endif
 	delete g_theInput;
 	delete g_theConsole;
 
 	//-----------------------------------------------------------------------------
 	g_theGame = nullptr;
+#ifndef HEADLESS_SERVER
 	g_theAudio = nullptr;
-	g_theInput = nullptr;
 	g_theRenderer = nullptr;
 	g_theDebugRenderCommands = nullptr;
+#endif
+	g_theInput = nullptr;
 	g_theConsole = nullptr;
 }
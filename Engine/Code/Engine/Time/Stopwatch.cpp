@@ -16,6 +16,9 @@ void Stopwatch::Update( float deltaSeconds )
 			//Otherwise it would reset this stopwatch and we'd immediately Stop() afterward.
 
 		if ( m_endingEventID != nullptr )
-			TheEventSystem::Instance()->TriggerEvent( m_endingEventID );
+		{
+			EngineEvent endingEvent( m_endingEventID, m_endingEventRecipient );
+			TheEventSystem::Instance()->TriggerEvent( m_endingEventID, &endingEvent );
+		}
 	}
 }
@@ -8,10 +8,11 @@
 class Stopwatch
 {
 public:
-	Stopwatch( float endTimeSeconds, EngineEventID endingEventID = nullptr )
+	Stopwatch( float endTimeSeconds, EngineEventID endingEventID = nullptr, void* endingEventRecipient = nullptr )
 		: m_currentTimeSeconds( 0.f )
 		, m_endTimeSeconds( endTimeSeconds )
 		, m_endingEventID( endingEventID )
+		, m_endingEventRecipient( endingEventRecipient )
 	{
 		Stop();
 	}
@@ -33,4 +34,5 @@ private:
 	float m_endTimeSeconds;
 	float m_currentTimeSeconds;
 	EngineEventID m_endingEventID;
+	void* m_endingEventRecipient; //So subscribers sharing m_endingEventID can tell whose stopwatch ended, cf. EngineEvent::IsIntendedForThis.
 };
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include "Game/Game Entities/LagCompensationHistory.hpp"
+#include "Engine/Math/MathUtils.hpp"
+
+
+//--------------------------------------------------------------------------------------------------------------
+void LagCompensationHistory::Record( double hostSeconds, const AABB2f& bounds )
+{
+	if ( ( m_numRecords > 0 ) && ( hostSeconds <= GetNthNewest( 0 ).hostSeconds ) )
+	{
+		m_records[ m_newestIndex ].bounds = bounds; //Clock didn't advance since the last frame, keep the latest.
+		return;
+	}
+
+	//The newest slides forward with each frame until it's an interval past the one before, then stays put and the next frame starts a new one.
+	bool isNewestSettled = ( m_numRecords < 2 ) || ( ( GetNthNewest( 0 ).hostSeconds - GetNthNewest( 1 ).hostSeconds ) >= LAGCOMP_RECORD_INTERVAL_SECONDS );
+	if ( m_numRecords == 0 )
+		m_numRecords = 1;
+	else if ( isNewestSettled )
+	{
+		m_newestIndex = ( m_newestIndex + 1 ) % LAGCOMP_HISTORY_LENGTH;
+		if ( m_numRecords < LAGCOMP_HISTORY_LENGTH )
+			++m_numRecords;
+	}
+
+	LagCompensationRecord& record = m_records[ m_newestIndex ];
+	record.hostSeconds = hostSeconds;
+	record.bounds = bounds;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool LagCompensationHistory::GetBoundsAt( double hostSeconds, AABB2f& out_bounds ) const
+{
+	if ( m_numRecords == 0 )
+		return false;
+
+	if ( hostSeconds >= GetNthNewest( 0 ).hostSeconds )
+	{
+		out_bounds = GetNthNewest( 0 ).bounds;
+		return true;
+	}
+
+	//Walk back to the pair bracketing hostSeconds, a rewind is usually only a handful of ticks.
+	for ( int olderN = 1; olderN < m_numRecords; olderN++ )
+	{
+		const LagCompensationRecord& older = GetNthNewest( olderN );
+		if ( older.hostSeconds > hostSeconds )
+			continue;
+
+		const LagCompensationRecord& newer = GetNthNewest( olderN - 1 );
+		float t = (float)( ( hostSeconds - older.hostSeconds ) / ( newer.hostSeconds - older.hostSeconds ) ); //Record keeps these strictly increasing.
+		out_bounds.mins = Lerp( older.bounds.mins, newer.bounds.mins, t );
+		out_bounds.maxs = Lerp( older.bounds.maxs, newer.bounds.maxs, t );
+		return true;
+	}
+
+	out_bounds = GetNthNewest( m_numRecords - 1 ).bounds; //Before it spawned, or past what we keep, so as early as we know.
+	return true;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Engine/Math/AABB2.hpp"
+
+
+//-----------------------------------------------------------------------------
+#define LAGCOMP_MAX_REWIND_SECONDS ( .5 ) //Past this a client's view is too stale to trust, so they eat the difference instead of everyone else.
+#define LAGCOMP_RECORD_INTERVAL_SECONDS ( 1.0 / 60.0 ) //UpdateWorld records every frame, but only keeps one this far apart, so the span doesn't shrink as the frame rate climbs.
+#define LAGCOMP_HISTORY_LENGTH ( (int)( LAGCOMP_MAX_REWIND_SECONDS / LAGCOMP_RECORD_INTERVAL_SECONDS + .5 ) + 2 ) //Per entity. The newest is the latest frame's, and one more bridges past the max rewind.
+
+
+//-----------------------------------------------------------------------------
+struct LagCompensationRecord
+{
+	double hostSeconds;
+	AABB2f bounds; //Bounds rather than just position, since e.g. TeardropNPC pulses its scale.
+};
+
+
+//-----------------------------------------------------------------------------
+class LagCompensationHistory //Host-side ring of where an entity was, so collisions can be tested against what a lagging client saw, cf. TheGame::GetLagCompensatedSeconds.
+{
+public:
+	LagCompensationHistory() { Clear(); }
+
+	void Clear() { m_numRecords = 0; m_newestIndex = 0; }
+	void Record( double hostSeconds, const AABB2f& bounds ); //Overwrites the oldest when full, or the newest if it's within LAGCOMP_RECORD_INTERVAL_SECONDS of the one before.
+	bool GetBoundsAt( double hostSeconds, AABB2f& out_bounds ) const; //False if empty. Holds the oldest or newest outside the recorded span.
+
+
+private:
+	const LagCompensationRecord& GetNthNewest( int n ) const { return m_records[ ( m_newestIndex + LAGCOMP_HISTORY_LENGTH - n ) % LAGCOMP_HISTORY_LENGTH ]; }
+
+	LagCompensationRecord m_records[ LAGCOMP_HISTORY_LENGTH ];
+	int m_newestIndex;
+	int m_numRecords;
+};
@@ -1,24 +1,33 @@
 #include "Game/Game Entities/NetObject Protocols/ProtocolPlayerAvatar.hpp"
 #include "Game/Game Entities/NetObjectProtocol.hpp"
+#include "Game/Game Entities/NetObjectSystem.hpp"
 #include "Game/Game Entities/PlayerAvatar.hpp"
 #include "Game/Game Entities/PlayerController.hpp"
 #include "Game/TheGame.hpp"
 #include "Engine/Networking/NetSession.hpp"
+#include "Engine/Networking/NetConnectionUtils.hpp"
+#include "Engine/Memory/BitPacker.hpp"
+#include "Engine/Time/Time.hpp"
 
 
 //--------------------------------------------------------------------------------------------------------------
 void* Protocol_PlayerAvatar::OnCreate( NetMessage& msg ) const
 {
-	PlayerIndex controllerIndex;
-	msg.Read<PlayerIndex>( &controllerIndex );
-	PlayerAvatar* avatar = new PlayerAvatar( g_theGame->GetIndexedPlayerController( controllerIndex ) );
+	BitPacker msgBits( msg, BITPACKER_MODE_READ );
+
+	uint32_t controllerIndex;
+	msgBits.ReadBits( &controllerIndex, sizeof( PlayerIndex ) * NUM_BITS_IN_BYTE );
+	PlayerAvatar* avatar = new PlayerAvatar( g_theGame->GetIndexedPlayerController( (PlayerIndex)controllerIndex ) );
 	
 	Vector2f pos;
-	msg.Read<Vector2f>( &pos );
+	msgBits.ReadQuantizedVector2f( &pos, NETOBJ_POSITION_MINS, NETOBJ_POSITION_MAXS, NETOBJ_POSITION_BITS );
 	avatar->SetPosition( pos );
+	msgBits.FinishOnto( msg );
+#ifndef HEADLESS_SERVER
 	avatar->GetSprite()->Enable();
+#endif
 
-	g_theGame->SetIndexedPlayerAvatar( controllerIndex, avatar );
+	g_theGame->SetIndexedPlayerAvatar( (PlayerIndex)controllerIndex, avatar );
 //	g_theGame->AddToEntityList( createdObject );
 
 	return avatar;
@@ -37,47 +46,55 @@ void Protocol_PlayerAvatar::WriteToCreationMessage( NetObject* netObj, NetMessag
 {
 	PlayerAvatar* playerAvatar = (PlayerAvatar*)( netObj->syncedObject );
 	PlayerController* controller = playerAvatar->GetController();
-	msg.Write<PlayerIndex>( controller->GetPlayerIndex() );
-	msg.Write<Vector2f>( playerAvatar->GetPosition() );
+	BitPacker msgBits( msg, BITPACKER_MODE_WRITE );
+	msgBits.WriteBits( controller->GetPlayerIndex(), sizeof( PlayerIndex ) * NUM_BITS_IN_BYTE );
+	msgBits.WriteQuantizedVector2f( playerAvatar->GetPosition(), NETOBJ_POSITION_MINS, NETOBJ_POSITION_MAXS, NETOBJ_POSITION_BITS );
+	msgBits.FinishOnto( msg );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
-void Protocol_PlayerAvatar::ServerWriteUpdateToMessage( NetObject* netObj, NetMessage& msg ) const
+void Protocol_PlayerAvatar::ServerWriteUpdateToMessage( NetObject* netObj, BitPacker& msgBits ) const
 {
 	PlayerAvatar* playerAvatar = (PlayerAvatar*)( netObj->syncedObject );
-	msg.Write<Vector2f>( playerAvatar->GetPosition() ); //Letting the client own this for now.
-	msg.Write<Vector2f>( playerAvatar->GetVelocity() ); //Letting the client own this for now.
+	msgBits.WriteQuantizedVector2f( playerAvatar->GetPosition(), NETOBJ_POSITION_MINS, NETOBJ_POSITION_MAXS, NETOBJ_POSITION_BITS );
+	msgBits.WriteQuantizedVector2f( playerAvatar->GetVelocity(), NETOBJ_VELOCITY_MINS, NETOBJ_VELOCITY_MAXS, NETOBJ_VELOCITY_BITS );
+	msgBits.WriteBits( playerAvatar->GetActiveForce(), PLAYER_FORCE_BITS );
+	msgBits.WriteBits( playerAvatar->GetLastAppliedInputSequence(), PLAYER_INPUT_SEQUENCE_BITS ); //What the owner rewinds to, cf. PlayerAvatar::Reconcile.
 
 	int8_t swordLevel = playerAvatar->GetSwordLevel();
-	msg.Write<int8_t>( swordLevel );
+	msgBits.WriteBits( swordLevel, SWORD_LEVEL_BITS );
 
 	for ( int8_t swordIndex = 0; swordIndex < swordLevel; swordIndex++ )
-		msg.Write<PrimaryTearColor>( playerAvatar->GetSwordColorAt( swordIndex ) );
+		msgBits.WriteBits( playerAvatar->GetSwordColorAt( swordIndex ), PRIMARY_TEAR_COLOR_BITS );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
-void Protocol_PlayerAvatar::ClientReadAndProcessUpdateFromServer( NetObject* netObj, NetMessage& msg ) const
+void Protocol_PlayerAvatar::ClientReadAndProcessUpdateFromServer( NetObject* netObj, BitPacker& msgBits ) const
 {
 	if ( g_theGame->IsMyConnectionHosting() )
 		return; //Don't need the below, should already be updated.
 
 	PlayerAvatar* playerAvatar = (PlayerAvatar*)( netObj->syncedObject );
-	Vector2f positionOnServer; //Needed because non-owner clients still have to receive the owned avatar's position to update it!
-	msg.Read<Vector2f>( &positionOnServer ); //Might be worth teleporting to this if we get beyond a certain range.
+	Vector2f positionOnServer;
+	msgBits.ReadQuantizedVector2f( &positionOnServer, NETOBJ_POSITION_MINS, NETOBJ_POSITION_MAXS, NETOBJ_POSITION_BITS );
 	Vector2f velocityOnServer;
-	msg.Read<Vector2f>( &velocityOnServer ); //Still need to read these on owners to advance write head inside msg.
+	msgBits.ReadQuantizedVector2f( &velocityOnServer, NETOBJ_VELOCITY_MINS, NETOBJ_VELOCITY_MAXS, NETOBJ_VELOCITY_BITS );
+	uint32_t forceOnServer;
+	msgBits.ReadBits( &forceOnServer, PLAYER_FORCE_BITS );
+	uint32_t lastAppliedInputSequence;
+	msgBits.ReadBits( &lastAppliedInputSequence, PLAYER_INPUT_SEQUENCE_BITS );
 
 	NetSession* sessionRef = g_theGame->GetGameNetSession();
-	if ( netObj->owningConnectionIndex != sessionRef->GetMyConnectionIndex() )
-	{
-		playerAvatar->SetPosition( positionOnServer );
-		playerAvatar->SetVelocity( velocityOnServer ); //Use this to do client-side prediction if I get A7 clock stuff!		
-	}
-
-	int8_t swordLevel;
-	msg.Read<int8_t>( &swordLevel );
+	if ( netObj->owningConnectionIndex == sessionRef->GetMyConnectionIndex() ) //Ours, so we're ahead of this by our unacknowledged inputs.
+		playerAvatar->Reconcile( positionOnServer, velocityOnServer, (PlayerAvatarForce)forceOnServer, (uint16_t)lastAppliedInputSequence );
+	else
+		netObj->snapshots.AddSnapshot( netObj->lastUpdateHostSeconds, positionOnServer, velocityOnServer ); //Applied at a delay, cf. ClientApplySnapshot.
+
+	uint32_t swordLevelBits;
+	msgBits.ReadBits( &swordLevelBits, SWORD_LEVEL_BITS );
+	int8_t swordLevel = (int8_t)swordLevelBits;
 	playerAvatar->SetSwordLevel( swordLevel );
 
 	if ( swordLevel > MAX_NUM_TEAR_COUNT )
@@ -88,9 +105,9 @@ void Protocol_PlayerAvatar::ClientReadAndProcessUpdateFromServer( NetObject* net
 
 	for ( int8_t swordIndex = 0; swordIndex < swordLevel; swordIndex++ )
 	{
-		PrimaryTearColor color;
-		msg.Read<PrimaryTearColor>( &color );
-		playerAvatar->SetSwordColorAt( swordIndex, color );
+		uint32_t color;
+		msgBits.ReadBits( &color, PRIMARY_TEAR_COLOR_BITS );
+		playerAvatar->SetSwordColorAt( swordIndex, (PrimaryTearColor)color );
 	}
 
 	playerAvatar->SetColorFromPrimaryTearColor( playerAvatar->GetSwordColor() );
@@ -98,24 +115,86 @@ void Protocol_PlayerAvatar::ClientReadAndProcessUpdateFromServer( NetObject* net
 
 
 //--------------------------------------------------------------------------------------------------------------
-void Protocol_PlayerAvatar::ClientWriteUpdateToMessage( NetObject* netObj, NetMessage& msg ) const
+void Protocol_PlayerAvatar::ClientWriteUpdateToMessage( NetObject* netObj, BitPacker& msgBits ) const
 {
+	//Inputs, not results: the host steps them itself. Resend every one not yet acknowledged,
+	//since this message is unreliable and replaced by the next tick's, so a lost update loses none of them.
 	PlayerAvatar* playerAvatar = (PlayerAvatar*)( netObj->syncedObject );
-	msg.Write<Vector2f>( playerAvatar->GetPosition() );
-	msg.Write<Vector2f>( playerAvatar->GetVelocity() );
+
+	//When in host time we're rendering everyone else, so the host can test our hits against the world we saw, cf. TheGame::GetLagCompensatedSeconds.
+	bool hasViewTime = g_theGame->GetGameNetSession()->HasHostTimeEstimate();
+	msgBits.WriteBool( hasViewTime );
+	if ( hasViewTime )
+		msgBits.WriteBits( GetWireMilliseconds( NetObjectSystem::ClientGetRenderHostSeconds() ), PLAYER_VIEW_HOST_TIME_BITS );
+
+	const PlayerInputHistory& history = playerAvatar->GetInputHistory();
+	int numInputs = GetMin( history.GetNumInputs(), PLAYER_INPUT_MAX_PER_UPDATE );
+	int firstInputN = history.GetNumInputs() - numInputs; //Newest ones if there's more, the host skips the gap and we reconcile over it.
+
+	msgBits.WriteBits( ( numInputs > 0 ) ? history.GetNthOldest( firstInputN ).sequence : 0, PLAYER_INPUT_SEQUENCE_BITS );
+	msgBits.WriteBits( numInputs, PLAYER_INPUT_COUNT_BITS );
+	for ( int inputN = firstInputN; inputN < history.GetNumInputs(); inputN++ )
+	{
+		const PlayerAvatarInput& input = history.GetNthOldest( inputN );
+		msgBits.WriteBits( input.buttons, PLAYER_INPUT_BUTTON_BITS ); //No delta, every input is one PLAYER_INPUT_STEP_SECONDS.
+	}
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
-void Protocol_PlayerAvatar::ServerReadAndProcessUpdateFromClient( NetObject* netObj, NetMessage& msg ) const
+void Protocol_PlayerAvatar::ServerReadAndProcessUpdateFromClient( NetObject* netObj, BitPacker& msgBits ) const
 {
 	PlayerAvatar* playerAvatar = (PlayerAvatar*)( netObj->syncedObject );
-	Vector2f newPos;
-	msg.Read<Vector2f>( &newPos );
-	playerAvatar->SetPosition( newPos );
 
-	Vector2f newVel;
-	msg.Read<Vector2f>( &newVel );
-	playerAvatar->SetVelocity( newVel );
+	bool hasViewTime;
+	msgBits.ReadBool( &hasViewTime );
+	if ( hasViewTime )
+	{
+		uint32_t viewHostMilliseconds;
+		msgBits.ReadBits( &viewHostMilliseconds, PLAYER_VIEW_HOST_TIME_BITS );
+		playerAvatar->SetOwnerViewHostSeconds( UnwrapWireMilliseconds( viewHostMilliseconds, GetCurrentTimeSeconds() ) ); //Older updates were already dropped by number.
+	}
+
+	uint32_t firstSequence;
+	msgBits.ReadBits( &firstSequence, PLAYER_INPUT_SEQUENCE_BITS );
+	uint32_t numInputs;
+	msgBits.ReadBits( &numInputs, PLAYER_INPUT_COUNT_BITS );
+	if ( numInputs > PLAYER_INPUT_MAX_PER_UPDATE ) //Off the wire, so no dialog.
+	{
+		LogAndShowPrintfWithTag( "NetObjectSystem", "Dropped PlayerAvatar update with %u inputs, past the max of %d.", numInputs, PLAYER_INPUT_MAX_PER_UPDATE );
+		return;
+	}
+
+	playerAvatar->AccrueInputBudget( GetCurrentTimeSeconds() ); //The client's steps only get to spend real time that's passed here.
+
+	for ( uint32_t inputN = 0; inputN < numInputs; inputN++ )
+	{
+		PlayerAvatarInput input;
+		input.sequence = (uint16_t)( firstSequence + inputN );
+
+		uint32_t buttons;
+		msgBits.ReadBits( &buttons, PLAYER_INPUT_BUTTON_BITS );
+		input.buttons = (uint8_t)buttons;
+
+		if ( UnsignedGreaterThan( input.sequence, playerAvatar->GetLastAppliedInputSequence() ) ) //Else a resend we already stepped.
+			playerAvatar->ApplyInputWithinBudget( input );
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void Protocol_PlayerAvatar::ClientApplySnapshot( NetObject* netObj, const NetObjectSnapshot& snapshot ) const
+{
+	PlayerAvatar* playerAvatar = (PlayerAvatar*)( netObj->syncedObject );
+	playerAvatar->SetPosition( snapshot.position );
+	playerAvatar->SetVelocity( snapshot.velocity );
 }
 
+
+//--------------------------------------------------------------------------------------------------------------
+bool Protocol_PlayerAvatar::GetInterestPosition( NetObject* netObj, Vector2f& out_position ) const
+{
+	PlayerAvatar* playerAvatar = (PlayerAvatar*)( netObj->syncedObject );
+	out_position = playerAvatar->GetPosition();
+	return true;
+}
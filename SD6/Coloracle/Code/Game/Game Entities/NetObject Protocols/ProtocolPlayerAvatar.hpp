@@ -12,10 +12,14 @@ public:
 	virtual void OnDestroy( NetObject* ) const override;
 	virtual void WriteToDestroyMessage( NetMessage& ) const override {}
 
-	virtual void ServerWriteUpdateToMessage( NetObject*, NetMessage& msg ) const override;
-	virtual void ClientReadAndProcessUpdateFromServer( NetObject*, NetMessage& msg ) const override;
+	virtual void ServerWriteUpdateToMessage( NetObject*, BitPacker& msgBits ) const override;
+	virtual void ClientReadAndProcessUpdateFromServer( NetObject*, BitPacker& msgBits ) const override;
 
 	//Because this is a client-owned object, these will actually be non-stubs:
-	virtual void ClientWriteUpdateToMessage( NetObject*, NetMessage& msg ) const override;
-	virtual void ServerReadAndProcessUpdateFromClient( NetObject*, NetMessage& msg ) const override;
+	virtual void ClientWriteUpdateToMessage( NetObject*, BitPacker& msgBits ) const override;
+	virtual void ServerReadAndProcessUpdateFromClient( NetObject*, BitPacker& msgBits ) const override;
+
+	virtual float GetUpdateRelevance( NetObject*, NetConnectionIndex ) const override { return 2.f; } //Players outrank NPCs for packet space.
+	virtual bool GetInterestPosition( NetObject*, Vector2f& out_position ) const override; //Always in view, but centers its owner's view.
+	virtual void ClientApplySnapshot( NetObject*, const NetObjectSnapshot& ) const override;
 };
@@ -2,19 +2,24 @@
 #include "Game/Game Entities/TeardropNPC.hpp"
 #include "Game/TheGame.hpp"
 #include "Engine/Networking/NetMessage.hpp"
+#include "Engine/Memory/BitPacker.hpp"
 
 
 //--------------------------------------------------------------------------------------------------------------
 void* Protocol_TeardropNPC::OnCreate( NetMessage& msg ) const
 {
-	PrimaryTearColor color;
-	msg.Read<PrimaryTearColor>( &color );
-	TeardropNPC* newEnemy = new TeardropNPC( color );
+	BitPacker msgBits( msg, BITPACKER_MODE_READ );
+
+	uint32_t color;
+	msgBits.ReadBits( &color, PRIMARY_TEAR_COLOR_BITS );
+	TeardropNPC* newEnemy = new TeardropNPC( (PrimaryTearColor)color );
 
 	Vector2f position;
-	msg.Read<WorldCoords2D>( &position );
+	msgBits.ReadQuantizedVector2f( &position, NETOBJ_POSITION_MINS, NETOBJ_POSITION_MAXS, NETOBJ_POSITION_BITS );
 	newEnemy->SetPosition( position );
 
+	msgBits.FinishOnto( msg );
+
 	g_theGame->AddEnemy( newEnemy );
 
 	return newEnemy;
@@ -35,24 +40,42 @@ void Protocol_TeardropNPC::WriteToCreationMessage( NetObject* netObj, NetMessage
 {
 	TeardropNPC* enemy = (TeardropNPC*)( netObj->syncedObject );
 
-	msg.Write<PrimaryTearColor>( enemy->GetColor() );
-	msg.Write<Vector2f>( enemy->GetPosition() );
+	BitPacker msgBits( msg, BITPACKER_MODE_WRITE );
+	msgBits.WriteBits( enemy->GetColor(), PRIMARY_TEAR_COLOR_BITS );
+	msgBits.WriteQuantizedVector2f( enemy->GetPosition(), NETOBJ_POSITION_MINS, NETOBJ_POSITION_MAXS, NETOBJ_POSITION_BITS );
+	msgBits.FinishOnto( msg );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
-void Protocol_TeardropNPC::ServerWriteUpdateToMessage( NetObject* netObj, NetMessage& msg ) const
+void Protocol_TeardropNPC::ServerWriteUpdateToMessage( NetObject* netObj, BitPacker& msgBits ) const
 {
 	TeardropNPC* enemy = (TeardropNPC*)( netObj->syncedObject );
-	msg.Write<Vector2f>( enemy->GetPosition() );
+	msgBits.WriteQuantizedVector2f( enemy->GetPosition(), NETOBJ_POSITION_MINS, NETOBJ_POSITION_MAXS, NETOBJ_POSITION_BITS );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
-void Protocol_TeardropNPC::ClientReadAndProcessUpdateFromServer( NetObject* netObj, NetMessage& msg ) const
+void Protocol_TeardropNPC::ClientReadAndProcessUpdateFromServer( NetObject* netObj, BitPacker& msgBits ) const
 {
-	TeardropNPC* enemy = (TeardropNPC*)( netObj->syncedObject );
 	Vector2f newPos;
-	msg.Read<Vector2f>( &newPos );
-	enemy->SetPosition( newPos );
+	msgBits.ReadQuantizedVector2f( &newPos, NETOBJ_POSITION_MINS, NETOBJ_POSITION_MAXS, NETOBJ_POSITION_BITS );
+	netObj->snapshots.AddSnapshot( netObj->lastUpdateHostSeconds, newPos, Vector2f::ZERO ); //Applied at a delay, cf. ClientApplySnapshot.
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void Protocol_TeardropNPC::ClientApplySnapshot( NetObject* netObj, const NetObjectSnapshot& snapshot ) const
+{
+	TeardropNPC* enemy = (TeardropNPC*)( netObj->syncedObject );
+	enemy->SetPosition( snapshot.position );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool Protocol_TeardropNPC::GetInterestPosition( NetObject* netObj, Vector2f& out_position ) const
+{
+	TeardropNPC* enemy = (TeardropNPC*)( netObj->syncedObject );
+	out_position = enemy->GetPosition();
+	return true;
 }
@@ -12,10 +12,13 @@ public:
 	virtual void OnDestroy( NetObject* ) const override;
 	virtual void WriteToDestroyMessage( NetMessage& ) const override {}
 
-	virtual void ServerWriteUpdateToMessage( NetObject*, NetMessage& ) const override;
-	virtual void ClientReadAndProcessUpdateFromServer( NetObject*, NetMessage& ) const override;
+	virtual void ServerWriteUpdateToMessage( NetObject*, BitPacker& ) const override;
+	virtual void ClientReadAndProcessUpdateFromServer( NetObject*, BitPacker& ) const override;
 
 	//Not a client-owned object, hence these are stubs.
-	virtual void ClientWriteUpdateToMessage( NetObject*, NetMessage& ) const override {}
-	virtual void ServerReadAndProcessUpdateFromClient( NetObject*, NetMessage& ) const override {}
+	virtual void ClientWriteUpdateToMessage( NetObject*, BitPacker& ) const override {}
+	virtual void ServerReadAndProcessUpdateFromClient( NetObject*, BitPacker& ) const override {}
+
+	virtual bool GetInterestPosition( NetObject*, Vector2f& out_position ) const override;
+	virtual void ClientApplySnapshot( NetObject*, const NetObjectSnapshot& ) const override;
 };
@@ -1,12 +1,23 @@
 #pragma once
 
 #include "Game/GameCommon.hpp"
+#include "Game/Game Entities/NetObjectSnapshotBuffer.hpp"
 
 
 //-----------------------------------------------------------------------------
 class NetMessage;
+class BitPacker;
 class NetObjectProtocol;
-typedef uint16_t NetObjectID;
+typedef uint32_t NetObjectID;
+
+
+//-----------------------------------------------------------------------------
+enum NetObjectEntityType
+{
+	NETOBJ_PLAYER_AVATAR,
+	NETOBJ_NPC_TEARDROP,
+	NUM_NETOBJ_TYPES
+};
 
 
 //-----------------------------------------------------------------------------
@@ -19,8 +30,17 @@ struct NetObject //Represents our local view of a game object synced over the ne
 	PlayerIndex owningPlayerIndex;
 	NetConnectionIndex owningConnectionIndex;
 
+	float updatePriorities[ MAX_NUM_PLAYERS ]; //Per-connection accumulators, grown by relevance * staleness each tick, reset on being sent.
+
+	NetObjectEntityType entityType; //Kept so the server can resend creation messages as the object re-enters a client's view.
 	NetObjectProtocol const* protocol;
 	void* syncedObject; //The actual non-net game object this NetObject keeps in sync across network.
+
+	bool isInViewOfConnection[ MAX_NUM_PLAYERS ]; //Server-side: whether that connection was last sent a create (true) or destroy (false) for us.
+	uint32_t lastInterestPassNumber; //Server-side: dedupes grid cells overlapping more than one viewer in NetObjectSystem::UpdateInterestForConnection.
+
+	double lastUpdateHostSeconds; //Client-side: when the host sent the update being read, what protocols key its snapshot on.
+	NetObjectSnapshotBuffer snapshots; //Client-side: filled by protocols as server updates arrive, rendered from at a delay.
 };
 
 
@@ -36,10 +56,20 @@ public:
 	virtual void WriteToDestroyMessage( NetMessage& msg ) const = 0;
 
 	//Sent by hosts for ALL objects: authoritative state update.
-	virtual void ServerWriteUpdateToMessage( NetObject*, NetMessage& msg ) const = 0;
-	virtual void ClientReadAndProcessUpdateFromServer( NetObject*, NetMessage& msg ) const = 0;
+	//Updates go through a BitPacker already positioned inside the message, so they can use quantized and sub-byte fields.
+	virtual void ServerWriteUpdateToMessage( NetObject*, BitPacker& msgBits ) const = 0;
+	virtual void ClientReadAndProcessUpdateFromServer( NetObject*, BitPacker& msgBits ) const = 0;
 
 	//Sent by clients for owned objects, those they want to influence. LEAVE AS STUB IF NOT A CLIENT-OWNED OBJECT!
-	virtual void ClientWriteUpdateToMessage( NetObject*, NetMessage& msg ) const = 0;
-	virtual void ServerReadAndProcessUpdateFromClient( NetObject*, NetMessage& msg ) const = 0;
+	virtual void ClientWriteUpdateToMessage( NetObject*, BitPacker& msgBits ) const = 0;
+	virtual void ServerReadAndProcessUpdateFromClient( NetObject*, BitPacker& msgBits ) const = 0;
+
+	//Not pure virtual: scales how fast an object's update priority for a given connection accumulates. Override to favor e.g. owned objects.
+	virtual float GetUpdateRelevance( NetObject*, NetConnectionIndex ) const { return 1.f; }
+
+	//Not pure virtual: where the object sits for area-of-interest filtering. Returning false makes it relevant to every connection.
+	virtual bool GetInterestPosition( NetObject*, Vector2f& /*out_position*/ ) const { return false; }
+
+	//Not pure virtual: called every frame on clients with the object's state sampled from its snapshots, for those that add any.
+	virtual void ClientApplySnapshot( NetObject*, const NetObjectSnapshot& ) const {}
 };
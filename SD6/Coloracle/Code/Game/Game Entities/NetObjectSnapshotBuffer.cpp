@@ -0,0 +1,62 @@
+#include "Game/Game Entities/NetObjectSnapshotBuffer.hpp"
+#include "Engine/Math/MathUtils.hpp"
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetObjectSnapshotBuffer::AddSnapshot( double hostSeconds, const Vector2f& position, const Vector2f& velocity )
+{
+	if ( m_numSnapshots > 0 )
+		m_newestIndex = ( m_newestIndex + 1 ) % NETOBJ_MAX_SNAPSHOTS;
+	if ( m_numSnapshots < NETOBJ_MAX_SNAPSHOTS )
+		++m_numSnapshots;
+
+	NetObjectSnapshot& snapshot = m_snapshots[ m_newestIndex ];
+	snapshot.hostSeconds = hostSeconds;
+	snapshot.position = position;
+	snapshot.velocity = velocity;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool NetObjectSnapshotBuffer::Sample( double renderSeconds, double maxExtrapolationSeconds, NetObjectSnapshot& out_snapshot ) const
+{
+	if ( m_numSnapshots == 0 )
+		return false;
+
+	const NetObjectSnapshot& newest = GetNthNewest( 0 );
+	if ( renderSeconds >= newest.hostSeconds ) //Late, so extrapolate, but only so far. A wrong guess snaps back further the longer it runs.
+	{
+		out_snapshot = newest;
+		if ( m_numSnapshots < 2 )
+			return true; //Nothing to tell its velocity from.
+
+		const NetObjectSnapshot& previous = GetNthNewest( 1 );
+		double secondsBetween = newest.hostSeconds - previous.hostSeconds;
+		if ( secondsBetween <= 0.0 )
+			return true;
+
+		double secondsPastNewest = GetMin( renderSeconds - newest.hostSeconds, maxExtrapolationSeconds );
+		out_snapshot.position += ( newest.position - previous.position ) * (float)( secondsPastNewest / secondsBetween );
+		return true;
+	}
+
+	//Walk back to the pair bracketing renderSeconds, which is usually within the newest few.
+	for ( int olderN = 1; olderN < m_numSnapshots; olderN++ )
+	{
+		const NetObjectSnapshot& older = GetNthNewest( olderN );
+		if ( older.hostSeconds > renderSeconds )
+			continue;
+
+		const NetObjectSnapshot& newer = GetNthNewest( olderN - 1 );
+		double secondsBetween = newer.hostSeconds - older.hostSeconds;
+		float t = ( secondsBetween > 0.0 ) ? (float)( ( renderSeconds - older.hostSeconds ) / secondsBetween ) : 1.f;
+
+		out_snapshot.hostSeconds = renderSeconds;
+		out_snapshot.position = Lerp( older.position, newer.position, t );
+		out_snapshot.velocity = older.velocity; //Not lerped, so e.g. PlayerAvatar's move/idle animation flips when the snapshot that did so is reached.
+		return true;
+	}
+
+	out_snapshot = GetNthNewest( m_numSnapshots - 1 ); //Older than everything we have, e.g. just after creation or a raised delay.
+	return true;
+}
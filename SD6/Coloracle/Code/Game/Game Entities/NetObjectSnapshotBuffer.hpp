@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Engine/Math/Vector2.hpp"
+
+
+//-----------------------------------------------------------------------------
+#define NETOBJ_MAX_SNAPSHOTS (16) //Per object, comfortably over a second's worth at MIN_SEND_RATE_HZ and the default delay's worth at the max.
+#define NETOBJ_DEFAULT_INTERPOLATION_DELAY_SECONDS ( .1 ) //Two ticks at the default 20Hz, so one lost update still has a later one to lerp toward.
+#define NETOBJ_DEFAULT_MAX_EXTRAPOLATION_SECONDS ( .25 ) //Past the newest snapshot we keep going along its velocity this long, then hold.
+
+
+//-----------------------------------------------------------------------------
+struct NetObjectSnapshot
+{
+	double hostSeconds; //The host's send time, cf. NetObjectSystem::ClientGetHostTimeSeconds.
+	Vector2f position;
+	Vector2f velocity; //Passed along for e.g. animation state, extrapolation goes by the change in position between snapshots instead.
+};
+
+
+//-----------------------------------------------------------------------------
+class NetObjectSnapshotBuffer //Client-side ring of the latest server updates for one NetObject, cf. NetObjectSystem::ClientUpdateInterpolation.
+{
+public:
+	NetObjectSnapshotBuffer() { Clear(); }
+
+	void Clear() { m_numSnapshots = 0; m_newestIndex = 0; }
+	bool IsEmpty() const { return ( m_numSnapshots == 0 ); }
+	void AddSnapshot( double hostSeconds, const Vector2f& position, const Vector2f& velocity ); //Overwrites the oldest when full.
+	bool Sample( double renderSeconds, double maxExtrapolationSeconds, NetObjectSnapshot& out_snapshot ) const; //False if empty.
+
+
+private:
+	const NetObjectSnapshot& GetNthNewest( int n ) const { return m_snapshots[ ( m_newestIndex + NETOBJ_MAX_SNAPSHOTS - n ) % NETOBJ_MAX_SNAPSHOTS ]; }
+
+	NetObjectSnapshot m_snapshots[ NETOBJ_MAX_SNAPSHOTS ];
+	int m_newestIndex;
+	int m_numSnapshots;
+};
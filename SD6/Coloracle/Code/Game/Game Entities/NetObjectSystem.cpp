@@ -4,20 +4,40 @@
 #include "Game/TheGame.hpp"
 #include "Engine/Networking/NetSender.hpp"
 #include "Engine/Networking/NetSession.hpp"
+#include "Engine/Networking/NetPacket.hpp"
+#include "Engine/Time/Time.hpp"
+#include "Engine/Memory/BitPacker.hpp"
 #include "Game/GameCommon.hpp"
+#include <algorithm>
 
 
 //--------------------------------------------------------------------------------------------------------------
-#define INITIAL_NEXT_OBJECT_ID (1)
+#define NETOBJ_ID_INDEX_MASK ( ( 1u << NETOBJ_ID_INDEX_BITS ) - 1 )
+#define NETOBJ_ID_GENERATION_MASK ( ( 1u << NETOBJ_ID_GENERATION_BITS ) - 1 )
+#define NETOBJ_UPDATE_BYTES_PER_TICK ( MAX_PACKET_SIZE / 2 ) //Leaves the rest of each packet for reliables, acks, and other traffic.
+#define NETOBJ_UPDATE_ENTRY_HEADER_BITS ( 1 + NETOBJ_ID_BITS + NETOBJ_UPDATE_NUMBER_BITS + NETOBJ_UPDATE_PAYLOAD_LENGTH_BITS ) //Continue bit, id, update number, payload length.
+#define NETOBJ_MIN_UPDATE_PAYLOAD_BITS ( 2 * NETOBJ_POSITION_BITS ) //Smallest any protocol writes, Protocol_TeardropNPC's position.
+#define NETOBJ_MAX_UPDATE_MISSES_PER_TICK (4) //Updates in a row that didn't fit before we stop writing any more aside to check.
 STATIC NetObjectSystem* NetObjectSystem::s_theNetObjectSystem = nullptr;
-STATIC NetObjectID NetObjectSystem::s_nextNetObjectID = INITIAL_NEXT_OBJECT_ID;
+STATIC double NetObjectSystem::s_interpolationDelaySeconds = NETOBJ_DEFAULT_INTERPOLATION_DELAY_SECONDS;
+STATIC double NetObjectSystem::s_maxExtrapolationSeconds = NETOBJ_DEFAULT_MAX_EXTRAPOLATION_SECONDS;
+STATIC bool NetObjectSystem::s_hadHostTimeEstimate = false;
+
+
+//--------------------------------------------------------------------------------------------------------------
+static uint16_t GetSlotIndex( NetObjectID netObjectID ) { return (uint16_t)( netObjectID & NETOBJ_ID_INDEX_MASK ); }
+static uint32_t GetGeneration( NetObjectID netObjectID ) { return ( netObjectID >> NETOBJ_ID_INDEX_BITS ) & NETOBJ_ID_GENERATION_MASK; }
+static NetObjectID MakeNetObjectID( uint16_t slotIndex, uint32_t generation ) { return ( generation << NETOBJ_ID_INDEX_BITS ) | slotIndex; }
 
 
 //--------------------------------------------------------------------------------------------------------------
 NetObjectSystem::NetObjectSystem()
+	: m_interestPassNumber( 0 )
+	, m_lastInterestGridRebuildSeconds( 0.0 )
+	, m_isInterestGridDirty( true )
+	, m_updateBatchMsg( NETMSG_GAME_NETOBJ_UPDATE_BATCH_SFS )
 {
 	m_netObjectPool.Init( MAX_NET_OBJECTS );
-	memset( m_netObjectRegistry, 0, MAX_NET_OBJECTS * sizeof( NetObject* ) );
 	memset( m_netObjectProtocolRegistry, 0, NUM_NETOBJ_TYPES * sizeof( NetObjectProtocol* ) );
 }
 
@@ -25,14 +45,9 @@ NetObjectSystem::NetObjectSystem()
 //--------------------------------------------------------------------------------------------------------------
 NetObjectSystem::~NetObjectSystem()
 {
-	for each ( NetObject*& netObj in m_netObjectRegistry )
-	{
-		if ( netObj != nullptr )
-		{
-			ClientNetStopSync( netObj->perObjectID );
-			netObj = nullptr;
-		}
-	}
+	std::vector< NetObject* > remainingNetObjects = m_netObjects; //Each stop swaps-and-pops m_netObjects.
+	for each ( NetObject* netObj in remainingNetObjects )
+		ClientNetStopSync( netObj->perObjectID );
 
 	for each ( NetObjectProtocol*& protocol in m_netObjectProtocolRegistry )
 	{
@@ -47,29 +62,57 @@ NetObjectSystem::~NetObjectSystem()
 
 
 //--------------------------------------------------------------------------------------------------------------
-void OnNetObjectUpdateReceivedFromServer( const NetSender&, NetMessage& updateMsg )
+void OnNetObjectUpdateBatchReceivedFromServer( const NetSender& from, NetMessage& batchMsg )
 {
-	NetObjectID id;
-	updateMsg.Read<NetObjectID>( &id );
+	BitPacker batchBits( batchMsg, BITPACKER_MODE_READ );
+
+	uint32_t hostSentMilliseconds;
+	if ( !batchBits.ReadBits( &hostSentMilliseconds, NETOBJ_BATCH_HOST_TIME_BITS ) )
+	{
+		LogAndShowPrintfWithTag( "NetObjectSystem", "Dropped a NetObject update batch too short for its send time." );
+		return;
+	}
 
-	uint16_t updateNumber;
-	updateMsg.Read<uint16_t>( &updateNumber );
+	//Keyed on when the host sent it rather than when it got here, so delivery jitter doesn't become jitter in motion. Until we're synced, arrival is all we have.
+	double hostNowSeconds = NetObjectSystem::ClientGetHostTimeSeconds();
+	double hostSentSeconds = from.ourSession->HasHostTimeEstimate() ? UnwrapWireMilliseconds( hostSentMilliseconds, hostNowSeconds ) : hostNowSeconds;
 
-	NetObject* netObject = NetObjectSystem::FindNetObjectByID( id );
-	if ( netObject != nullptr ) 
+	//Each entry is a continue bit, id, update number, payload length, then the protocol payload. A cleared continue bit ends the batch.
+	bool hasAnotherUpdate;
+	while ( batchBits.ReadBool( &hasAnotherUpdate ) && hasAnotherUpdate )
 	{
-		if ( UnsignedGreaterThanOrEqual( updateNumber, netObject->lastReceivedUpdateNumber ) ) //cf. ServerSendEveryNetObjectToConnection's paragraph.
+		uint32_t id;
+		uint32_t updateNumberBits;
+		uint32_t payloadNumBits;
+		bool successfulRead = batchBits.ReadBits( &id, NETOBJ_ID_BITS )
+			&& batchBits.ReadBits( &updateNumberBits, NETOBJ_UPDATE_NUMBER_BITS )
+			&& batchBits.ReadBits( &payloadNumBits, NETOBJ_UPDATE_PAYLOAD_LENGTH_BITS );
+		if ( !successfulRead || ( payloadNumBits > batchBits.GetRemainingBits() ) )
+		{
+			ERROR_RECOVERABLE( "Malformed NetObject update batch!" );
+			return;
+		}
+
+		uint16_t updateNumber = (uint16_t)updateNumberBits;
+		size_t payloadStart = batchBits.GetNumBitsUsed();
+
+		NetObject* netObject = NetObjectSystem::FindNetObjectByID( (NetObjectID)id ); //Not found if its create hasn't arrived yet, skipped below.
+		if ( ( netObject != nullptr ) && UnsignedGreaterThanOrEqual( updateNumber, netObject->lastReceivedUpdateNumber ) ) //cf. ServerSendEveryNetObjectToConnection's paragraph.
 		{
 			//Short version: the OrEqual case == non-authoritative host-prediction updates to keep from lagging behind an unresponsive client owner.
 
 			netObject->lastReceivedUpdateNumber = updateNumber; //May be more than just lastReceived+1, if we're behind.
-			netObject->protocol->ClientReadAndProcessUpdateFromServer( netObject, updateMsg );
+			netObject->lastUpdateHostSeconds = hostSentSeconds;
+			netObject->protocol->ClientReadAndProcessUpdateFromServer( netObject, batchBits );
+		}
+
+		//Land on the next entry whether the protocol read all, some, or none of its payload (e.g. hosts skip reading their own avatars).
+		size_t payloadNumBitsRead = batchBits.GetNumBitsUsed() - payloadStart;
+		if ( ( payloadNumBitsRead > payloadNumBits ) || !batchBits.SkipBits( payloadNumBits - payloadNumBitsRead ) )
+		{
+			ERROR_RECOVERABLE( "NetObject protocol read past its update payload!" );
+			return;
 		}
-	}
-	else
-	{
-//		ERROR_RECOVERABLE( "Failed to find NetObject for id!" );
-		return;
 	}
 }
 
@@ -83,22 +126,31 @@ void OnNetObjectUpdateReceivedFromClient( const NetSender& from, NetMessage& upd
 		return;
 	}
 
-	NetObjectID id;
-	updateMsg.Read<NetObjectID>( &id );
+	BitPacker updateBits( updateMsg, BITPACKER_MODE_READ );
+
+	uint32_t id;
+	updateBits.ReadBits( &id, NETOBJ_ID_BITS );
 
-	uint16_t updateNumber;
-	updateMsg.Read<uint16_t>( &updateNumber );
+	uint32_t updateNumberBits;
+	updateBits.ReadBits( &updateNumberBits, NETOBJ_UPDATE_NUMBER_BITS );
+	uint16_t updateNumber = (uint16_t)updateNumberBits;
 
-	NetObject* netObject = NetObjectSystem::FindNetObjectByID( id );
+	NetObject* netObject = NetObjectSystem::FindNetObjectByID( (NetObjectID)id );
 	if ( netObject != nullptr ) 
 	{
 		if ( netObject->owningConnectionIndex == from.ourSession->GetMyConnectionIndex() )
 			return; //Else a non-dedicated host will double-update its owned objects!
 
+		if ( ( from.sourceConnection == nullptr ) || ( from.sourceConnection->GetIndex() != netObject->owningConnectionIndex ) ) //Else anyone could drive, or bump the input sequence of, another player's avatar.
+		{
+			LogAndShowPrintfWithTag( "NetObjectSystem", "Dropped update for NetObject #%u from a connection that doesn't own it.", id );
+			return;
+		}
+
 		if ( UnsignedGreaterThan( updateNumber, netObject->lastReceivedUpdateNumber ) ) //cf. ServerSendEveryNetObjectToConnection's paragraph.
 		{
 			netObject->lastReceivedUpdateNumber = updateNumber; //May be more than just lastReceived+1, if we're behind.
-			netObject->protocol->ServerReadAndProcessUpdateFromClient( netObject, updateMsg );
+			netObject->protocol->ServerReadAndProcessUpdateFromClient( netObject, updateBits );
 		}
 	}
 	else
@@ -155,20 +207,24 @@ STATIC bool NetObjectSystem::NetStopSyncForLocalObject( void* gameObjectPtr )
 
 	//Have to clone the UnregisterNetObject code here to get netObj from gameObjectPtr.
 	NetObjectSystem* sys = Instance();
-	LocalObjectRegistry& registry = sys->s_localObjectToNetObject;
-	LocalObjectRegistry::iterator found = registry.find( gameObjectPtr );
-	if ( found == registry.end() )
+	NetObject* netObj;
+	if ( !sys->s_localObjectToNetObject.Find( gameObjectPtr, netObj ) )
 		return false;
 
-	NetObject* netObj = found->second;
-	NetObjectID netObjID = netObj->perObjectID;
-
-	if ( g_theGame->IsMyConnectionHosting() )
+	if ( g_theGame->IsMyConnectionHosting() ) //Only tell those who were sent its creation, i.e. had it in their area of interest.
 	{
-		NetMessage destroyMsg( NETMSG_GAME_NETOBJ_DESYNC_SFS ); //We want to destroy it down below so its dtor gets hit.
-		destroyMsg.Write<NetObjectID>( netObjID );
-		netObj->protocol->WriteToDestroyMessage( destroyMsg );
-		sessionRef->SendToAllConnections( destroyMsg );
+		NetMessage destroyMsg( NETMSG_GAME_NETOBJ_DESYNC_SFS );
+		sys->ServerWriteDestroyMessage( netObj, destroyMsg );
+		SharedNetMessagePayload* sharedPayload = NetMessage::CreateSharedPayload( destroyMsg ); //Written once however many connections see it.
+
+		for ( NetConnectionIndex connIndex = 0; connIndex < MAX_NUM_PLAYERS; connIndex++ )
+		{
+			NetConnection* conn = sessionRef->GetIndexedConnection( connIndex );
+			if ( ( conn != nullptr ) && netObj->isInViewOfConnection[ connIndex ] )
+				conn->SendMessageToThem( destroyMsg, sharedPayload ); //We want to destroy it down below so its dtor gets hit.
+		}
+
+		NetMessage::ReleaseSharedPayload( sharedPayload );
 	}
 
 	netObj->protocol->OnDestroy( netObj );
@@ -182,15 +238,25 @@ STATIC bool NetObjectSystem::NetStopSyncForLocalObject( void* gameObjectPtr )
 bool NetObjectSystem::UnregisterNetObject( NetObject* netObj )
 {
 	NetObjectSystem* sys = Instance();
-	LocalObjectRegistry& registry = sys->s_localObjectToNetObject;
-	LocalObjectRegistry::iterator found = registry.find( netObj->syncedObject );
-	if ( found == registry.end() )
+	if ( !sys->s_localObjectToNetObject.Erase( netObj->syncedObject ) )
 		return false;
 
-	registry.erase( found );
+	for each ( std::vector< NetObject* >& objectsInView in sys->m_objectsInViewOfConnection )
+		objectsInView.erase( std::remove( objectsInView.begin(), objectsInView.end(), netObj ), objectsInView.end() );
+	sys->m_isInterestGridDirty = true;
+
+	uint16_t slotIndex = GetSlotIndex( netObj->perObjectID );
+	NetObjectSlot& slot = sys->m_slots[ slotIndex ];
+	NetObject* lastNetObj = sys->m_netObjects.back(); //Fills the gap, may be netObj itself.
+	sys->m_netObjects[ slot.denseIndex ] = lastNetObj;
+	sys->m_slots[ GetSlotIndex( lastNetObj->perObjectID ) ].denseIndex = slot.denseIndex;
+	sys->m_netObjects.pop_back();
+
+	slot.netObj = nullptr;
+	slot.generation = ( slot.generation + 1 ) & NETOBJ_ID_GENERATION_MASK;
+	if ( slot.generation != 0 ) //Else it's wrapped, retire the slot until ResetBaseNetObjectID so a stale ID can never hit a reuse.
+		sys->m_freeSlotIndices.push_back( slotIndex );
 
-	NetObjectID netObjID = netObj->perObjectID;
-	sys->m_netObjectRegistry[ netObjID ] = nullptr;
 	sys->m_netObjectPool.Delete( netObj );
 
 	return true;
@@ -227,7 +293,8 @@ void OnNetObjectCreateReceivedFromServer( const NetSender&, NetMessage& msg )
 	
 	NetObjectProtocol* protocol = NetObjectSystem::FindNetObjectProtocolForEnumID( netObjectTypeID );
 	void* gameObject = protocol->OnCreate( msg ); //Results of WriteToCreationMessage accessed in here.
-	NetObjectSystem::NetSyncObject( gameObject, netObjectTypeID, ( hasPlayer ? &controllerData : nullptr ) ); //Else, we have nothing to use to update gameObject by in UpdateReceivedFromServer!
+	NetObjectSystem::NetSyncObject( gameObject, netObjectTypeID, ( hasPlayer ? &controllerData : nullptr ), netObjectID ); //Else, we have nothing to use to update gameObject by in UpdateReceivedFromServer!
+		//Must reuse the server's ID: objects now enter each client's view in a different order, so locally generated IDs would not line up.
 }
 
 
@@ -253,28 +320,50 @@ STATIC NetObject* NetObjectSystem::AllocateNetObject()
 //--------------------------------------------------------------------------------------------------------------
 NetObjectID NetObjectSystem::GetNextNetObjectID()
 {
-	//Need to make sure it's not in use, we don't mind it overflowing and wrapping around.
-	while ( FindNetObjectByID( s_nextNetObjectID ) != nullptr )
+	//Freed slots first, then a fresh one off the end, so no scan over live objects either way.
+	NetObjectSystem* sys = Instance();
+	while ( !sys->m_freeSlotIndices.empty() )
 	{
-		++s_nextNetObjectID; //Increment until we find an unused one.
-		if ( s_nextNetObjectID == MAX_NET_OBJECTS )
-			s_nextNetObjectID = 0;
+		uint16_t slotIndex = sys->m_freeSlotIndices.front();
+		sys->m_freeSlotIndices.pop_front();
+
+		const NetObjectSlot& slot = sys->m_slots[ slotIndex ];
+		if ( slot.netObj == nullptr ) //Else a server's ID took it back while we were a client. It's requeued when that one goes.
+			return MakeNetObjectID( slotIndex, slot.generation );
 	}
 
-	return s_nextNetObjectID++; //We know it's probably used once we return it, so ++ it now to save on a Find in the next invocation.
+	if ( sys->m_slots.size() >= MAX_NET_OBJECTS )
+		return INVALID_NET_OBJECT_ID;
+
+	NetObjectSlot newSlot = { nullptr, 0, 0 };
+	sys->m_slots.push_back( newSlot );
+	return MakeNetObjectID( (uint16_t)( sys->m_slots.size() - 1 ), newSlot.generation );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 bool NetObjectSystem::RegisterNetObject( NetObject* netObject )
 {
-	s_localObjectToNetObject.insert( LocalObjectRegistryPair( netObject->syncedObject, netObject ) );
+	s_localObjectToNetObject.Insert( netObject->syncedObject, netObject );
+
+	uint16_t slotIndex = GetSlotIndex( netObject->perObjectID );
+	if ( slotIndex >= m_slots.size() ) //Only for IDs from the server, ours come from slots that already exist.
+	{
+		NetObjectSlot emptySlot = { nullptr, 0, 0 };
+		m_slots.resize( slotIndex + 1, emptySlot );
+	}
 
-	NetObject*& currentOccupant = m_netObjectRegistry[ netObject->perObjectID ];
-	bool wasVacant = ( currentOccupant == nullptr );
+	NetObjectSlot& slot = m_slots[ slotIndex ];
+	bool wasVacant = ( slot.netObj == nullptr );
 		
 	if ( wasVacant ) //Not allowing overwriting for now.
-		currentOccupant = netObject;
+	{
+		slot.netObj = netObject;
+		slot.generation = GetGeneration( netObject->perObjectID ); //Server-chosen on clients.
+		slot.denseIndex = (uint32_t)m_netObjects.size();
+		m_netObjects.push_back( netObject );
+		m_isInterestGridDirty = true;
+	}
 	else
 		ERROR_AND_DIE( "Need to write in a way to remove NetObjects from the registry!" );
 
@@ -283,7 +372,7 @@ bool NetObjectSystem::RegisterNetObject( NetObject* netObject )
 
 
 //--------------------------------------------------------------------------------------------------------------
-STATIC NetObject* NetObjectSystem::NetSyncObject( void* objectPointer, NetObjectEntityType netObjectTypeID, PlayerController* owningPlayer )
+STATIC NetObject* NetObjectSystem::NetSyncObject( void* objectPointer, NetObjectEntityType netObjectTypeID, PlayerController* owningPlayer, NetObjectID idFromServer /*= INVALID_NET_OBJECT_ID*/ )
 {
 	//For now, called by the server only, but can be client-called in future in certain scenarios.
 	NetSession* sessionRef = g_theGame->GetGameNetSession();
@@ -301,63 +390,328 @@ STATIC NetObject* NetObjectSystem::NetSyncObject( void* objectPointer, NetObject
 		return nullptr;
 	}
 
+	NetObjectID netObjectID = ( idFromServer == INVALID_NET_OBJECT_ID ) ? GetNextNetObjectID() : idFromServer;
+	if ( netObjectID == INVALID_NET_OBJECT_ID )
+	{
+		ERROR_RECOVERABLE( "Out of NetObject IDs, raise NETOBJ_ID_INDEX_BITS!" );
+		return nullptr;
+	}
+
 	NetObject* newNetObj = AllocateNetObject();
+	newNetObj->entityType = netObjectTypeID;
 	newNetObj->protocol = protocol;
 	newNetObj->owningPlayerIndex = owningPlayer ? owningPlayer->GetPlayerIndex() : INVALID_PLAYER_INDEX;
 	newNetObj->owningConnectionIndex = owningPlayer ? owningPlayer->GetOwningConnectionIndex() : INVALID_CONNECTION_INDEX;
 	newNetObj->syncedObject = objectPointer;
-	newNetObj->perObjectID = GetNextNetObjectID();
+	newNetObj->perObjectID = netObjectID;
 	newNetObj->lastSentUpdateNumber = 0;
 	newNetObj->lastReceivedUpdateNumber = 0;
+	memset( newNetObj->updatePriorities, 0, MAX_NUM_PLAYERS * sizeof( float ) );
+	memset( newNetObj->isInViewOfConnection, 0, MAX_NUM_PLAYERS * sizeof( bool ) );
+	newNetObj->lastInterestPassNumber = 0;
+	newNetObj->lastUpdateHostSeconds = 0.0;
+	newNetObj->snapshots.Clear();
 
 	Instance()->RegisterNetObject( newNetObj );
 
-	if ( sessionRef->IsMyConnectionHosting() )
+	if ( sessionRef->IsMyConnectionHosting() && Instance()->IsAlwaysInView( newNetObj ) )
 	{
+		//Disseminate the new sync object netwide now. These trigger OnCreate in the protocol.
+		//Anything else is only created for a connection once it enters their area of interest, see UpdateInterestForConnection.
 		NetMessage creationMsg( NETMSG_GAME_NETOBJ_CREATE_SFS );
-		creationMsg.Write<NetObjectID>( newNetObj->perObjectID );
-		creationMsg.Write<NetObjectEntityType>( netObjectTypeID );
+		Instance()->ServerWriteCreationMessage( newNetObj, creationMsg );
+		SharedNetMessagePayload* sharedPayload = NetMessage::CreateSharedPayload( creationMsg ); //Written once for every connection.
 
-		bool hasPlayer = ( owningPlayer != nullptr );
-		creationMsg.Write<bool>( hasPlayer );
-		PlayerController controllerData; //Because we at least need to write default invalid values even if we didn't get an owningPlayer.
-		if ( owningPlayer != nullptr )
+		for ( NetConnectionIndex connIndex = 0; connIndex < MAX_NUM_PLAYERS; connIndex++ )
 		{
-			controllerData.SetPlayerData( *owningPlayer );
-			controllerData.WriteToMessage( creationMsg );
+			NetConnection* conn = sessionRef->GetIndexedConnection( connIndex );
+			if ( ( conn != nullptr ) && !conn->IsMe() )
+			{
+				conn->SendMessageToThem( creationMsg, sharedPayload );
+				newNetObj->isInViewOfConnection[ connIndex ] = true;
+			}
 		}
-		
-		protocol->WriteToCreationMessage( newNetObj, creationMsg ); //Overridden for the particular needs of this object type.
-		sessionRef->SendToAllConnections( creationMsg ); //Disseminate the new sync object netwide. These trigger OnCreate in the protocol.
+
+		NetMessage::ReleaseSharedPayload( sharedPayload );
 	}
 	return newNetObj;
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
-void NetObjectSystem::ServerSendEveryNetObjectToConnection( NetConnection* connToSendTo )
+void NetObjectSystem::ServerSendCreationToConnection( NetObject* netObj, NetConnection* connToSendTo )
 {
-//	NetConnectionIndex connIndex = connToSendTo->GetIndex(); //Ignore objects owned by clients for now, else player movement jigs everywhere.
-	for each ( NetObject* netObj in m_netObjectRegistry )
+	NetMessage creationMsg( NETMSG_GAME_NETOBJ_CREATE_SFS );
+	ServerWriteCreationMessage( netObj, creationMsg );
+	connToSendTo->SendMessageToThem( creationMsg );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetObjectSystem::ServerSendDestroyToConnection( NetObject* netObj, NetConnection* connToSendTo )
+{
+	NetMessage destroyMsg( NETMSG_GAME_NETOBJ_DESYNC_SFS );
+	ServerWriteDestroyMessage( netObj, destroyMsg );
+	connToSendTo->SendMessageToThem( destroyMsg );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetObjectSystem::ServerWriteCreationMessage( NetObject* netObj, NetMessage& creationMsg )
+{
+	creationMsg.Write<NetObjectID>( netObj->perObjectID );
+	creationMsg.Write<NetObjectEntityType>( netObj->entityType );
+
+	PlayerController* owningPlayer = g_theGame->GetIndexedPlayerController( netObj->owningPlayerIndex );
+	bool hasPlayer = ( owningPlayer != nullptr );
+	creationMsg.Write<bool>( hasPlayer );
+	PlayerController controllerData; //Because we at least need to write default invalid values even if we didn't get an owningPlayer.
+	if ( owningPlayer != nullptr )
 	{
-		if ( netObj == nullptr )
-			continue; 
+		controllerData.SetPlayerData( *owningPlayer );
+		controllerData.WriteToMessage( creationMsg );
+	}
+
+	netObj->protocol->WriteToCreationMessage( netObj, creationMsg ); //Overridden for the particular needs of this object type.
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetObjectSystem::ServerWriteDestroyMessage( NetObject* netObj, NetMessage& destroyMsg )
+{
+	destroyMsg.Write<NetObjectID>( netObj->perObjectID );
+	netObj->protocol->WriteToDestroyMessage( destroyMsg );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool NetObjectSystem::IsAlwaysInView( NetObject* netObj ) const
+{
+	//Player-owned objects are few, and game code (e.g. TheGame::m_playerAvatars) expects them to exist on every client.
+	if ( netObj->owningPlayerIndex != INVALID_PLAYER_INDEX )
+		return true;
+
+	Vector2f unusedPosition;
+	return !netObj->protocol->GetInterestPosition( netObj, unusedPosition );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+static int GetInterestCellCoord( float worldCoord, float gridMinCoord, int numCells )
+{
+	int cellCoord = static_cast<int>( floor( ( worldCoord - gridMinCoord ) / NETOBJ_INTEREST_CELL_SIZE ) );
+	return ClampInt( cellCoord, 0, numCells - 1 ); //Objects beyond the grid share its edge cells.
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetObjectSystem::RebuildInterestGrid()
+{
+	for each ( std::vector< NetObject* >& cell in m_interestGrid )
+		cell.clear();
+	m_alwaysInViewObjects.clear();
+
+	const Vector2f gridMins = NETOBJ_INTEREST_GRID_MINS;
+	for each ( NetObject* netObj in m_netObjects )
+	{
+		Vector2f position;
+		if ( IsAlwaysInView( netObj ) || !netObj->protocol->GetInterestPosition( netObj, position ) )
+		{
+			m_alwaysInViewObjects.push_back( netObj );
+			continue;
+		}
+
+		int cellX = GetInterestCellCoord( position.x, gridMins.x, NETOBJ_INTEREST_GRID_WIDTH );
+		int cellY = GetInterestCellCoord( position.y, gridMins.y, NETOBJ_INTEREST_GRID_HEIGHT );
+		m_interestGrid[ ( cellY * NETOBJ_INTEREST_GRID_WIDTH ) + cellX ].push_back( netObj );
+	}
+
+	m_lastInterestGridRebuildSeconds = GetCurrentTimeSeconds();
+	m_isInterestGridDirty = false;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetObjectSystem::UpdateInterestForConnection( NetConnection* conn )
+{
+	if ( m_isInterestGridDirty || ( GetCurrentTimeSeconds() - m_lastInterestGridRebuildSeconds ) >= NETOBJ_INTEREST_GRID_REBUILD_SECONDS )
+		RebuildInterestGrid(); //Objects move, so rebuild at most once per tick instead of tracking every move.
+
+	NetConnectionIndex connIndex = conn->GetIndex();
+	++m_interestPassNumber; //Stamps objects gathered this pass, so one near two of our viewers isn't added twice.
+	m_nextObjectsInView.clear();
+
+	for each ( NetObject* netObj in m_alwaysInViewObjects )
+	{
+		netObj->lastInterestPassNumber = m_interestPassNumber;
+		m_nextObjectsInView.push_back( netObj );
+	}
 
+	//Viewers are whatever this connection owns, e.g. its PlayerAvatars. Only visit the grid cells their radius overlaps.
+	const Vector2f gridMins = NETOBJ_INTEREST_GRID_MINS;
+	const float radiusSquared = NETOBJ_INTEREST_RADIUS * NETOBJ_INTEREST_RADIUS;
+	for each ( NetObject* viewer in m_alwaysInViewObjects )
+	{
+		Vector2f viewerPosition;
+		if ( ( viewer->owningConnectionIndex != connIndex ) || !viewer->protocol->GetInterestPosition( viewer, viewerPosition ) )
+			continue;
+
+		int minCellX = GetInterestCellCoord( viewerPosition.x - NETOBJ_INTEREST_RADIUS, gridMins.x, NETOBJ_INTEREST_GRID_WIDTH );
+		int maxCellX = GetInterestCellCoord( viewerPosition.x + NETOBJ_INTEREST_RADIUS, gridMins.x, NETOBJ_INTEREST_GRID_WIDTH );
+		int minCellY = GetInterestCellCoord( viewerPosition.y - NETOBJ_INTEREST_RADIUS, gridMins.y, NETOBJ_INTEREST_GRID_HEIGHT );
+		int maxCellY = GetInterestCellCoord( viewerPosition.y + NETOBJ_INTEREST_RADIUS, gridMins.y, NETOBJ_INTEREST_GRID_HEIGHT );
+		for ( int cellY = minCellY; cellY <= maxCellY; cellY++ )
+		{
+			for ( int cellX = minCellX; cellX <= maxCellX; cellX++ )
+			{
+				for each ( NetObject* netObj in m_interestGrid[ ( cellY * NETOBJ_INTEREST_GRID_WIDTH ) + cellX ] )
+				{
+					if ( netObj->lastInterestPassNumber == m_interestPassNumber )
+						continue;
+
+					Vector2f position;
+					netObj->protocol->GetInterestPosition( netObj, position );
+					if ( ( position - viewerPosition ).CalcFloatLengthSquared() > radiusSquared )
+						continue;
+
+					netObj->lastInterestPassNumber = m_interestPassNumber;
+					m_nextObjectsInView.push_back( netObj );
+				}
+			}
+		}
+	}
+
+	std::vector< NetObject* >& objectsInView = m_objectsInViewOfConnection[ connIndex ];
+	for each ( NetObject* netObj in objectsInView ) //Left the view since last pass.
+	{
+		if ( netObj->lastInterestPassNumber != m_interestPassNumber )
+		{
+			ServerSendDestroyToConnection( netObj, conn );
+			netObj->isInViewOfConnection[ connIndex ] = false;
+		}
+	}
+
+	for each ( NetObject* netObj in m_nextObjectsInView ) //Entered the view since last pass.
+	{
+		if ( !netObj->isInViewOfConnection[ connIndex ] )
+		{
+			ServerSendCreationToConnection( netObj, conn );
+			netObj->isInViewOfConnection[ connIndex ] = true;
+			netObj->updatePriorities[ connIndex ] = 0.f;
+		}
+	}
+
+	objectsInView.swap( m_nextObjectsInView );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+static bool HasHigherUpdatePriority( const PrioritizedNetObject& lhs, const PrioritizedNetObject& rhs )
+{
+	return lhs.first > rhs.first;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void NetObjectSystem::ServerSendEveryNetObjectToConnection( NetConnection* connToSendTo, float deltaSeconds )
+{
+	NetConnectionIndex connIndex = connToSendTo->GetIndex(); 
+	if ( connIndex >= MAX_NUM_PLAYERS )
+	{
+		ERROR_RECOVERABLE( "Connection index exceeds the NetObject priority accumulators!" );
+		return;
+	}
+
+	if ( connToSendTo->IsMe() )
+		return; //A host already has the authoritative state of everything.
+
+	UpdateInterestForConnection( connToSendTo );
+
+	//Accumulate priority = relevance * staleness, so objects that lose out this tick are more likely to win the next one.
+	m_prioritizedUpdates.clear();
+	for each ( NetObject* netObj in m_objectsInViewOfConnection[ connIndex ] ) //Only what's in their area of interest.
+	{
 //		if ( netObj->owningConnectionIndex == connIndex ) //PlayerAvatars now need to be updated by both client owner and server (authoritative sim stuff).
 //			continue;
 
-		NetMessage updateFromServerMsg( NETMSG_GAME_NETOBJ_UPDATE_SFS );
-		updateFromServerMsg.Write<NetObjectID>( netObj->perObjectID );
-		updateFromServerMsg.Write<uint16_t>( netObj->lastReceivedUpdateNumber ); 
-			//Unlike ClientSendEveryOwnedNetObjectToHost which can just ++, 
-			//we as server don't want to up the updateNumber here until we've received a new authoritative client-owner update.
-			//i.e. We get Update1, and send our prediction of that out to all connections as Update1.
-			//But until we get Update2 from the owner, we continue sending Update1 repeatedly, despite the different data (more host predictions).
-			//This is why OnNetObjectUpdateReceivedFromServer uses UnsignedGreaterThanOrEqual, while FromClient just uses UnsignedGreaterThan.
-			//Note that to this end we skip sending host updates to the client owner via netObj->owningConnectionIndex == connIndex check above.
-		netObj->protocol->ServerWriteUpdateToMessage( netObj, updateFromServerMsg );
-		connToSendTo->SendMessageToThem( updateFromServerMsg );
+		float& priority = netObj->updatePriorities[ connIndex ];
+		priority += netObj->protocol->GetUpdateRelevance( netObj, connIndex ) * deltaSeconds;
+		m_prioritizedUpdates.push_back( PrioritizedNetObject( priority, netObj ) );
+	}
+
+	std::sort( m_prioritizedUpdates.begin(), m_prioritizedUpdates.end(), HasHigherUpdatePriority );
+
+	if ( m_prioritizedUpdates.empty() )
+		return;
+
+	//Every update for this connection shares one message, so its length prefix and header are paid once per tick instead of per object.
+	m_updateBatchMsg.ResetOffset( 0 );
+	m_updateBatchMsg.SetTotalReadableBytes( 0 );
+	const size_t batchOverheadBytes = BitPacker::GetVarUintSize( NETOBJ_UPDATE_BYTES_PER_TICK ) + sizeof( uint8_t ); //Length prefix, message ID.
+	BitPacker batchBits( m_updateBatchMsg.GetIoHead(), NETOBJ_UPDATE_BYTES_PER_TICK - batchOverheadBytes, BITPACKER_MODE_WRITE );
+	batchBits.WriteBits( GetWireMilliseconds( GetCurrentTimeSeconds() ), NETOBJ_BATCH_HOST_TIME_BITS ); //What clients key this batch's snapshots on.
+
+	//Fill the tick's byte budget from the top down. Anything that doesn't fit keeps its priority and catches up on later ticks.
+	int numUpdatesBatched = 0;
+	int numMissesInARow = 0;
+	for each ( const PrioritizedNetObject& entry in m_prioritizedUpdates )
+	{
+		if ( batchBits.GetRemainingBits() < ( NETOBJ_UPDATE_ENTRY_HEADER_BITS + NETOBJ_MIN_UPDATE_PAYLOAD_BITS + 1 ) ) //+1 for the closing continue bit.
+			break; //Nothing could fit, so don't pay for writing the rest of the list aside to find that out.
+
+		NetObject* netObj = entry.second;
+		if ( !ServerWriteUpdateToBatch( netObj, batchBits ) )
+		{
+			if ( ++numMissesInARow >= NETOBJ_MAX_UPDATE_MISSES_PER_TICK )
+				break; //Likely nearly full, and each miss costs a whole payload write.
+			continue; //A smaller, lower-priority update may still fit.
+		}
+
+		netObj->updatePriorities[ connIndex ] = 0.f;
+		++numUpdatesBatched;
+		numMissesInARow = 0;
 	}
+
+	if ( numUpdatesBatched == 0 )
+		return;
+
+	batchBits.WriteBool( false ); //Always fits, ServerWriteUpdateToBatch leaves room for it.
+	batchBits.FinishOnto( m_updateBatchMsg );
+	connToSendTo->SendMessageToThem( m_updateBatchMsg );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool NetObjectSystem::ServerWriteUpdateToBatch( NetObject* netObj, BitPacker& batchBits )
+{
+	//Write the payload aside first, since its length goes ahead of it and it may not fit in what's left of the batch.
+	byte_t payloadBuffer[ NETOBJ_MAX_UPDATE_PAYLOAD_BYTES ];
+	BitPacker payloadBits( payloadBuffer, NETOBJ_MAX_UPDATE_PAYLOAD_BYTES, BITPACKER_MODE_WRITE );
+	netObj->protocol->ServerWriteUpdateToMessage( netObj, payloadBits );
+
+	size_t payloadNumBits = payloadBits.GetNumBitsUsed();
+	if ( payloadNumBits >= ( 1u << NETOBJ_UPDATE_PAYLOAD_LENGTH_BITS ) )
+	{
+		ERROR_RECOVERABLE( "NetObject update payload too long to batch, raise NETOBJ_UPDATE_PAYLOAD_LENGTH_BITS!" );
+		return false;
+	}
+
+	if ( ( NETOBJ_UPDATE_ENTRY_HEADER_BITS + payloadNumBits + 1 ) > batchBits.GetRemainingBits() ) //+1 for the batch's closing continue bit.
+		return false;
+
+	batchBits.WriteBool( true );
+	batchBits.WriteBits( netObj->perObjectID, NETOBJ_ID_BITS );
+	batchBits.WriteBits( netObj->lastReceivedUpdateNumber, NETOBJ_UPDATE_NUMBER_BITS ); 
+		//Unlike ClientSendEveryOwnedNetObjectToHost which can just ++, 
+		//we as server don't want to up the updateNumber here until we've received a new authoritative client-owner update.
+		//i.e. We get Update1, and send our prediction of that out to all connections as Update1.
+		//But until we get Update2 from the owner, we continue sending Update1 repeatedly, despite the different data (more host predictions).
+		//This is why OnNetObjectUpdateBatchReceivedFromServer uses UnsignedGreaterThanOrEqual, while FromClient just uses UnsignedGreaterThan.
+		//Note that to this end we skip sending host updates to the client owner via netObj->owningConnectionIndex == connIndex check above.
+	batchBits.WriteBits( (uint32_t)payloadNumBits, NETOBJ_UPDATE_PAYLOAD_LENGTH_BITS );
+	batchBits.WriteBitsFromBuffer( payloadBuffer, payloadNumBits );
+
+	return true;
 }
 
 
@@ -368,22 +722,25 @@ void NetObjectSystem::ClientSendEveryOwnedNetObjectToHost( NetConnection* connTo
 		return;
 
 	NetConnectionIndex myConnIndex = connToSendTo->GetSession()->GetMyConnectionIndex();
-	for each ( NetObject* netObj in m_netObjectRegistry )
+	for each ( NetObject* netObj in m_netObjects )
 	{
-		if ( ( netObj == nullptr ) || ( netObj->owningConnectionIndex != myConnIndex ) )
+		if ( netObj->owningConnectionIndex != myConnIndex )
 			continue; 
 
 		NetMessage updateFromClientMsg( NETMSG_GAME_NETOBJ_UPDATE_SFC );
-		updateFromClientMsg.Write<NetObjectID>( netObj->perObjectID );
-		updateFromClientMsg.Write<uint16_t>( ++netObj->lastSentUpdateNumber );
-		netObj->protocol->ClientWriteUpdateToMessage( netObj, updateFromClientMsg );
+		updateFromClientMsg.SetReplacementKey( netObj->perObjectID ); //Supersedes only this object's last update, cf. NETMSGOPT_REPLACEABLE.
+		BitPacker updateBits( updateFromClientMsg, BITPACKER_MODE_WRITE );
+		updateBits.WriteBits( netObj->perObjectID, NETOBJ_ID_BITS );
+		updateBits.WriteBits( ++netObj->lastSentUpdateNumber, NETOBJ_UPDATE_NUMBER_BITS );
+		netObj->protocol->ClientWriteUpdateToMessage( netObj, updateBits );
+		updateBits.FinishOnto( updateFromClientMsg );
 		connToSendTo->GetSession()->SendMessageToHost( updateFromClientMsg );
 	}
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
-STATIC void NetObjectSystem::OnNetworkTick( NetConnection* connToSendTo ) //Dispatches updates between host and clients.
+STATIC void NetObjectSystem::OnNetworkTick( NetConnection* connToSendTo, float deltaSeconds ) //Dispatches updates between host and clients.
 {
 	//IMPORTANT: Called for every connection we can see, to update them for what objects we own. 
 		//For server-client, host sees all, but client only sees self and host.
@@ -391,25 +748,96 @@ STATIC void NetObjectSystem::OnNetworkTick( NetConnection* connToSendTo ) //Disp
 	NetSession* sessionRef = g_theGame->GetGameNetSession();
 
 	if ( ( sessionRef != nullptr ) && sessionRef->IsMyConnectionHosting() )
-		Instance()->ServerSendEveryNetObjectToConnection( connToSendTo ); //If I'm the host, send updates for all objects to whoever tickedConnection is.
+		Instance()->ServerSendEveryNetObjectToConnection( connToSendTo, deltaSeconds ); //If I'm the host, send the most important updates to whoever tickedConnection is.
 
 	Instance()->ClientSendEveryOwnedNetObjectToHost( connToSendTo );
 	
-	//OPTIMIZATION:
-	//Every obj we make will send updates every single frame, which is unoptimal.
-	//When we get to that point, we can start adding more checks to only update those that are the oldest.
+	//Server updates are scheduled per connection by priority accumulators and capped by NETOBJ_UPDATE_BYTES_PER_TICK,
+	//then sent as one batch message, so packets stay under MTU however many objects exist. Client-owned updates are few enough to still go every tick.
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
-STATIC NetObject* NetObjectSystem::FindNetObjectByID( NetObjectID netObjectID )
+STATIC void NetObjectSystem::ClientUpdateInterpolation()
 {
-	if ( netObjectID >= MAX_NET_OBJECTS )
+	NetSession* sessionRef = g_theGame->GetGameNetSession();
+	if ( ( sessionRef == nullptr ) || sessionRef->IsMyConnectionHosting() )
+		return; //The host's objects are the real ones.
+
+	double renderSeconds = ClientGetRenderHostSeconds();
+	for each ( NetObject* netObj in Instance()->m_netObjects )
 	{
-		ERROR_RECOVERABLE( "Walked out of array bounds!" );
-		return nullptr;
+		NetObjectSnapshot snapshot;
+		if ( netObj->snapshots.Sample( renderSeconds, s_maxExtrapolationSeconds, snapshot ) )
+			netObj->protocol->ClientApplySnapshot( netObj, snapshot );
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+STATIC double NetObjectSystem::ClientGetHostTimeSeconds()
+{
+	NetSession* sessionRef = g_theGame->GetGameNetSession();
+	if ( sessionRef == nullptr )
+		return GetCurrentTimeSeconds();
+
+	bool hasHostTimeEstimate = sessionRef->HasHostTimeEstimate();
+	if ( hasHostTimeEstimate != s_hadHostTimeEstimate ) //Snapshots keyed on one clock can't be sampled on the other.
+	{
+		for each ( NetObject* netObj in Instance()->m_netObjects )
+			netObj->snapshots.Clear();
+		s_hadHostTimeEstimate = hasHostTimeEstimate;
 	}
-	return Instance()->m_netObjectRegistry[ netObjectID ];
+
+	return sessionRef->GetHostTimeSeconds();
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+STATIC double NetObjectSystem::ClientGetRenderHostSeconds()
+{
+	double hostNowSeconds = ClientGetHostTimeSeconds();
+
+	//Stamped with the host's send time, so even the newest snapshot is a one-way trip old by the time it's here. Arrival-stamped ones aren't.
+	double transitSeconds = 0.0;
+	NetSession* sessionRef = g_theGame->GetGameNetSession();
+	NetConnection* hostConn = ( sessionRef != nullptr ) ? sessionRef->GetHostConnection() : nullptr;
+	if ( s_hadHostTimeEstimate && ( hostConn != nullptr ) && !hostConn->IsMe() && hostConn->HasRTTEstimate() )
+		transitSeconds = hostConn->GetSmoothedRTTSeconds() * .5;
+
+	return hostNowSeconds - transitSeconds - s_interpolationDelaySeconds;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+STATIC void NetObjectSystem::OnConnectionLeave( NetConnectionIndex leavingConnIndex )
+{
+	if ( leavingConnIndex >= MAX_NUM_PLAYERS )
+		return;
+
+	NetObjectSystem* sys = Instance();
+	for each ( NetObject* netObj in sys->m_netObjects )
+	{
+		netObj->isInViewOfConnection[ leavingConnIndex ] = false;
+		netObj->updatePriorities[ leavingConnIndex ] = 0.f;
+	}
+	sys->m_objectsInViewOfConnection[ leavingConnIndex ].clear();
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+STATIC NetObject* NetObjectSystem::FindNetObjectByID( NetObjectID netObjectID )
+{
+	const std::vector< NetObjectSlot >& slots = Instance()->m_slots;
+	uint16_t slotIndex = GetSlotIndex( netObjectID );
+	if ( slotIndex >= slots.size() )
+		return nullptr; //e.g. An update racing ahead of its create.
+
+	NetObject* netObj = slots[ slotIndex ].netObj;
+	if ( ( netObj == nullptr ) || ( netObj->perObjectID != netObjectID ) )
+		return nullptr; //Stale generation, its object is gone and the slot may have moved on.
+
+	return netObj;
 }
 
 
@@ -430,10 +858,12 @@ STATIC void NetObjectSystem::RegisterProtocolForEntity( NetObjectEntityType id,
 //--------------------------------------------------------------------------------------------------------------
 void NetObjectSystem::ResetBaseNetObjectID()
 {
-	s_nextNetObjectID = INITIAL_NEXT_OBJECT_ID;
-	//I suspect this causes the IDs sent between server/clients to get out of sync when not reset between games.
-	//e.g. Host starts a game and leaves it, incrementing nextID to 5. Its next game starts player at 6,
-	//But if a client joins it then, it'll sync the object from the initial value instead.
-	//Alternatively, could just send the ID with the object create message... actually no, it checks to see if a prior object exists there.
-	//So if the host had that earlier player of its own at 6, but another client had hosted, left, and joined our host that could conflict.
+	//Clients take IDs from each create message, so this is only so a fresh session hands out low IDs again.
+	//Any objects still around keep their slots, and GetNextNetObjectID steps around them.
+	NetObjectSystem* sys = Instance();
+	if ( !sys->m_netObjects.empty() )
+		return;
+
+	sys->m_slots.clear();
+	sys->m_freeSlotIndices.clear();
 }
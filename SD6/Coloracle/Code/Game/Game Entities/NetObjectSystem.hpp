@@ -1,53 +1,71 @@
 #pragma once
 #include "Game/Game Entities/NetObjectProtocol.hpp"
 #include "Engine/Memory/ObjectPool.hpp"
+#include "Engine/Memory/FlatPointerMap.hpp"
 #include "Engine/Memory/UntrackedAllocator.hpp"
-#include <map>
+#include "Engine/Networking/NetMessage.hpp"
+#include <deque>
+#include <vector>
 
 
 //-----------------------------------------------------------------------------
 class NetConnection;
 struct NetSender;
-class NetMessage;
 class PlayerController;
-typedef std::pair< void*, NetObject* > LocalObjectRegistryPair;
-typedef std::map< void*, NetObject* > LocalObjectRegistry;
+typedef FlatPointerMap< NetObject* > LocalObjectRegistry;
+typedef std::pair< float, NetObject* > PrioritizedNetObject;
 
 
 //-----------------------------------------------------------------------------	
 extern void OnNetObjectCreateReceivedFromServer( const NetSender&, NetMessage& createMsg );
-extern void OnNetObjectUpdateReceivedFromServer( const NetSender&, NetMessage& updateMsg );
+extern void OnNetObjectUpdateBatchReceivedFromServer( const NetSender&, NetMessage& batchMsg );
 extern void OnNetObjectUpdateReceivedFromClient( const NetSender&, NetMessage& updateMsg );
 extern void OnNetObjectDesyncDestroyReceivedFromServer( const NetSender&, NetMessage& destroyMsg );
 extern void OnNetObjectDesyncReceivedFromServer( const NetSender&, NetMessage& destroyMsg );
 
 
 //-----------------------------------------------------------------------------
-#define MAX_NET_OBJECTS (1000) //Starting conservatively.
+#define NETOBJ_ID_INDEX_BITS (12) //Low bits of a NetObjectID, its slot in NetObjectSystem::m_slots.
+#define NETOBJ_ID_GENERATION_BITS (12) //Next bits, bumped as the slot is freed so a stale ID misses rather than hitting the slot's next occupant.
+#define NETOBJ_ID_BITS ( NETOBJ_ID_INDEX_BITS + NETOBJ_ID_GENERATION_BITS ) //What's on the wire, the rest of NetObjectID stays zero.
+#define MAX_NET_OBJECTS ( 1 << NETOBJ_ID_INDEX_BITS )
+#define INVALID_NET_OBJECT_ID (0xFFFFFFFF) //Beyond NETOBJ_ID_BITS, so no live ID can equal it.
+#define NETOBJ_UPDATE_NUMBER_BITS (16) //Full uint16_t, for the UnsignedGreaterThan wraparound checks.
+#define NETOBJ_UPDATE_PAYLOAD_LENGTH_BITS (10) //Each batched update's protocol payload is prefixed with its length in bits.
+#define NETOBJ_MAX_UPDATE_PAYLOAD_BYTES ( ( 1 << NETOBJ_UPDATE_PAYLOAD_LENGTH_BITS ) / NUM_BITS_IN_BYTE )
+#define NETOBJ_BATCH_HOST_TIME_BITS (32) //Each batch opens with the host's send time, cf. GetWireMilliseconds.
 
-
-//-----------------------------------------------------------------------------
-enum NetObjectEntityType
-{
-	NETOBJ_PLAYER_AVATAR,
-	NETOBJ_NPC_TEARDROP,
-	NUM_NETOBJ_TYPES
-};
+//Uniform grid bucketing NetObjects for per-connection area of interest, covering the playfield with some margin (clamped beyond it).
+#define NETOBJ_INTEREST_CELL_SIZE (5.f)
+#define NETOBJ_INTEREST_GRID_WIDTH (10)
+#define NETOBJ_INTEREST_GRID_HEIGHT (6)
+#define NETOBJ_INTEREST_GRID_MINS Vector2f( -.5f * NETOBJ_INTEREST_CELL_SIZE * NETOBJ_INTEREST_GRID_WIDTH, -.5f * NETOBJ_INTEREST_CELL_SIZE * NETOBJ_INTEREST_GRID_HEIGHT )
+#define NETOBJ_INTEREST_RADIUS (12.f) //World units around each object a connection owns.
+#define NETOBJ_INTEREST_GRID_REBUILD_SECONDS ( 1.f / 60.f ) //So each connection ticked in the same NetSession::Update shares one rebuild.
 
 
 //-----------------------------------------------------------------------------
 class NetObjectSystem
 {
 public:
-	static NetObject* NetSyncObject( void* objectPointer, NetObjectEntityType, PlayerController* owningPlayer );
+	static NetObject* NetSyncObject( void* objectPointer, NetObjectEntityType, PlayerController* owningPlayer, NetObjectID idFromServer = INVALID_NET_OBJECT_ID );
 	static void ClientNetStopSync( NetObjectID ); //DOES NOT CALL DELETE, because delete on void* won't call dtor.
 	static bool NetStopSyncForLocalObject( void* gameObjectPtr );
-	static void OnNetworkTick( NetConnection* connToSendOurObjectsTo ); //Dispatches updates between host and clients.
+	static void OnNetworkTick( NetConnection* connToSendOurObjectsTo, float deltaSeconds ); //Dispatches updates between host and clients.
+	static void OnConnectionLeave( NetConnectionIndex leavingConnIndex ); //Forgets what that connection could see, so a rejoin at its index starts fresh.
 	static NetObject* FindNetObjectByID( NetObjectID netObjectID );
 	static NetObjectProtocol* FindNetObjectProtocolForEnumID( NetObjectEntityType netObjectTypeID );
 	static void RegisterProtocolForEntity( NetObjectEntityType id, NetObjectProtocol* instance );
 	static void ResetBaseNetObjectID();
 
+	static void ClientUpdateInterpolation(); //Every frame, not just on ticks, so motion stays smooth however low the server's send rate goes.
+	static double ClientGetHostTimeSeconds(); //What snapshots are keyed on: the host's clock once synced, ours until then. Clears them all on the switch.
+	static double ClientGetRenderHostSeconds(); //Where on that clock clients render other objects, a one-way trip plus the interpolation delay behind it.
+	static void SetInterpolationDelaySeconds( double seconds ) { s_interpolationDelaySeconds = seconds; }
+	static double GetInterpolationDelaySeconds() { return s_interpolationDelaySeconds; }
+	static void SetMaxExtrapolationSeconds( double seconds ) { s_maxExtrapolationSeconds = seconds; }
+	static double GetMaxExtrapolationSeconds() { return s_maxExtrapolationSeconds; }
+
 
 private:
 	NetObjectSystem();
@@ -57,17 +75,47 @@ private:
 	static NetObjectSystem* /*CreateOrGet*/Instance(); //Trying an internal singleton to remove the Instance() call for other classes.
 	static NetObjectSystem* s_theNetObjectSystem; //Can't do without one, or I'd lose an ideal time at which to init the object pool.
 
+	struct NetObjectSlot
+	{
+		NetObject* netObj; //nullptr while free.
+		uint32_t generation; //Of its current or next occupant's ID.
+		uint32_t denseIndex; //Into m_netObjects while occupied.
+	};
+
 	bool RegisterNetObject( NetObject* );
 	bool UnregisterNetObject( NetObject* );
-	NetObject* m_netObjectRegistry[ MAX_NET_OBJECTS ];
+	std::vector< NetObjectSlot > m_slots; //Indexed by an ID's low bits, grown as IDs are handed out or arrive from the server.
+	std::deque< uint16_t > m_freeSlotIndices; //Oldest-freed first, so each slot's generation wraps as slowly as possible.
+	std::vector< NetObject* > m_netObjects; //Dense for iteration, swap-and-pop on removal, so order isn't stable.
 	NetObjectProtocol* m_netObjectProtocolRegistry[ NUM_NETOBJ_TYPES ];
 	
-	static NetObjectID GetNextNetObjectID();
-	static NetObjectID s_nextNetObjectID;
+	static NetObjectID GetNextNetObjectID(); //INVALID_NET_OBJECT_ID once all MAX_NET_OBJECTS slots are live or retired.
+
+	static double s_interpolationDelaySeconds; //How far behind the newest server update clients render, trading latency for smoothness.
+	static double s_maxExtrapolationSeconds;
+	static bool s_hadHostTimeEstimate; //As of the last ClientGetHostTimeSeconds, to tell when the snapshots' clock switched.
+	
+	void ServerSendEveryNetObjectToConnection( NetConnection*, float deltaSeconds ); //Highest priority first, until out of byte budget.
+	bool ServerWriteUpdateToBatch( NetObject*, BitPacker& batchBits ); //False if it didn't fit, in which case nothing was written.
+	void ServerSendCreationToConnection( NetObject*, NetConnection* );
+	void ServerSendDestroyToConnection( NetObject*, NetConnection* );
+	void ServerWriteCreationMessage( NetObject*, NetMessage& out_creationMsg );
+	void ServerWriteDestroyMessage( NetObject*, NetMessage& out_destroyMsg );
 	
-	void ServerSendEveryNetObjectToConnection( NetConnection* );
+	bool IsAlwaysInView( NetObject* ) const;
+	void RebuildInterestGrid();
+	void UpdateInterestForConnection( NetConnection* ); //Sends creates/destroys as objects enter/leave that connection's view.
+	std::vector< NetObject* > m_interestGrid[ NETOBJ_INTEREST_GRID_WIDTH * NETOBJ_INTEREST_GRID_HEIGHT ];
+	std::vector< NetObject* > m_alwaysInViewObjects; //e.g. Player-owned objects, objects without a position.
+	std::vector< NetObject* > m_objectsInViewOfConnection[ MAX_NUM_PLAYERS ];
+	std::vector< NetObject* > m_nextObjectsInView; //Scratch for UpdateInterestForConnection.
+	uint32_t m_interestPassNumber;
+	double m_lastInterestGridRebuildSeconds;
+	bool m_isInterestGridDirty; //Set on register/unregister so the grid never holds freed NetObjects.
 	void ClientSendEveryOwnedNetObjectToHost( NetConnection* );
 
 	ObjectPool<NetObject> m_netObjectPool;
 	LocalObjectRegistry s_localObjectToNetObject;
+	std::vector< PrioritizedNetObject > m_prioritizedUpdates; //Kept as a member to avoid reallocating it every tick for every connection.
+	NetMessage m_updateBatchMsg; //Likewise reused, one batch per connection per tick instead of a NetMessage per object.
 };
@@ -11,14 +11,27 @@
 //--------------------------------------------------------------------------------------------------------------
 PlayerAvatar::PlayerAvatar( PlayerController* controller )
 	: m_myController( controller )
+	, m_sprite( nullptr )
 	, m_swordLevel( 0 )
 	, m_animationState( false )
+	, m_activeForce( PLAYER_FORCE_NONE )
+	, m_inputStepAccumulatorSeconds( 0.f )
+	, m_lastAppliedInputSequence( 0 )
+	, m_inputBudgetSeconds( 0.0 )
+	, m_lastInputBudgetAccrualSeconds( -1.0 )
+	, m_ownerViewHostSeconds( -1.0 )
+	, m_idleSprite( nullptr )
+	, m_moveAnim( nullptr )
+	, m_jumpSprite( nullptr )
+	, m_fallSprite( nullptr )
 {
 	const char* colorStr = controller->GetColorString();
 	Rgba tint = Rgba::WHITE;
 	tint.alphaOpacity = 207;
 	WorldCoords2D pos = WorldCoords2D( GetRandomFloatInRange( -5.f, 5.f ), 0.f );
+	m_rigidbody.SetPosition( pos );
 
+#ifndef HEADLESS_SERVER //Servers simulate from m_rigidbody alone, so skip all the sprites and their animation states.
 	m_sprite = m_idleSprite = Sprite::Create( Stringf( "%sPlayer_Idle", colorStr ), pos, tint );
 	m_idleSprite->SetLayerID( MAIN_LAYER_ID, "Main" );
 	
@@ -54,6 +67,10 @@ PlayerAvatar::PlayerAvatar( PlayerController* controller )
 
 	//Referenced by several states above on exit, but only need to register once:
 	TheEventSystem::Instance()->RegisterEvent< PlayerAvatar, &PlayerAvatar::EndAnimationState_Handler >( "PlayerAvatar_EndAnimationState", this );
+#else
+	UNREFERENCED( colorStr );
+	UNREFERENCED( tint );
+#endif
 
 	memset( m_swordColorStack, UNUSED_SWORD_COLOR_STACK_LAYER, sizeof( m_swordColorStack[ 0 ] ) * MAX_NUM_TEAR_COUNT );
 }
@@ -62,6 +79,7 @@ PlayerAvatar::PlayerAvatar( PlayerController* controller )
 //--------------------------------------------------------------------------------------------------------------
 PlayerAvatar::~PlayerAvatar()
 {
+#ifndef HEADLESS_SERVER
 	m_sprite = nullptr;
 
 	//Could've exited in multiple states.
@@ -79,20 +97,23 @@ PlayerAvatar::~PlayerAvatar()
 	TheEventSystem::Instance()->UnregisterSubscriber< PlayerAvatar, &PlayerAvatar::StartJump_Handler >( "PlayerAvatar_StartJump", this );
 	TheEventSystem::Instance()->UnregisterSubscriber< PlayerAvatar, &PlayerAvatar::StartFall_Handler >( "PlayerAvatar_StartFall", this );
 	TheEventSystem::Instance()->UnregisterSubscriber< PlayerAvatar, &PlayerAvatar::EndAnimationState_Handler >( "PlayerAvatar_EndAnimationState", this );
+#endif
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 AABB2f PlayerAvatar::GetBounds() const
 {
-	return m_sprite->GetVirtualBoundsInWorld();
+	Vector2f halfSize = PLAYER_AVATAR_BOUNDS_SIZE * .5f; //Not the sprite's bounds, so listen and dedicated hosts collide alike.
+	Vector2f pos = GetPosition();
+	return AABB2f( pos - halfSize, pos + halfSize );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 Vector2f PlayerAvatar::GetPosition() const
 {
-	return m_sprite->GetPosition();
+	return m_rigidbody.GetPosition();
 }
 
 
@@ -126,14 +147,20 @@ std::string PlayerAvatar::GetSwordColorName() const
 //--------------------------------------------------------------------------------------------------------------
 Rgba PlayerAvatar::GetSpriteColor() const
 {
+#ifdef HEADLESS_SERVER
+	return Rgba::WHITE; //No sprite to have tinted.
+#else
 	return m_sprite->GetTint();
+#endif
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 void PlayerAvatar::SetPosition( const Vector2f& pos )
 {
+#ifndef HEADLESS_SERVER
 	m_sprite->m_transform.m_position = pos;
+#endif
 	m_rigidbody.SetPosition( pos );
 }
 
@@ -141,7 +168,11 @@ void PlayerAvatar::SetPosition( const Vector2f& pos )
 //--------------------------------------------------------------------------------------------------------------
 void PlayerAvatar::SetColor( const Rgba& newColor )
 {
+#ifdef HEADLESS_SERVER
+	UNREFERENCED( newColor );
+#else
 	m_sprite->SetTint( newColor );
+#endif
 }
 
 
@@ -187,15 +218,69 @@ void PlayerAvatar::LoseSwordColor()
 //--------------------------------------------------------------------------------------------------------------
 void PlayerAvatar::Update( float deltaSeconds )
 {
+#ifndef HEADLESS_SERVER
 	m_animationState.Update();
+#endif
+
+	uint8_t buttons = 0;
+	if ( g_theInput->IsKeyDown( KEY_TO_MOVE_UP_2D ) )
+		buttons |= PLAYER_INPUT_UP;
+	if ( g_theInput->IsKeyDown( KEY_TO_MOVE_DOWN_2D ) )
+		buttons |= PLAYER_INPUT_DOWN;
+	if ( g_theInput->IsKeyDown( KEY_TO_MOVE_RIGHT_2D ) )
+		buttons |= PLAYER_INPUT_RIGHT;
+	if ( g_theInput->IsKeyDown( KEY_TO_MOVE_LEFT_2D ) )
+		buttons |= PLAYER_INPUT_LEFT;
+
+	//Held buttons stand for every fixed step this frame covers. Hitches past the backlog play out slower rather than overflow the history.
+	m_inputStepAccumulatorSeconds = GetMin( m_inputStepAccumulatorSeconds + deltaSeconds, PLAYER_INPUT_MAX_BACKLOG_SECONDS );
+	while ( m_inputStepAccumulatorSeconds >= PLAYER_INPUT_STEP_SECONDS )
+	{
+		ApplyInput( m_inputHistory.Push( buttons ) ); //Predicted right away, the host's echo of it gets reconciled against later.
+		m_inputStepAccumulatorSeconds -= PLAYER_INPUT_STEP_SECONDS;
+	}
+
+	if ( g_theInput->IsKeyDown( KEY_TO_PLAY_EXPLOSION ) || g_theInput->IsButtonDown( BUTTON_TO_PLAY_EXPLOSION ) )
+	{
+		GameEventPlayerExploded ev;
+		ev.m_position = GetPosition();
+		TheEventSystem::Instance()->TriggerEvent( "GameEvent_OnPlayerExploded", &ev );
+		g_theGame->ShouldSendAttackMessage();
+	}
+}
+
 
+//--------------------------------------------------------------------------------------------------------------
+void PlayerAvatar::AccrueInputBudget( double nowSeconds )
+{
+	if ( m_lastInputBudgetAccrualSeconds < 0.0 )
+		m_inputBudgetSeconds = PLAYER_INPUT_MAX_BUDGET_SECONDS; //First contact, the owner's been stepping since before we could start the clock.
+	else
+		m_inputBudgetSeconds = GetMin( m_inputBudgetSeconds + ( nowSeconds - m_lastInputBudgetAccrualSeconds ), (double)PLAYER_INPUT_MAX_BUDGET_SECONDS );
+	m_lastInputBudgetAccrualSeconds = nowSeconds;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void PlayerAvatar::ApplyInputWithinBudget( const PlayerAvatarInput& input )
+{
+	//Still applied, buttons and sequence included, when there's no time left, so the owner's reconcile snaps it back rather than it resending forever.
+	float deltaSeconds = (float)GetMax( GetMin( m_inputBudgetSeconds, (double)PLAYER_INPUT_STEP_SECONDS ), 0.0 );
+	m_inputBudgetSeconds -= deltaSeconds;
+	ApplyInput( input, deltaSeconds );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void PlayerAvatar::ApplyInput( const PlayerAvatarInput& input, float deltaSeconds /*= PLAYER_INPUT_STEP_SECONDS*/ )
+{
 	const float PLAYER_MOVEMENT_SPEED = 450.f;
 	float deltaMove = ( PLAYER_MOVEMENT_SPEED * deltaSeconds );
 
-	bool upPressed = g_theInput->IsKeyDown( KEY_TO_MOVE_UP_2D );
-	bool downPressed = g_theInput->IsKeyDown( KEY_TO_MOVE_DOWN_2D );
-	bool rightPressed = g_theInput->IsKeyDown( KEY_TO_MOVE_RIGHT_2D );
-	bool leftPressed = g_theInput->IsKeyDown( KEY_TO_MOVE_LEFT_2D );
+	bool upPressed = ( input.buttons & PLAYER_INPUT_UP ) != 0;
+	bool downPressed = ( input.buttons & PLAYER_INPUT_DOWN ) != 0;
+	bool rightPressed = ( input.buttons & PLAYER_INPUT_RIGHT ) != 0;
+	bool leftPressed = ( input.buttons & PLAYER_INPUT_LEFT ) != 0;
 
 //	if ( downPressed )
 //		SetVelocity( -Vector2f::UNIT_Y * deltaMove );
@@ -211,38 +296,63 @@ void PlayerAvatar::Update( float deltaSeconds )
 	
 	if ( upPressed )
 	{
-		if ( !m_rigidbody.HasForces() )
-			m_rigidbody.AddForce( new ConstantWindForce( 20.f, Vector3f::UNIT_Y ) );
+		if ( m_activeForce == PLAYER_FORCE_NONE )
+			SetActiveForce( PLAYER_FORCE_WIND );
 		else
-			m_rigidbody.ClearForces();
+			ClearActiveForce();
 	}
 	if ( downPressed )
 	{
-		if ( !m_rigidbody.HasForces() )
-			m_rigidbody.AddForce( new GravityForce( 60.f, Vector3f::UNIT_Y * -1.f ) );
+		if ( m_activeForce == PLAYER_FORCE_NONE )
+			SetActiveForce( PLAYER_FORCE_GRAVITY );
 		else
-			m_rigidbody.ClearForces();
+			ClearActiveForce();
 	}
 	if ( !upPressed && !downPressed )
 	{
-		m_rigidbody.ClearForces();
+		ClearActiveForce();
 		SetVelocity( Vector2f( GetVelocity().x, 0.f ) ); //Kill any built-up velocity from forces.
 	}
 
-	if ( g_theInput->IsKeyDown( KEY_TO_PLAY_EXPLOSION ) || g_theInput->IsButtonDown( BUTTON_TO_PLAY_EXPLOSION ) )
-	{
-		GameEventPlayerExploded ev;
-		ev.m_position = GetPosition();
-		TheEventSystem::Instance()->TriggerEvent( "GameEvent_OnPlayerExploded", &ev );
-		g_theGame->ShouldSendAttackMessage();
-	}
-
 	//--------------------------------------------------------------------------------------------------------------
 
 	m_rigidbody.StepWithForwardEuler( .1f, deltaSeconds );
 	SetPosition( m_rigidbody.GetPosition() );
 	
 	EnforceWorldPerimeter();
+
+	m_lastAppliedInputSequence = input.sequence;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void PlayerAvatar::Reconcile( const Vector2f& hostPos, const Vector2f& hostVel, PlayerAvatarForce hostForce, uint16_t hostLastAppliedInputSequence )
+{
+	//Rewind to where the host had us after our last input it applied, then replay everything since on top.
+	//When the prediction was right this lands back where we already were, give or take quantization.
+	m_inputHistory.DropThrough( hostLastAppliedInputSequence );
+
+	SetActiveForce( hostForce );
+	SetPosition( hostPos );
+	SetVelocity( hostVel );
+
+	for ( int inputN = 0; inputN < m_inputHistory.GetNumInputs(); inputN++ )
+		ApplyInput( m_inputHistory.GetNthOldest( inputN ) );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void PlayerAvatar::SetActiveForce( PlayerAvatarForce newForce )
+{
+	m_rigidbody.ClearForces( false );
+	m_activeForce = newForce;
+
+	switch ( newForce )
+	{
+		case PLAYER_FORCE_WIND: m_rigidbody.AddForce( new ConstantWindForce( 20.f, Vector3f::UNIT_Y ) ); break;
+		case PLAYER_FORCE_GRAVITY: m_rigidbody.AddForce( new GravityForce( 60.f, Vector3f::UNIT_Y * -1.f ) ); break;
+		default: m_activeForce = PLAYER_FORCE_NONE; break;
+	}
 }
 
 
@@ -250,7 +360,7 @@ void PlayerAvatar::Update( float deltaSeconds )
 void PlayerAvatar::EnforceWorldPerimeter()
 {
 	//Enforcing perimeter:
-	Vector2f& pos = m_sprite->m_transform.m_position;
+	Vector2f pos = GetPosition();
 	if ( pos.x > 15.f )
 		pos.x = 15.f;
 	else if ( pos.x < -15.f )
@@ -260,13 +370,14 @@ void PlayerAvatar::EnforceWorldPerimeter()
 	else if ( pos.y < -9.f )
 		pos.y = -9.f;
 
-	SetPosition( pos ); //Keep physics state updated with sprite.
+	SetPosition( pos ); //Keep sprite updated with physics state.
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 void PlayerAvatar::UpdateAnimState()
 {
+#ifndef HEADLESS_SERVER //Purely cosmetic.
 	const Vector2f& vel = GetVelocity();
 
 	m_animationState.SetCurrentState( ( vel.x == 0 ) ? "Idle" : "Move" );
@@ -285,9 +396,11 @@ void PlayerAvatar::UpdateAnimState()
 	else if ( vel.x > 0 )
 		m_sprite->m_transform.m_scale.x = 1.f;
 	//else stay the same scale for idle.
+#endif
 }
 
 
+#ifndef HEADLESS_SERVER //Only registered when there are sprites to switch between.
 //--------------------------------------------------------------------------------------------------------------
 bool PlayerAvatar::StartIdle_Handler( EngineEvent* ev )
 {
@@ -377,3 +490,4 @@ bool PlayerAvatar::EndAnimationState_Handler( EngineEvent* ev )
 
 	return SHOULD_NOT_UNSUB;
 }
+#endif
@@ -6,6 +6,7 @@
 #include "Engine/Physics/LinearDynamicsState2D.hpp"
 #include "Engine/Tools/StateMachine/StateMachine.hpp"
 #include "Game/GameCommon.hpp"
+#include "Game/Game Entities/PlayerInputHistory.hpp"
 
 
 //-----------------------------------------------------------------------------
@@ -15,6 +16,16 @@ class Sprite;
 class EngineEvent;
 
 
+//-----------------------------------------------------------------------------
+enum PlayerAvatarForce : uint8_t //At most one at a time, see PlayerAvatar::ApplyInput.
+{
+	PLAYER_FORCE_NONE,
+	PLAYER_FORCE_WIND,
+	PLAYER_FORCE_GRAVITY, //Sticks once added, since LinearDynamicsState2D::ClearForces keeps gravity by default.
+	NUM_PLAYER_FORCES
+};
+
+
 //-----------------------------------------------------------------------------
 class PlayerAvatar
 {
@@ -33,18 +44,27 @@ public:
 	Rgba GetSpriteColor() const;
 	Sprite* GetSprite() { return m_sprite; }
 	LinearDynamicsState2D* GetRigidbody() { return &m_rigidbody; }
+	PlayerAvatarForce GetActiveForce() const { return m_activeForce; }
+	uint16_t GetLastAppliedInputSequence() const { return m_lastAppliedInputSequence; }
+	double GetOwnerViewHostSeconds() const { return m_ownerViewHostSeconds; }
+	const PlayerInputHistory& GetInputHistory() const { return m_inputHistory; }
 
 	void SetSwordLevel( int8_t newLevel ) { if ( newLevel >= 0 && newLevel <= MAX_NUM_TEAR_COUNT ) m_swordLevel = newLevel; }
 	void SetSwordColorAt( int8_t index, PrimaryTearColor newColor ) { if ( index < MAX_NUM_TEAR_COUNT ) m_swordColorStack[ index ] = newColor; }
 	void SetPosition( const Vector2f& pos );
 	void SetVelocity( const Vector2f& vel ) { m_rigidbody.SetVelocity( vel ); UpdateAnimState(); }
+	void SetOwnerViewHostSeconds( double hostSeconds ) { m_ownerViewHostSeconds = hostSeconds; }
 	void SetColor( const Rgba& newColor );
 	void SetColorFromPrimaryTearColor( PrimaryTearColor newColor );
 	void AddSwordColor( PrimaryTearColor newColor );
 	void LoseSwordColor();
 
-	void Update( float deltaSeconds );
+	void Update( float deltaSeconds ); //Owner only, samples and applies this tick's input.
 	void UpdateAnimState();
+	void ApplyInput( const PlayerAvatarInput& input, float deltaSeconds = PLAYER_INPUT_STEP_SECONDS ); //Movement only, so the host and a reconciling owner can rerun it.
+	void AccrueInputBudget( double nowSeconds ); //Host only, once per update received, by real time passed.
+	void ApplyInputWithinBudget( const PlayerAvatarInput& input ); //Host only, shortens a client's steps to the real time passed, cf. speed hacks.
+	void Reconcile( const Vector2f& hostPos, const Vector2f& hostVel, PlayerAvatarForce hostForce, uint16_t hostLastAppliedInputSequence );
 
 private:
 	bool StartIdle_Handler( EngineEvent* );
@@ -53,11 +73,21 @@ private:
 	bool StartFall_Handler( EngineEvent* );
 	bool EndAnimationState_Handler( EngineEvent* );
 	void EnforceWorldPerimeter();
+	void SetActiveForce( PlayerAvatarForce newForce );
+	void ClearActiveForce() { if ( m_activeForce != PLAYER_FORCE_GRAVITY ) SetActiveForce( PLAYER_FORCE_NONE ); } //Mirrors ClearForces( keepGravity = true ).
 
 	PlayerController* m_myController;
 	Sprite* m_sprite; //Switches between below anims.
 	StateMachine m_animationState;
 	LinearDynamicsState2D m_rigidbody;
+	PlayerAvatarForce m_activeForce; //Tracked alongside m_rigidbody's forces so it can be sent and restored.
+
+	PlayerInputHistory m_inputHistory; //Only read on a non-host owner.
+	float m_inputStepAccumulatorSeconds; //Owner only, frame time not yet stepped as a PLAYER_INPUT_STEP_SECONDS input.
+	uint16_t m_lastAppliedInputSequence; //What the host echoes back to the owner in Protocol_PlayerAvatar::ServerWriteUpdateToMessage.
+	double m_inputBudgetSeconds; //Host only, real time the owner's inputs may still step.
+	double m_lastInputBudgetAccrualSeconds; //Negative until the first update.
+	double m_ownerViewHostSeconds; //Host only, where on our clock the owner last said it was rendering, negative until its clock syncs.
 
 	int8_t m_swordLevel; //Use to access below array's end, since #colors == sword level.
 	int8_t m_swordColorStack[ MAX_NUM_TEAR_COUNT ]; //0 is the hilt/first, last is the tip, using array for easier networking.
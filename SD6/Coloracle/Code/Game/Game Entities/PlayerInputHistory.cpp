@@ -0,0 +1,28 @@
+#include "Game/Game Entities/PlayerInputHistory.hpp"
+#include "Engine/Networking/NetConnectionUtils.hpp"
+
+
+//--------------------------------------------------------------------------------------------------------------
+const PlayerAvatarInput& PlayerInputHistory::Push( uint8_t buttons )
+{
+	if ( m_numInputs < PLAYER_INPUT_HISTORY_LENGTH )
+		++m_numInputs;
+	else
+		m_oldestIndex = ( m_oldestIndex + 1 ) % PLAYER_INPUT_HISTORY_LENGTH;
+
+	PlayerAvatarInput& input = m_inputs[ ( m_oldestIndex + m_numInputs - 1 ) % PLAYER_INPUT_HISTORY_LENGTH ];
+	input.sequence = ++m_lastSequence;
+	input.buttons = buttons;
+	return input;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void PlayerInputHistory::DropThrough( uint16_t lastAppliedSequence )
+{
+	while ( ( m_numInputs > 0 ) && !UnsignedGreaterThan( GetNthOldest( 0 ).sequence, lastAppliedSequence ) )
+	{
+		m_oldestIndex = ( m_oldestIndex + 1 ) % PLAYER_INPUT_HISTORY_LENGTH;
+		--m_numInputs;
+	}
+}
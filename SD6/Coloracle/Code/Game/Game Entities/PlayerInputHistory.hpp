@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+#include "Engine/Networking/NetConnection.hpp"
+
+
+//-----------------------------------------------------------------------------
+#define PLAYER_INPUT_STEP_SECONDS (1.f/60.f) //Owners sample and step input at this fixed rate rather than per frame, so the backlog only grows with time.
+#define PLAYER_INPUT_MAX_BACKLOG_SECONDS (4.f/MIN_SEND_RATE_HZ) //Worst legitimate unacknowledged input: a send interval at the floor rate plus a slow round trip, with slack.
+#define PLAYER_INPUT_MAX_PER_UPDATE ( (int)( PLAYER_INPUT_MAX_BACKLOG_SECONDS / PLAYER_INPUT_STEP_SECONDS + .5f ) ) //Newest unacknowledged inputs resent in each update to the host, cf. Protocol_PlayerAvatar::ClientWriteUpdateToMessage.
+#define PLAYER_INPUT_HISTORY_LENGTH (PLAYER_INPUT_MAX_PER_UPDATE) //Per owned avatar, anything older couldn't be resent anyway.
+#define PLAYER_INPUT_MAX_BUDGET_SECONDS (PLAYER_INPUT_MAX_BACKLOG_SECONDS) //Host banks at most this much real time per avatar, so a late packet's inputs still fit but a fast client can't save up much.
+
+
+//-----------------------------------------------------------------------------
+enum PlayerInputButton : uint8_t
+{
+	PLAYER_INPUT_UP = 1 << 0,
+	PLAYER_INPUT_DOWN = 1 << 1,
+	PLAYER_INPUT_LEFT = 1 << 2,
+	PLAYER_INPUT_RIGHT = 1 << 3
+};
+
+
+//-----------------------------------------------------------------------------
+struct PlayerAvatarInput //Everything PlayerAvatar::ApplyInput reads, so host and owner step the same way from the same state.
+{
+	uint16_t sequence;
+	uint8_t buttons; //PlayerInputButton flags, each held for PLAYER_INPUT_STEP_SECONDS.
+};
+
+
+//-----------------------------------------------------------------------------
+class PlayerInputHistory //Owner's inputs the host hasn't acknowledged yet, replayed over each authoritative update, cf. PlayerAvatar::Reconcile.
+{
+public:
+	PlayerInputHistory() { Clear(); }
+
+	void Clear() { m_numInputs = 0; m_oldestIndex = 0; m_lastSequence = 0; }
+	const PlayerAvatarInput& Push( uint8_t buttons ); //Overwrites the oldest when full, which the host then never gets.
+	void DropThrough( uint16_t lastAppliedSequence ); //Host has applied this and everything before it.
+	int GetNumInputs() const { return m_numInputs; }
+	const PlayerAvatarInput& GetNthOldest( int n ) const { return m_inputs[ ( m_oldestIndex + n ) % PLAYER_INPUT_HISTORY_LENGTH ]; }
+
+
+private:
+	PlayerAvatarInput m_inputs[ PLAYER_INPUT_HISTORY_LENGTH ];
+	int m_oldestIndex;
+	int m_numInputs;
+	uint16_t m_lastSequence; //Starts at 0 so the first input is 1, above the host's initial PlayerAvatar::GetLastAppliedInputSequence.
+};
@@ -7,6 +7,8 @@
 //--------------------------------------------------------------------------------------------------------------
 TeardropNPC::TeardropNPC( PrimaryTearColor color )
 	: m_color( color )
+	, m_sprite( nullptr )
+	, m_pulseScale( 1.f )
 {
 	Rgba spriteTint;
 	switch ( color )
@@ -18,21 +20,28 @@ TeardropNPC::TeardropNPC( PrimaryTearColor color )
 
 	float directionX = GetRandomChance( .5 ) ? -1.f : 1.f;
 	float directionY = GetRandomChance( .5 ) ? -1.f : 1.f;
-	m_sprite = AnimatedSprite::Create(
-		"Slime",
-		WorldCoords2D( GetRandomFloatInRange( 3.1f, 13.1f ) * directionX, GetRandomFloatInRange( 3.1f, 7.2f ) * directionY ),
-		spriteTint );
+	WorldCoords2D pos = WorldCoords2D( GetRandomFloatInRange( 3.1f, 13.1f ) * directionX, GetRandomFloatInRange( 3.1f, 7.2f ) * directionY );
+
+#ifdef HEADLESS_SERVER
+	UNREFERENCED( spriteTint );
+#else
+	m_sprite = AnimatedSprite::Create( "Slime", pos, spriteTint );
 	m_sprite->SetLayerID( MAIN_LAYER_ID, "Main" );
 	m_sprite->Enable();
+#endif
+
+	SetPosition( pos );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 TeardropNPC::~TeardropNPC()
 {
+#ifndef HEADLESS_SERVER
 	m_sprite->Disable();
 	delete m_sprite;
 	m_sprite = nullptr;
+#endif
 }
 
 
@@ -50,28 +59,45 @@ void TeardropNPC::Update( float deltaSeconds )
 
 	lerpFactor += deltaSeconds * ( negateDirection ? -1.f : 1.f );
 
-	Vector2f& scale = m_sprite->m_transform.m_scale;
-	scale = Lerp( Vector2f( 0.9f ), Vector2f( 1.1f ), lerpFactor );
+	m_pulseScale = Lerp( 0.9f, 1.1f, lerpFactor ); //Kept off the sprite too, since GetBounds pulses with it.
+#ifndef HEADLESS_SERVER
+	m_sprite->m_transform.m_scale = Vector2f( m_pulseScale );
+#endif
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 AABB2f TeardropNPC::GetBounds() const
 {
-	return m_sprite->GetVirtualBoundsInWorld();
+	Vector2f halfSize = TEARDROP_NPC_BOUNDS_SIZE * ( .5f * m_pulseScale ); //Not the sprite's bounds, so listen and dedicated hosts collide alike.
+	Vector2f pos = GetPosition();
+	return AABB2f( pos - halfSize, pos + halfSize );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+AABB2f TeardropNPC::GetBoundsAt( double hostSeconds ) const
+{
+	AABB2f bounds;
+	if ( !m_boundsHistory.GetBoundsAt( hostSeconds, bounds ) )
+		return GetBounds(); //Nothing recorded yet, e.g. not hosting.
+
+	return bounds;
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 Vector2f TeardropNPC::GetPosition() const
 {
-	return m_sprite->m_transform.m_position;
+	return m_rigidbody.GetPosition();
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 void TeardropNPC::SetPosition( const Vector2f& pos )
 {
+#ifndef HEADLESS_SERVER
 	m_sprite->m_transform.m_position = pos;
+#endif
 	m_rigidbody.SetPosition( pos );
 }
\ No newline at end of file
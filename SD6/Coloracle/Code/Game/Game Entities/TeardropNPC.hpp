@@ -2,6 +2,7 @@
 
 #include "Game/GameCommon.hpp"
 #include "Engine/Physics/LinearDynamicsState2D.hpp"
+#include "Game/Game Entities/LagCompensationHistory.hpp"
 
 //-----------------------------------------------------------------------------
 class AnimatedSprite;
@@ -15,6 +16,8 @@ public:
 	~TeardropNPC();
 	void Update( float deltaSeconds ); //Just be still for now.
 	AABB2f GetBounds() const;
+	AABB2f GetBoundsAt( double hostSeconds ) const; //Where it was then, cf. TheGame::GetLagCompensatedSeconds.
+	void RecordBoundsHistory( double hostSeconds ) { m_boundsHistory.Record( hostSeconds, GetBounds() ); }
 	PrimaryTearColor GetColor() const { return m_color; }
 	Vector2f GetPosition() const;
 	void SetPosition( const Vector2f& newPos );
@@ -22,5 +25,7 @@ public:
 private:
 	PrimaryTearColor m_color;
 	AnimatedSprite* m_sprite;
+	float m_pulseScale; //Of both the sprite and GetBounds.
 	LinearDynamicsState2D m_rigidbody;
+	LagCompensationHistory m_boundsHistory; //Host-only.
 };
@@ -5,6 +5,7 @@
 #include "Engine/Core/TheConsole.hpp"
 
 
+#ifndef HEADLESS_SERVER
 //--------------------------------------------------------------------------------------------------------------
 bool TheGame::RenderLobby( EngineEvent* )
 {
@@ -64,6 +65,7 @@ bool TheGame::RenderLobby( EngineEvent* )
 
 	return SHOULD_NOT_UNSUB;
 }
+#endif
 
 
 //--------------------------------------------------------------------------------------------------------------
@@ -140,6 +142,13 @@ bool TheGame::UpdateLobby( EngineEvent* )
 			m_hostSelectedGoalTearCount = GetMin( (int8_t)(m_hostSelectedGoalTearCount + 9), MAX_NUM_TEAR_COUNT );
 	}
 
+	if ( m_isDedicatedServer && ( m_numPlayersToAutoStartMatch > 0 ) && IsMyConnectionHosting() && m_gameSession->IsListening() )
+	{
+		int numClientsConnected = m_gameSession->GetNumConnected() - 1; //Less our own connection.
+		if ( numClientsConnected >= m_numPlayersToAutoStartMatch )
+			ServerStartMatch(); //Stops listening, so this only fires once per lobby.
+	}
+
 	//if ( g_theInput->WasKeyPressedOnce( 'R' ) )
 	//if ( g_theInput->WasKeyPressedOnce( 'G' ) )
 	//if ( g_theInput->WasKeyPressedOnce( 'B' ) )
@@ -156,15 +165,24 @@ bool TheGame::StartupLobby( EngineEvent* )
 
 	StartGameNetSession(); //Start a clean one.
 
+#ifndef HEADLESS_SERVER
 	m_background = Sprite::Create( "LobbyBG", WorldCoords2D::ZERO );
 	m_background->SetLayerID( BACKGROUND_LAYER_ID, "BG" );
 	SpriteRenderer::SetLayerVirtualSize( BACKGROUND_LAYER_ID, 4, 4 );
 	SpriteRenderer::SetLayerIsScrolling( BACKGROUND_LAYER_ID, false );
 	//	SpriteRenderer::AddLayerEffect( UI_LAYER_ID, FramebufferEffect::GetFboEffect( "FboEffect_PostProcessObama" ) );
 	m_background->Enable();
+#endif
 
 	m_hostSelectedGoalTearCount = 7;
 
+	if ( m_isDedicatedServer && ( m_gameSession != nullptr ) )
+	{
+		m_hostSelectedGoalTearCount = m_dedicatedServerGoalTearCount;
+		HostGame( Stringf( "Server%u", s_numHostGameInvocation++ ) );
+		StartHostListen();
+	}
+
 	return SHOULD_NOT_UNSUB;
 }
 
@@ -172,9 +190,11 @@ bool TheGame::StartupLobby( EngineEvent* )
 //--------------------------------------------------------------------------------------------------------------
 bool TheGame::ShutdownLobby( EngineEvent* ) //May be exiting to Title or to a match.
 {
+#ifndef HEADLESS_SERVER
 	m_background->Disable();
 	delete m_background;
 	m_background = nullptr;
+#endif
 
 	return SHOULD_NOT_UNSUB;
 }
@@ -4,17 +4,20 @@
 #include "Engine/Renderer/TheRenderer.hpp"
 #include "Game/Game Entities/PlayerAvatar.hpp"
 #include "Game/Game Entities/NetObjectSystem.hpp"
+#include "Engine/Networking/NetSession.hpp"
 
 
 //--------------------------------------------------------------------------------------------------------------
 bool TheGame::StartupMidMatch( EngineEvent* )
 {
+#ifndef HEADLESS_SERVER
 	m_background = Sprite::Create( "UnderworldBG", WorldCoords2D::ZERO );
 	m_background->SetLayerID( BACKGROUND_LAYER_ID, "BG" );
 	SpriteRenderer::SetLayerVirtualSize( BACKGROUND_LAYER_ID, 4, 4 );
 	SpriteRenderer::SetLayerIsScrolling( BACKGROUND_LAYER_ID, true );
 //	SpriteRenderer::AddLayerEffect( UI_LAYER_ID, FramebufferEffect::GetFboEffect( "FboEffect_PostProcessObama" ) );
 	m_background->Enable();
+#endif
 
 	m_spawnTimer.Start();
 
@@ -37,9 +40,11 @@ bool TheGame::ShutdownMidMatch( EngineEvent* )
 
 	m_teardropEnemies.clear();
 
+#ifndef HEADLESS_SERVER
 	m_background->Disable();
 	delete m_background;
 	m_background = nullptr;
+#endif
 
 	//Make sure that ClientEndMatch sets winningPlayerIndex BEFORE SetCurrentState call to leave this state.
 	if ( m_winningPlayerIndex == INVALID_PLAYER_INDEX ) //Means we quit without going to post-match state, 
@@ -50,18 +55,32 @@ bool TheGame::ShutdownMidMatch( EngineEvent* )
 
 
 //--------------------------------------------------------------------------------------------------------------
-bool TheGame::UpdateMidMatch( EngineEvent* )
+bool TheGame::UpdateMidMatch( EngineEvent* ev )
 {
-//	float deltaSeconds = dynamic_cast<EngineEventUpdate*>( ev )->deltaSeconds;
+	float deltaSeconds = dynamic_cast<EngineEventUpdate*>( ev )->deltaSeconds;
+
+	//Once per frame, not per connection tick, else the world would run faster the more connections (or the higher their send rates) we had.
+	if ( ( m_gameSession == nullptr ) || ( m_gameSession->GetMyConnection() == nullptr ) )
+		return SHOULD_NOT_UNSUB;
+
+	if ( m_gameSession->IsMyConnectionHosting() )
+		ServerUpdateAuthoritativeSimulation( deltaSeconds );
+	if ( ConnectionHasPlayers() ) //Not an else clause, can be both.
+	{
+		ClientUpdateUnauthoritativeSimulation( deltaSeconds );
+		m_didClientRender = ClientUpdateOwnedPlayers( deltaSeconds ); //Only small client-owned or predictive-logic game events processed here.
+	}
 
 	return SHOULD_NOT_UNSUB;
 }
 
 
+#ifndef HEADLESS_SERVER
 //--------------------------------------------------------------------------------------------------------------
 bool TheGame::RenderMidMatch( EngineEvent* )
 {
 	SpriteRenderer::RenderFrame();
 
 	return SHOULD_NOT_UNSUB;
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
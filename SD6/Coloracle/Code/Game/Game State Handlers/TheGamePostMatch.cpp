@@ -11,11 +11,15 @@
 //--------------------------------------------------------------------------------------------------------------
 bool TheGame::StartupPostMatch( EngineEvent* )
 {
+#ifndef HEADLESS_SERVER
 	m_background = Sprite::Create( "PostMatchBG", WorldCoords2D::ZERO );
 	m_background->SetLayerID( BACKGROUND_LAYER_ID, "BG" );
 	SpriteRenderer::SetLayerVirtualSize( BACKGROUND_LAYER_ID, 4, 4 );
 	SpriteRenderer::SetLayerIsScrolling( BACKGROUND_LAYER_ID, false );
 	m_background->Enable();
+#endif
+
+	m_secondsInPostMatch = 0.f;
 
 	return SHOULD_NOT_UNSUB;
 }
@@ -24,9 +28,11 @@ bool TheGame::StartupPostMatch( EngineEvent* )
 //--------------------------------------------------------------------------------------------------------------
 bool TheGame::ShutdownPostMatch( EngineEvent* )
 {
+#ifndef HEADLESS_SERVER
 	m_background->Disable();
 	delete m_background;
 	m_background = nullptr;
+#endif
 
 	g_theGame->LeaveGame();
 
@@ -38,6 +44,17 @@ bool TheGame::ShutdownPostMatch( EngineEvent* )
 bool TheGame::UpdatePostMatch( EngineEvent* ev )
 {
 	float deltaSeconds = dynamic_cast<EngineEventUpdate*>( ev )->deltaSeconds;
+
+	if ( m_isDedicatedServer ) //No one's here to press the exit key, so cycle back on our own.
+	{
+		m_secondsInPostMatch += deltaSeconds;
+		if ( m_secondsInPostMatch >= DEDICATED_SERVER_POSTMATCH_SECONDS )
+		{
+			m_gameStateMachine.SetCurrentState( "TheGameState_Lobby" );
+			return SHOULD_NOT_UNSUB;
+		}
+	}
+
 	PlayerAvatar* winner = m_playerAvatars[ m_winningPlayerIndex ];
 	if ( m_winningPlayerIndex < MAX_NUM_PLAYERS && ( winner != nullptr ) && ( winner->GetController()->GetOwningConnectionIndex() == m_gameSession->GetMyConnectionIndex() ) )
 		winner->Update( deltaSeconds ); //Don't update unless it's owned by us.
@@ -46,6 +63,7 @@ bool TheGame::UpdatePostMatch( EngineEvent* ev )
 }
 
 
+#ifndef HEADLESS_SERVER
 //--------------------------------------------------------------------------------------------------------------
 bool TheGame::RenderPostMatch( EngineEvent* )
 {
@@ -81,3 +99,4 @@ bool TheGame::RenderPostMatch( EngineEvent* )
 	}
 	return SHOULD_NOT_UNSUB;
 }
+#endif
@@ -6,8 +6,10 @@
 #include "Game/Game Entities/PlayerController.hpp"
 
 
+#ifndef HEADLESS_SERVER
 //--------------------------------------------------------------------------------------------------------------
 static Sprite* s_title = nullptr;
+#endif
 
 
 //--------------------------------------------------------------------------------------------------------------
@@ -26,6 +28,7 @@ bool TheGame::StartupTitle( EngineEvent* )
 		controller = nullptr;
 	}
 
+#ifndef HEADLESS_SERVER
 	s_title = Sprite::Create( "Title_UI", WorldCoords2D( 0.f, 5.f ) );
 	s_title->SetLayerID( UI_LAYER_ID, "UI" );
 	SpriteRenderer::SetLayerVirtualSize( UI_LAYER_ID, 5, 5 );
@@ -39,6 +42,7 @@ bool TheGame::StartupTitle( EngineEvent* )
 	SpriteRenderer::SetLayerIsScrolling( BACKGROUND_LAYER_ID, false );
 	//	SpriteRenderer::AddLayerEffect( UI_LAYER_ID, FramebufferEffect::GetFboEffect( "FboEffect_PostProcessObama" ) );
 	m_background->Enable();
+#endif
 
 	return SHOULD_NOT_UNSUB;
 }
@@ -47,6 +51,7 @@ bool TheGame::StartupTitle( EngineEvent* )
 //--------------------------------------------------------------------------------------------------------------
 bool TheGame::ShutdownTitle( EngineEvent* )
 {
+#ifndef HEADLESS_SERVER
 	s_title->Disable();
 	delete s_title;
 	s_title = nullptr;
@@ -54,11 +59,13 @@ bool TheGame::ShutdownTitle( EngineEvent* )
 	m_background->Disable();
 	delete m_background;
 	m_background = nullptr;
+#endif
 
 	return SHOULD_NOT_UNSUB;
 }
 
 
+#ifndef HEADLESS_SERVER
 //--------------------------------------------------------------------------------------------------------------
 bool TheGame::RenderTitle( EngineEvent* )
 {
@@ -78,6 +85,7 @@ bool TheGame::RenderTitle( EngineEvent* )
 
 	return SHOULD_NOT_UNSUB;
 }
+#endif
 
 
 //--------------------------------------------------------------------------------------------------------------
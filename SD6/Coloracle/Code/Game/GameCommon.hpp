@@ -20,7 +20,10 @@
 const int8_t MAX_NUM_TEAR_COUNT = 16;
 const int MAX_ALIVE_ENEMIES = 16;
 const float MAX_SECONDS_BETWEEN_SPAWNS = 3.f;
+const float DEDICATED_SERVER_POSTMATCH_SECONDS = 10.f; //Before a dedicated server reopens its lobby.
 const int UNUSED_SWORD_COLOR_STACK_LAYER = -1;
+const Vector2f PLAYER_AVATAR_BOUNDS_SIZE( 2.875f, 3.125f ); //World units, the 46x50px hero art at 16px each. Not read off the textures, so hosts need none loaded.
+const Vector2f TEARDROP_NPC_BOUNDS_SIZE( 3.3125f, 2.5f ); //The 53x40px slime art, before TeardropNPC::Update's pulsing scale.
 enum PrimaryTearColor : int8_t
 {
 	PRIMARY_TEAR_COLOR_RED,
@@ -41,6 +44,21 @@ typedef uint8_t PlayerIndex;
 #define INVALID_PLAYER_INDEX (0xFF)
 #define MAX_NUM_PLAYERS (3)
 static const int MAX_ADDR_STRLEN = 256;
+
+//Quantization of NetObject payloads, see BitPacker. Positions are clamped, so keep these covering the playfield.
+const Vector2f NETOBJ_POSITION_MINS( -16.f, -10.f ); //Perimeter is +/-15 by +/-9, see PlayerAvatar::EnforceWorldPerimeter.
+const Vector2f NETOBJ_POSITION_MAXS( 16.f, 10.f );
+const uint8_t NETOBJ_POSITION_BITS = 14; //~.002 world units per step.
+const Vector2f NETOBJ_VELOCITY_MINS( -64.f, -64.f );
+const Vector2f NETOBJ_VELOCITY_MAXS( 64.f, 64.f );
+const uint8_t NETOBJ_VELOCITY_BITS = 12; //~.03 world units/sec per step.
+const uint8_t PRIMARY_TEAR_COLOR_BITS = 2; //Holds 0 through NUM_PRIMARY_TEAR_COLORS - 1.
+const uint8_t SWORD_LEVEL_BITS = 5; //Holds 0 through MAX_NUM_TEAR_COUNT.
+const uint8_t PLAYER_INPUT_SEQUENCE_BITS = 16; //Compared with UnsignedGreaterThan, so it wraps like the other uint16_t sequences.
+const uint8_t PLAYER_INPUT_COUNT_BITS = 6; //Holds 0 through PLAYER_INPUT_MAX_PER_UPDATE, 60 at the current step and backlog.
+const uint8_t PLAYER_INPUT_BUTTON_BITS = 4; //One per PlayerInputButton.
+const uint8_t PLAYER_VIEW_HOST_TIME_BITS = 32; //See GetWireMilliseconds.
+const uint8_t PLAYER_FORCE_BITS = 2; //Holds 0 through NUM_PLAYER_FORCES - 1.
 enum GamePackets : uint8_t 
 {
 	NETMSG_GAME_BOOM = NetCoreMessageType::MAX_CORE_NETMSG_TYPES, //Start off at the end of the core messages.
@@ -59,9 +77,15 @@ enum GamePackets : uint8_t
 
 	NETMSG_GAME_NETOBJ_CREATE_SFS,
 	NETMSG_GAME_NETOBJ_UPDATE_SFC,
-	NETMSG_GAME_NETOBJ_UPDATE_SFS,
+	NETMSG_GAME_NETOBJ_UPDATE_BATCH_SFS, //Every NetObject update a connection gets in a tick, cf. NetObjectSystem::ServerSendEveryNetObjectToConnection.
 	NETMSG_GAME_NETOBJ_DESYNC_SFS
 };
+enum GameInOrderChannel : uint8_t //Below MAX_INORDER_CHANNELS. Players and NetObjects share one since creating either may rely on a player's JOINED.
+{
+	GAME_INORDER_CHANNEL_GAMEPLAY,
+	GAME_INORDER_CHANNEL_DEBUG, //e.g. Ping_InOrder, so testing it under loss never stalls gameplay.
+	NUM_GAME_INORDER_CHANNELS
+};
 
 
 //-----------------------------------------------------------------------------
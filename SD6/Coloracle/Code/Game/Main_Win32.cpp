@@ -10,8 +10,132 @@
 #include "Game/TheApp.hpp"
 #include "Engine/TheEngine.hpp"
 
+#ifdef HEADLESS_SERVER
+#include "Game/TheGame.hpp"
+#include "Engine/Core/TheConsole.hpp"
+#include "Engine/Concurrency/Thread.hpp"
+#include "Engine/Concurrency/ThreadSafeQueue.hpp"
+#include "Engine/Networking/NetSession.hpp"
+#include "Engine/Time/Time.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#endif
 
 
+
+#ifdef HEADLESS_SERVER
+//--------------------------------------------------------------------------------------------------------------
+static const float DEFAULT_SERVER_TICKS_PER_SECOND = 60.f;
+static const int DEFAULT_SERVER_GOAL_TEAR_COUNT = 7;
+static ThreadSafeQueue< std::string > s_pendingStdinCommands; //Filled off the main thread, run on it so commands never race the frame.
+
+
+//--------------------------------------------------------------------------------------------------------------
+static void ReadStdinCommandsThreadEntry( void* )
+{
+	char lineBuffer[ 1024 ];
+	while ( fgets( lineBuffer, sizeof( lineBuffer ), stdin ) != nullptr )
+	{
+		lineBuffer[ strcspn( lineBuffer, "\r\n" ) ] = '\0';
+		if ( lineBuffer[ 0 ] != '\0' )
+			s_pendingStdinCommands.Enqueue( lineBuffer );
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+static void PrintServerUsage()
+{
+	printf( "Usage: Coloracle_Server [-port <#>] [-tickrate <Hz>] [-goal <1-%d tears>] [-autostart <#players>] [-capture <filePrefix>]\n", MAX_NUM_TEAR_COUNT );
+	printf( "Any console command can then be typed on stdin, e.g. NetGameStart or Quit.\n" );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+int main( int argc, char* argv[] ) //Built by the DedicatedServer configuration: no window, GL context, audio or input.
+{
+	uint16_t port = GAME_PORT;
+	float ticksPerSecond = DEFAULT_SERVER_TICKS_PER_SECOND;
+	int goalTearCount = DEFAULT_SERVER_GOAL_TEAR_COUNT;
+	int numPlayersToAutoStart = 0; //0 waits on NetGameStart instead.
+	const char* capturePrefix = nullptr; //Each lobby's session captures to <prefix>_<#>.netcap, cf. NetSessionReplayCapture.
+
+	for ( int argIndex = 1; argIndex < argc; argIndex++ )
+	{
+		bool hasValue = ( argIndex + 1 < argc );
+		if ( hasValue && ( _stricmp( argv[ argIndex ], "-port" ) == 0 ) )
+			port = (uint16_t)atoi( argv[ ++argIndex ] );
+		else if ( hasValue && ( _stricmp( argv[ argIndex ], "-tickrate" ) == 0 ) )
+			ticksPerSecond = (float)atof( argv[ ++argIndex ] );
+		else if ( hasValue && ( _stricmp( argv[ argIndex ], "-goal" ) == 0 ) )
+			goalTearCount = atoi( argv[ ++argIndex ] );
+		else if ( hasValue && ( _stricmp( argv[ argIndex ], "-autostart" ) == 0 ) )
+			numPlayersToAutoStart = atoi( argv[ ++argIndex ] );
+		else if ( hasValue && ( _stricmp( argv[ argIndex ], "-capture" ) == 0 ) )
+			capturePrefix = argv[ ++argIndex ];
+		else
+		{
+			PrintServerUsage();
+			return 1;
+		}
+	}
+
+	if ( ( ticksPerSecond <= 0.f ) || ( goalTearCount < 1 ) || ( goalTearCount > MAX_NUM_TEAR_COUNT ) || ( numPlayersToAutoStart < 0 ) )
+	{
+		PrintServerUsage();
+		return 1;
+	}
+
+	const int NUM_WORKER_THREADS = -4; //The negative implies "save 4, give me all the rest."
+
+	Logger::Startup();
+	MemoryAnalytics::Startup();
+	Profiler::Instance()->Startup();
+	JobSystem::Instance()->Startup( NUM_WORKER_THREADS );
+
+	g_theApp = new TheApp();
+
+	g_theApp->Startup( GetModuleHandle( NULL ) );
+	if ( capturePrefix != nullptr )
+		g_theGame->SetNetCapturePrefix( capturePrefix );
+	g_theGame->StartDedicatedServer( port, (int8_t)goalTearCount, numPlayersToAutoStart );
+
+	Thread stdinReader( ReadStdinCommandsThreadEntry );
+	stdinReader.ThreadDetach(); //Blocks in fgets, so it can't be joined, and dies with the process.
+
+	const double SECONDS_PER_TICK = 1.0 / ticksPerSecond;
+	const bool SHOULD_RENDER = false;
+
+	while ( !g_theApp->IsQuitting() )
+	{
+		double tickStartSeconds = GetCurrentTimeSeconds();
+
+		std::string pendingCommand;
+		while ( s_pendingStdinCommands.Dequeue( &pendingCommand ) )
+			g_theConsole->RunCommand( pendingCommand );
+
+		Profiler::Instance()->StartFrame();
+		g_theEngine->RunFrame( SHOULD_RENDER );
+
+		double secondsLeftInTick = SECONDS_PER_TICK - ( GetCurrentTimeSeconds() - tickStartSeconds );
+		if ( secondsLeftInTick > 0.0 )
+			Sleep( (DWORD)( secondsLeftInTick * 1000.0 ) ); //Gives the cores back, the point of running headless.
+	}
+
+	g_theApp->Shutdown();
+
+	delete g_theApp;
+	g_theApp = nullptr;
+
+	JobSystem::Instance()->Shutdown();
+	Profiler::Instance()->Shutdown();
+	MemoryAnalytics::Shutdown();
+	Logger::Shutdown();
+
+	return 0;
+}
+#else
 //--------------------------------------------------------------------------------------------------------------
 int WINAPI WinMain( HINSTANCE applicationInstanceHandle, HINSTANCE, LPSTR commandLineString, int )
 {
@@ -49,4 +173,5 @@ int WINAPI WinMain( HINSTANCE applicationInstanceHandle, HINSTANCE, LPSTR comman
 	Logger::Shutdown();
 
 	return 0;
-}
\ No newline at end of file
+}
+#endif
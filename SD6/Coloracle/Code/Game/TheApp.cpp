@@ -2,7 +2,9 @@
 
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
+#ifndef HEADLESS_SERVER
 #include <gl/gl.h>
+#endif
 
 #include "Engine/TheEngine.hpp"
 #include "Engine/Math/Vector2.hpp"
@@ -114,6 +116,7 @@ LRESULT CALLBACK WindowsMessageHandlingProcedure( HWND windowHandle, UINT wmMess
 }
 
 
+#ifndef HEADLESS_SERVER //Servers get no window or GL context at all, entity bounds come from GameCommon instead of textures.
 //--------------------------------------------------------------------------------------------------------------
 void TheApp::CreateOpenGLWindow( HINSTANCE applicationInstanceHandle )
 {
@@ -180,6 +183,7 @@ void TheApp::CreateOpenGLWindow( HINSTANCE applicationInstanceHandle )
 	m_glRenderContext = wglCreateContext( m_displayDeviceContext );
 	wglMakeCurrent( m_displayDeviceContext, m_glRenderContext );
 }
+#endif
 
 
 //--------------------------------------------------------------------------------------------------------------
@@ -212,7 +216,9 @@ void TheApp::HandleInput()
 //--------------------------------------------------------------------------------------------------------------
 void TheApp::FlipAndPresent()
 {
+#ifndef HEADLESS_SERVER
 	SwapBuffers( m_displayDeviceContext );
+#endif
 }
 
 
@@ -220,6 +226,9 @@ void TheApp::FlipAndPresent()
 TheApp::TheApp()
 	: m_screenWidth( VIEW_RIGHT )
 	, m_screenHeight( VIEW_TOP )
+	, m_windowHandle( nullptr )
+	, m_displayDeviceContext( nullptr )
+	, m_glRenderContext( nullptr )
 {
 }
 
@@ -227,8 +236,12 @@ TheApp::TheApp()
 //--------------------------------------------------------------------------------------------------------------
 void TheApp::Startup( HINSTANCE applicationInstanceHandle )
 {
+#ifdef HEADLESS_SERVER
+	UNREFERENCED( applicationInstanceHandle );
+#else
 	SetProcessDPIAware();
 	CreateOpenGLWindow( applicationInstanceHandle );
+#endif
 
 	g_theEngine = new TheEngine();
 	g_theEngine->Startup( m_screenWidth, m_screenHeight ); //Subsystem Allocations Occur Here
@@ -9,6 +9,7 @@
 #include "Engine/Core/TheEventSystem.hpp"
 #include "Engine/Math/Camera3D.hpp"
 #include "Engine/Math/Camera2D.hpp"
+#include "Engine/Time/Time.hpp"
 
 #include "Engine/Renderer/Sprite.hpp"
 #include "Engine/Renderer/SpriteResource.hpp"
@@ -48,6 +49,12 @@ TheGame::TheGame()
 	, m_shouldSendAttackMessage( false )
 	, m_lastSentCreationNuonce( 0 )
 	, m_hostSelectedGoalTearCount( -1 )
+	, m_sessionPort( GAME_PORT )
+	, m_isDedicatedServer( false )
+	, m_dedicatedServerGoalTearCount( -1 )
+	, m_numPlayersToAutoStartMatch( 0 )
+	, m_secondsInPostMatch( 0.f )
+	, m_numNetCapturesStarted( 0 )
 	, m_winningPlayerIndex( INVALID_PLAYER_INDEX )
 	, m_spawnTimer( MAX_SECONDS_BETWEEN_SPAWNS, "GameEvent_OnSpawnTimerEnded" )
 {
@@ -67,6 +74,10 @@ TheGame::~TheGame()
 //--------------------------------------------------------------------------------------------------------------
 void TheGame::Update( float deltaSeconds )
 {
+	m_didClientRender = false; //Re-zeroing, UpdateMidMatch may set it, cf. ClientUpdateOwnedPlayers.
+	if ( m_gameSession != nullptr )
+		NetObjectSystem::ClientUpdateInterpolation(); //Before UpdateMidMatch, which may render.
+
 	//Have to disseminate events more manually, StateCommands really only do fixed-value event arguments unlike deltaSeconds.
 	EngineEventUpdate updateEv( deltaSeconds );
 	StateNameStr currentStateName = m_gameStateMachine.GetCurrentState()->GetName();
@@ -84,24 +95,21 @@ void TheGame::Update( float deltaSeconds )
 	UpdateCamera( deltaSeconds );
 	UpdateAudioListener();
 
+#ifndef HEADLESS_SERVER //Servers have no sprites, see TheGame::Startup.
 	SpriteRenderer::Update( deltaSeconds ); //Culling should be handled by TheRenderer itself, see code review. What about animation updates?
+#endif
+
+	if ( m_gameSession != nullptr )
+		m_gameSession->SessionUpdate( deltaSeconds ); //Only sends now, the simulation steps once per frame in UpdateMidMatch.
 
+#ifndef HEADLESS_SERVER
 	//How else would we handle client rendering themselves before the session's up and going and connected and in a game?
-	if ( m_gameSession == nullptr )
+	if ( !m_didClientRender )
 	{
 		EngineEventUpdate ev( deltaSeconds ); //To render FPS.
-		TheEventSystem::Instance()->TriggerEvent( "TheGame::ClientRender2D", &ev ); //Session doesn't exist yet to trigger this render function.
-	}
-	else
-	{
-		m_didClientRender = false; //Re-zeroing.
-		bool didTickNetwork = m_gameSession->SessionUpdate( deltaSeconds ); //May or may not set did client render true, cf. ClientUpdatePlayers.
-		if ( !didTickNetwork || !m_didClientRender )
-		{
-			EngineEventUpdate ev( deltaSeconds ); //To render FPS.
-			TheEventSystem::Instance()->TriggerEvent( "TheGame::ClientRender2D", &ev ); //SessionUpdate didn't get to ClientRender trigger yet.
-		}
+		TheEventSystem::Instance()->TriggerEvent( "TheGame::ClientRender2D", &ev ); //UpdateMidMatch didn't get to ClientRender trigger.
 	}
+#endif
 }
 
 
@@ -125,18 +133,20 @@ void TheGame::UpdateWorld( float deltaSeconds )
 		return;
 	}
 
+	double nowSeconds = GetCurrentTimeSeconds();
 	for ( std::vector<TeardropNPC*>::iterator enemyIter = m_teardropEnemies.begin(); enemyIter != m_teardropEnemies.end(); )
 	{
 		TeardropNPC* enemy = *enemyIter;
 		enemy->Update( deltaSeconds );
+		enemy->RecordBoundsHistory( nowSeconds );
 
-		AABB2f enemyBounds = enemy->GetBounds();
 		bool enemyDied = false;
 		for each ( PlayerAvatar* avatar in m_playerAvatars )
 		{
 			if ( avatar == nullptr )
 				continue;
 			
+			AABB2f enemyBounds = enemy->GetBoundsAt( GetLagCompensatedSeconds( avatar, nowSeconds ) ); //Where this avatar's owner saw it.
 			if ( DoAABBsOverlap( enemyBounds, avatar->GetBounds() ) )
 				enemyDied = HandleCollision( avatar, enemy );
 
@@ -176,6 +186,29 @@ bool TheGame::HandleCollision( PlayerAvatar* avatar, TeardropNPC* enemy )
 }
 
 
+//--------------------------------------------------------------------------------------------------------------
+double TheGame::GetLagCompensatedSeconds( PlayerAvatar* avatar, double nowSeconds )
+{
+	//Remote owners moved against enemies as they rendered them, which they stamp on their updates in our time, cf. Protocol_PlayerAvatar::ClientWriteUpdateToMessage.
+	NetConnection* ownerConn = m_gameSession->GetIndexedConnection( avatar->GetController()->GetOwningConnectionIndex() );
+	if ( ( ownerConn == nullptr ) || ownerConn->IsMe() )
+		return nowSeconds;
+
+	double viewSeconds = avatar->GetOwnerViewHostSeconds();
+	if ( viewSeconds < 0.0 ) //Not clock synced yet, so estimate it.
+	{
+		if ( !ownerConn->HasRTTEstimate() )
+			return nowSeconds;
+
+		//A whole round trip, half for what they saw to reach them and half for their inputs to reach us, then their interpolation delay.
+		//Our NetObjectInterpolation setting stands in for theirs, only the stamp carries it.
+		viewSeconds = nowSeconds - ( ownerConn->GetSmoothedRTTSeconds() + NetObjectSystem::GetInterpolationDelaySeconds() );
+	}
+
+	return GetMax( GetMin( viewSeconds, nowSeconds ), nowSeconds - LAGCOMP_MAX_REWIND_SECONDS );
+}
+
+
 //--------------------------------------------------------------------------------------------------------------
 int8_t TheGame::GetHighestPlayerSwordLevel()
 {
@@ -198,6 +231,7 @@ int8_t TheGame::GetHighestPlayerSwordLevel()
 //--------------------------------------------------------------------------------------------------------------
 void TheGame::UpdateAudioListener()
 {
+#ifndef HEADLESS_SERVER //No audio system to listen with.
 	//Update listener in positional audio subsystem (VR or not).
 	const Vector3f& camPos = s_playerCamera3D->m_worldPosition;
 	FMOD_3D_ATTRIBUTES attributes = { { 0 } };
@@ -211,6 +245,7 @@ void TheGame::UpdateAudioListener()
 	attributes.forward.y = 0.f;
 	attributes.forward.z = 0.f;
 	g_theAudio->SetListenerAttributes( 0, &attributes );
+#endif
 }
 
 
@@ -223,7 +258,9 @@ void TheGame::InitGameStates()
 	State* titleState = m_gameStateMachine.CreateState( "TheGameState_Title", true );
 	TheEventSystem::Instance()->RegisterEvent<TheGame, &TheGame::StartupTitle >( "TheGame_StartupTitle", this );
 	TheEventSystem::Instance()->RegisterEvent<TheGame, &TheGame::UpdateTitle >( "TheGame_UpdateTitle", this );
+#ifndef HEADLESS_SERVER
 	TheEventSystem::Instance()->RegisterEvent<TheGame, &TheGame::RenderTitle >( "TheGame_RenderTitle", this );
+#endif
 	TheEventSystem::Instance()->RegisterEvent<TheGame, &TheGame::ShutdownTitle >( "TheGame_ShutdownTitle", this );
 	titleState->AddStateCommand( STATE_STAGE_ENTERING, StateCommand( "TheGame_StartupTitle" ) );
 	titleState->AddStateCommand( STATE_STAGE_EXITING, StateCommand( "TheGame_ShutdownTitle" ) );
@@ -231,7 +268,9 @@ void TheGame::InitGameStates()
 	State* lobbyState = m_gameStateMachine.CreateState( "TheGameState_Lobby" );
 	TheEventSystem::Instance()->RegisterEvent<TheGame, &TheGame::StartupLobby >( "TheGame_StartupLobby", this );
 	TheEventSystem::Instance()->RegisterEvent<TheGame, &TheGame::UpdateLobby >( "TheGame_UpdateLobby", this );
+#ifndef HEADLESS_SERVER
 	TheEventSystem::Instance()->RegisterEvent<TheGame, &TheGame::RenderLobby >( "TheGame_RenderLobby", this );
+#endif
 	TheEventSystem::Instance()->RegisterEvent<TheGame, &TheGame::ShutdownLobby >( "TheGame_ShutdownLobby", this );
 	lobbyState->AddStateCommand( STATE_STAGE_ENTERING, StateCommand( "TheGame_StartupLobby" ) );
 	lobbyState->AddStateCommand( STATE_STAGE_EXITING, StateCommand( "TheGame_ShutdownLobby" ) );
@@ -240,7 +279,9 @@ void TheGame::InitGameStates()
 	State* playState = m_gameStateMachine.CreateState( "TheGameState_MidMatch" );
 	TheEventSystem::Instance()->RegisterEvent<TheGame, &TheGame::StartupMidMatch >( "TheGame_StartupMidMatch", this );
 	TheEventSystem::Instance()->RegisterEvent<TheGame, &TheGame::UpdateMidMatch >( "TheGame_UpdateMidMatch", this );
+#ifndef HEADLESS_SERVER
 	TheEventSystem::Instance()->RegisterEvent<TheGame, &TheGame::RenderMidMatch >( "TheGame_RenderMidMatch", this );
+#endif
 	TheEventSystem::Instance()->RegisterEvent<TheGame, &TheGame::ShutdownMidMatch >( "TheGame_ShutdownMidMatch", this );
 	playState->AddStateCommand( STATE_STAGE_ENTERING, StateCommand( "TheGame_StartupMidMatch" ) );
 	playState->AddStateCommand( STATE_STAGE_EXITING, StateCommand( "TheGame_ShutdownMidMatch" ) );
@@ -248,7 +289,9 @@ void TheGame::InitGameStates()
 	State* winState = m_gameStateMachine.CreateState( "TheGameState_PostMatch" );
 	TheEventSystem::Instance()->RegisterEvent<TheGame, &TheGame::StartupPostMatch >( "TheGame_StartupPostMatch", this );
 	TheEventSystem::Instance()->RegisterEvent<TheGame, &TheGame::UpdatePostMatch >( "TheGame_UpdatePostMatch", this );
+#ifndef HEADLESS_SERVER
 	TheEventSystem::Instance()->RegisterEvent<TheGame, &TheGame::RenderPostMatch >( "TheGame_RenderPostMatch", this );
+#endif
 	TheEventSystem::Instance()->RegisterEvent<TheGame, &TheGame::ShutdownPostMatch >( "TheGame_ShutdownPostMatch", this );
 	winState->AddStateCommand( STATE_STAGE_ENTERING, StateCommand( "TheGame_StartupPostMatch" ) );
 	winState->AddStateCommand( STATE_STAGE_EXITING, StateCommand( "TheGame_ShutdownPostMatch" ) );
@@ -270,12 +313,14 @@ void TheGame::RegisterEvents()
 	TheEventSystem::Instance()->RegisterEvent< TheGame, &TheGame::Render2D >( "TheGame::Render2D", this );
 	TheEventSystem::Instance()->RegisterEvent< TheGame, &TheGame::Render3D >( "TheGame::Render3D", this );
 */
+#ifndef HEADLESS_SERVER //Defined in TheGameRenderer.cpp, which servers don't build.
 	//This way TheEngine can just shout off at these string IDs which may be unregistered, and fail silently just fine.
 	TheEventSystem::Instance()->RegisterEvent< TheGame, &TheGame::RenderDebug2D >( "TheGame::RenderDebug2D", this );
 	TheEventSystem::Instance()->RegisterEvent< TheGame, &TheGame::RenderDebug3D >( "TheGame::RenderDebug3D", this );
 
 	//Meanwhile, game code can pick whether it wants to use Render2D/Render3D or not, as in this SD6 netgame:
 	TheEventSystem::Instance()->RegisterEvent< TheGame, &TheGame::ClientRender2D >( "TheGame::ClientRender2D", this );
+#endif
 
 	TheEventSystem::Instance()->RegisterEvent< TheGame, &TheGame::OnPlayerExploded_Handler >( "GameEvent_OnPlayerExploded", this );
 
@@ -297,9 +342,11 @@ void TheGame::Startup()
 	RegisterConsoleCommands_General();
 	RegisterConsoleCommands_Networking();
 
+#ifndef HEADLESS_SERVER //Servers load no shaders, textures or sprites, cf. PLAYER_AVATAR_BOUNDS_SIZE.
 	InitSceneRendering();
 
 	InitSpriteRenderer();
+#endif
 
 	InitSceneAudio();
 
@@ -316,6 +363,7 @@ void TheGame::InitSceneAudio()
 }
 
 
+#ifndef HEADLESS_SERVER
 //--------------------------------------------------------------------------------------------------------------
 void TheGame::SetupParticleSystems()
 {
@@ -401,20 +449,27 @@ void TheGame::InitAndRegisterSprites()
 	changingBullet->SetLayerID( MAIN_LAYER_ID );
 	changingBullet->Enable();
 }
+#endif
 
 
 //--------------------------------------------------------------------------------------------------------------
 void TheGame::Shutdown()
 {
+#ifndef HEADLESS_SERVER
 	TheGameDebug::Shutdown();
+#endif
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 bool TheGame::OnPlayerExploded_Handler( EngineEvent* eventContext )
 {
+#ifdef HEADLESS_SERVER
+	UNREFERENCED( eventContext );
+#else
 	WorldCoords2D blastPosition = dynamic_cast<GameEventPlayerExploded*>( eventContext )->m_position;
 	ParticleSystem::Play( "Explosion", VFX_LAYER_ID, blastPosition );
+#endif
 
 	return SHOULD_NOT_UNSUB;
 }
@@ -17,6 +17,7 @@ class PlayerAvatar;
 struct NetObject;
 class TextRenderer;
 class TeardropNPC;
+struct NetCaptureReplayStats;
 
 
 //-----------------------------------------------------------------------------
@@ -79,7 +80,11 @@ public:
 	bool IsMyConnectionHosting();
 	NetSession* GetGameNetSession() { return m_gameSession; }
 	void StartGameNetSession();
+	void StartDedicatedServer( uint16_t port, int8_t goalTearCount, int numPlayersToAutoStartMatch ); //0 players waits on NetGameStart.
+	bool IsDedicatedServer() const { return m_isDedicatedServer; }
 	void StopGameNetSession();
+	void SetNetCapturePrefix( const std::string& prefix ) { m_netCapturePrefix = prefix; } //Empty stops capturing future sessions.
+	bool ReplayGameNetCapture( const char* filename, NetCaptureReplayStats& out_stats ); //Drives the game through a new session, so stop ours first.
 	void HostGame( const std::string& username );
 		void StartHostListen();
 		void StopHostListen();
@@ -115,6 +120,10 @@ private:
 	NetSession* m_gameSession;
 	static CameraMode s_activeCameraMode;
 
+	void CreateGameNetSession(); //Everything StartGameNetSession does short of opening a socket, shared with ReplayGameNetCapture.
+	std::string m_netCapturePrefix; //Each session started captures to <prefix>_<#>.netcap, since the lobby restarts ours every visit.
+	unsigned int m_numNetCapturesStarted;
+
 	void RegisterEvents();
 
 	void InitGameStates();
@@ -175,6 +184,7 @@ private:
 
 	int8_t GetHighestPlayerSwordLevel();
 	bool HandleCollision( PlayerAvatar* avatar, TeardropNPC* enemy );
+	double GetLagCompensatedSeconds( PlayerAvatar* avatar, double nowSeconds ); //When the avatar's owner saw the world it acted on.
 
 	PlayerController* m_playerControllers[ MAX_NUM_PLAYERS ];
 	PlayerAvatar* m_playerAvatars[ MAX_NUM_PLAYERS ];
@@ -190,6 +200,11 @@ private:
 	std::vector<PlayerController*> m_unconfirmedPlayers;
 
 	int8_t m_hostSelectedGoalTearCount;
+	uint16_t m_sessionPort;
+	bool m_isDedicatedServer; //Hosts without a player of its own, and cycles back to the lobby after each match.
+	int8_t m_dedicatedServerGoalTearCount;
+	int m_numPlayersToAutoStartMatch;
+	float m_secondsInPostMatch;
 	bool m_shouldSendAttackMessage;
 	PlayerIndex m_winningPlayerIndex;
 	std::vector<TeardropNPC*> m_teardropEnemies;
@@ -97,6 +97,7 @@ void TheGame::UpdateFromKeyboard3D( float deltaSeconds )
 	Vector3f camLeftXY = s_playerCamera3D->GetLeftXY();
 	Vector3f& camPos = s_playerCamera3D->m_worldPosition;
 
+#ifndef HEADLESS_SERVER //No renderer, so no lights to pilot.
 	if ( g_theRenderer->IsPilotingLight() )
 	{
 		if ( g_theInput->IsKeyDown( 'I' ) )
@@ -119,6 +120,7 @@ void TheGame::UpdateFromKeyboard3D( float deltaSeconds )
 
 		return;
 	}
+#endif
 
 	if ( s_playerCamera3D->m_usesPolarTranslations )
 	{
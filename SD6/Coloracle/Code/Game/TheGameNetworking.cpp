@@ -7,6 +7,8 @@
 #include "Engine/Networking/NetMessageCallbacks.hpp"
 #include "Engine/Core/TheEventSystem.hpp"
 #include "Engine/Core/TheConsole.hpp"
+#include "Engine/String/StringUtils.hpp"
+#include "Engine/Time/Time.hpp"
 
 #include "Game/DummyNetObj.hpp"
 #include "Game/Game Entities/PlayerAvatar.hpp"
@@ -251,6 +253,150 @@ static void NetToggleTimeouts( Command& )
 }
 
 
+//--------------------------------------------------------------------------------------------------------------
+static void NetSessionRTT( Command& )
+{
+	if ( !g_theGame->IsGameSessionRunning() )
+		return;
+
+	NetSession* sessionRef = g_theGame->GetGameNetSession();
+	for ( NetConnectionIndex connIndex = 0; connIndex < sessionRef->GetNumAllowedConnections(); connIndex++ )
+	{
+		NetConnection* conn = sessionRef->GetIndexedConnection( connIndex );
+		if ( ( conn == nullptr ) || conn->IsMe() )
+			continue;
+
+		if ( !conn->HasRTTEstimate() )
+		{
+			g_theConsole->Printf( "Connection #%u (%s): no RTT samples yet, resend timeout %.0f ms.", 
+				connIndex, conn->GetGuidString().c_str(), 1000.0 * conn->GetResendTimeoutSeconds() );
+			continue;
+		}
+
+		g_theConsole->Printf( "Connection #%u (%s): RTT %.1f ms, RTT variance %.1f ms, resend timeout %.0f ms.", 
+			connIndex, conn->GetGuidString().c_str(), 1000.0 * conn->GetSmoothedRTTSeconds(), 1000.0 * conn->GetRTTVarianceSeconds(), 1000.0 * conn->GetResendTimeoutSeconds() );
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+static void NetSessionSendRates( Command& )
+{
+	if ( !g_theGame->IsGameSessionRunning() )
+		return;
+
+	NetSession* sessionRef = g_theGame->GetGameNetSession();
+	for ( NetConnectionIndex connIndex = 0; connIndex < sessionRef->GetNumAllowedConnections(); connIndex++ )
+	{
+		NetConnection* conn = sessionRef->GetIndexedConnection( connIndex );
+		if ( ( conn == nullptr ) || conn->IsMe() )
+			continue;
+
+		g_theConsole->Printf( "Connection #%u (%s): sending at %.0f Hz (max %.0f Hz), %.0f%% packet loss last sample.", 
+			connIndex, conn->GetGuidString().c_str(), conn->GetSendRateHz(), MAX_SEND_RATE_HZ, 100.f * conn->GetMeasuredLossRate() );
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+static void NetSessionClock( Command& )
+{
+	if ( !g_theGame->IsGameSessionRunning() )
+		return;
+
+	NetSession* sessionRef = g_theGame->GetGameNetSession();
+	NetConnection* hostConn = sessionRef->GetHostConnection();
+	if ( sessionRef->IsMyConnectionHosting() || ( hostConn == nullptr ) )
+	{
+		g_theConsole->Printf( "Host time is our own clock: %.3f s.", sessionRef->GetHostTimeSeconds() );
+		return;
+	}
+
+	const NetClockSync& clockSync = hostConn->GetClockSync();
+	if ( !clockSync.HasEstimate() )
+	{
+		g_theConsole->Printf( "No clock sync response from the host yet." );
+		return;
+	}
+
+	double nowSeconds = GetCurrentTimeSeconds();
+	g_theConsole->Printf( "Host time %.3f s: offset %+.2f ms, drift %+.1f ppm, best round trip %.2f ms.", 
+		clockSync.GetRemoteTimeSeconds( nowSeconds ), 1000.0 * clockSync.GetOffsetSeconds( nowSeconds ), 1000000.0 * clockSync.GetDrift(), 1000.0 * clockSync.GetBestRTTSeconds() );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+static void NetSessionTraffic( Command& args )
+{
+	if ( !g_theGame->IsGameSessionRunning() )
+		return;
+
+	std::string windowStr;
+	args.GetNextString( &windowStr ); //"minute" for the last minute, else the last second.
+
+	g_theGame->GetGameNetSession()->PrintTrafficStats( windowStr == "minute" );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+static void NetObjectInterpolation( Command& args )
+{
+	float delayMs;
+	if ( !args.GetNextFloat( &delayMs, -1.f ) || ( delayMs < 0.f ) )
+	{
+		g_theConsole->Printf( "Usage: NetObjectInterpolation <delayMs> [maxExtrapolationMs]" );
+		g_theConsole->Printf( "Currently rendering %.0f ms behind, extrapolating up to %.0f ms.", 
+			1000.0 * NetObjectSystem::GetInterpolationDelaySeconds(), 1000.0 * NetObjectSystem::GetMaxExtrapolationSeconds() );
+		return;
+	}
+	NetObjectSystem::SetInterpolationDelaySeconds( delayMs / 1000.0 );
+
+	float maxExtrapolationMs;
+	if ( args.GetNextFloat( &maxExtrapolationMs, -1.f ) && ( maxExtrapolationMs >= 0.f ) )
+		NetObjectSystem::SetMaxExtrapolationSeconds( maxExtrapolationMs / 1000.0 );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+static void NetSessionCapture( Command& args )
+{
+	std::string prefix = args.GetArgsString();
+	g_theGame->SetNetCapturePrefix( prefix );
+
+	if ( prefix.empty() )
+		g_theConsole->Printf( "Sessions started from now on won't be captured." );
+	else
+		g_theConsole->Printf( "Sessions started from now on capture to %s_<#>.netcap, restart the NetSession to begin.", prefix.c_str() );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+static void NetSessionReplayCapture( Command& args )
+{
+	std::string filename;
+	int numPasses;
+	if ( !args.GetNextString( &filename ) )
+	{
+		g_theConsole->Printf( "Incorrect arguments." );
+		g_theConsole->Printf( "Usage: NetSessionReplayCapture <filename.netcap> [numPasses]" );
+		return;
+	}
+	args.GetNextInt( &numPasses, 1 );
+
+	for ( int passIndex = 0; passIndex < numPasses; passIndex++ ) //A new session each pass, so each sees the same joins.
+	{
+		NetCaptureReplayStats stats;
+		if ( !g_theGame->ReplayGameNetCapture( filename.c_str(), stats ) )
+			return;
+
+		double usPerPacket = ( stats.numPacketsReplayed > 0 ) ? ( 1000000.0 * stats.replaySeconds / stats.numPacketsReplayed ) : 0.0;
+		LogAndShowPrintfWithTag( "NetSession", "Replay pass %d: %d packets (%u bytes) in %.3fms, %.2fus per packet. %d rejected, %d sent ones skipped, %.1fs when captured.",
+								 passIndex, stats.numPacketsReplayed, stats.numBytesReplayed, 1000.0 * stats.replaySeconds, usPerPacket,
+								 stats.numPacketsRejected, stats.numPacketsSkipped, stats.capturedSeconds );
+	}
+}
+
+
 //--------------------------------------------------------------------------------------------------------------
 static void NetSessionStart( Command& )
 {
@@ -417,38 +563,49 @@ void OnMatchEndReceived( const NetSender&, NetMessage& matchEndMessage )
 
 
 //--------------------------------------------------------------------------------------------------------------
-void TheGame::StartGameNetSession()
+void TheGame::CreateGameNetSession()
 {
 	m_gameSession = new NetSession( "GameSession" );
 	m_gameSession->RegisterMessage( NETMSG_GAME_BOOM, "Game_Boom", OnBoomReceived, NETMSGCTRL_NONE, NETMSGOPT_RELIABLE );
-	m_gameSession->RegisterMessage( NETMSG_PING_INORDER, "Ping_InOrder", OnPingReceived, NETMSGCTRL_PROCESSED_INORDER, NETMSGOPT_RELIABLE );
+	m_gameSession->RegisterMessage( NETMSG_PING_INORDER, "Ping_InOrder", OnPingReceived, NETMSGCTRL_PROCESSED_INORDER, NETMSGOPT_RELIABLE, GAME_INORDER_CHANNEL_DEBUG );
 
 	m_gameSession->RegisterMessage( NETMSG_GAME_MATCH_STARTED, "Game_MatchStarted", OnMatchStartReceived, NETMSGCTRL_NONE, NETMSGOPT_RELIABLE );
 	m_gameSession->RegisterMessage( NETMSG_GAME_MATCH_ENDED, "Game_MatchEnded", OnMatchEndReceived, NETMSGCTRL_NONE, NETMSGOPT_RELIABLE );
 
-	m_gameSession->RegisterMessage( NETMSG_GAME_PLAYER_REQUEST_SFC, "Game_Player_Request", OnPlayerRequestReceivedFromClient, NETMSGCTRL_PROCESSED_INORDER, NETMSGOPT_RELIABLE );
-	m_gameSession->RegisterMessage( NETMSG_GAME_PLAYER_JOINED_SFS, "Game_Player_Joined", OnPlayerJoinedReceivedFromServer, NETMSGCTRL_PROCESSED_INORDER, NETMSGOPT_RELIABLE );
-	m_gameSession->RegisterMessage( NETMSG_GAME_PLAYER_UPDATE_SFS, "Game_Player_ServerUpdate", OnPlayerUpdateReceivedFromServer, NETMSGCTRL_PROCESSED_INORDER, NETMSGOPT_RELIABLE );
-	m_gameSession->RegisterMessage( NETMSG_GAME_PLAYER_UPDATE_SFC, "Game_Player_ClientUpdate", OnPlayerUpdateReceivedFromClient, NETMSGCTRL_PROCESSED_INORDER, NETMSGOPT_RELIABLE );
-	m_gameSession->RegisterMessage( NETMSG_GAME_PLAYER_LEAVE_SFS, "Game_Player_ServerLeave", OnPlayerLeaveReceivedFromServer, NETMSGCTRL_PROCESSED_INORDER, NETMSGOPT_RELIABLE );
+	m_gameSession->RegisterMessage( NETMSG_GAME_PLAYER_REQUEST_SFC, "Game_Player_Request", OnPlayerRequestReceivedFromClient, NETMSGCTRL_PROCESSED_INORDER, NETMSGOPT_RELIABLE, GAME_INORDER_CHANNEL_GAMEPLAY );
+	m_gameSession->RegisterMessage( NETMSG_GAME_PLAYER_JOINED_SFS, "Game_Player_Joined", OnPlayerJoinedReceivedFromServer, NETMSGCTRL_PROCESSED_INORDER, NETMSGOPT_RELIABLE, GAME_INORDER_CHANNEL_GAMEPLAY );
+	m_gameSession->RegisterMessage( NETMSG_GAME_PLAYER_UPDATE_SFS, "Game_Player_ServerUpdate", OnPlayerUpdateReceivedFromServer, NETMSGCTRL_PROCESSED_INORDER, NETMSGOPT_RELIABLE, GAME_INORDER_CHANNEL_GAMEPLAY );
+	m_gameSession->RegisterMessage( NETMSG_GAME_PLAYER_UPDATE_SFC, "Game_Player_ClientUpdate", OnPlayerUpdateReceivedFromClient, NETMSGCTRL_PROCESSED_INORDER, NETMSGOPT_RELIABLE, GAME_INORDER_CHANNEL_GAMEPLAY );
+	m_gameSession->RegisterMessage( NETMSG_GAME_PLAYER_LEAVE_SFS, "Game_Player_ServerLeave", OnPlayerLeaveReceivedFromServer, NETMSGCTRL_PROCESSED_INORDER, NETMSGOPT_RELIABLE, GAME_INORDER_CHANNEL_GAMEPLAY );
 
 	//Whereas PlayerController updates were reliable, NetObjUpdates (INCLUDING PlayerAvatar) are unreliable.
-	m_gameSession->RegisterMessage( NETMSG_GAME_NETOBJ_CREATE_SFS, "Game_NetObj_Create", OnNetObjectCreateReceivedFromServer, NETMSGCTRL_PROCESSED_INORDER, NETMSGOPT_RELIABLE );
-	m_gameSession->RegisterMessage( NETMSG_GAME_NETOBJ_UPDATE_SFS, "Game_NetObj_ServerUpdate", OnNetObjectUpdateReceivedFromServer, NETMSGCTRL_NONE, NETMSGOPT_NONE );
-	m_gameSession->RegisterMessage( NETMSG_GAME_NETOBJ_UPDATE_SFC, "Game_NetObj_ClientUpdate", OnNetObjectUpdateReceivedFromClient, NETMSGCTRL_NONE, NETMSGOPT_NONE );
-	m_gameSession->RegisterMessage( NETMSG_GAME_NETOBJ_DESYNC_SFS, "Game_NetObj_Desync", OnNetObjectDesyncReceivedFromServer, NETMSGCTRL_PROCESSED_INORDER, NETMSGOPT_RELIABLE );
+	//They're also replaceable, so an unsent one is overwritten by a newer one rather than both going out.
+	m_gameSession->RegisterMessage( NETMSG_GAME_NETOBJ_CREATE_SFS, "Game_NetObj_Create", OnNetObjectCreateReceivedFromServer, NETMSGCTRL_PROCESSED_INORDER, NETMSGOPT_RELIABLE, GAME_INORDER_CHANNEL_GAMEPLAY );
+	m_gameSession->RegisterMessage( NETMSG_GAME_NETOBJ_UPDATE_BATCH_SFS, "Game_NetObj_ServerUpdateBatch", OnNetObjectUpdateBatchReceivedFromServer, NETMSGCTRL_NONE, NETMSGOPT_REPLACEABLE );
+	m_gameSession->RegisterMessage( NETMSG_GAME_NETOBJ_UPDATE_SFC, "Game_NetObj_ClientUpdate", OnNetObjectUpdateReceivedFromClient, NETMSGCTRL_NONE, NETMSGOPT_REPLACEABLE );
+	m_gameSession->RegisterMessage( NETMSG_GAME_NETOBJ_DESYNC_SFS, "Game_NetObj_Desync", OnNetObjectDesyncReceivedFromServer, NETMSGCTRL_PROCESSED_INORDER, NETMSGOPT_RELIABLE, GAME_INORDER_CHANNEL_GAMEPLAY );
 
 	TheEventSystem::Instance()->RegisterEvent< TheGame, &TheGame::OnConnectionJoined_Handler >( "OnConnectionJoined", g_theGame );
 	TheEventSystem::Instance()->RegisterEvent< TheGame, &TheGame::OnConnectionLeave_Handler >( "OnConnectionLeave", g_theGame );
 	TheEventSystem::Instance()->RegisterEvent< TheGame, &TheGame::OnNetworkTick_Handler >( "OnNetworkTick", g_theGame );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void TheGame::StartGameNetSession()
+{
+	CreateGameNetSession();
 
-	if ( m_gameSession->Start( GAME_PORT, MAX_NUM_PLAYERS ) )
+	if ( m_gameSession->Start( m_sessionPort, MAX_NUM_PLAYERS ) )
 	{
 		char addrBuffer[ MAX_ADDR_STRLEN ];
 		m_gameSession->GetConnectionAddress( addrBuffer, MAX_ADDR_STRLEN );
 
 		Logger::PrintfWithTag( "NetSession", "NetSession opened socket at address %s.", addrBuffer );
 		g_theConsole->Printf( "NetSession opened socket at address %s.", addrBuffer );
+
+		if ( !m_netCapturePrefix.empty() ) //Before the lobby hosts or joins, so a replay sees those too.
+			m_gameSession->StartCapture( Stringf( "%s_%u.netcap", m_netCapturePrefix.c_str(), m_numNetCapturesStarted++ ).c_str() );
 	}
 	else
 	{
@@ -460,6 +617,43 @@ void TheGame::StartGameNetSession()
 }
 
 
+//--------------------------------------------------------------------------------------------------------------
+void TheGame::StartDedicatedServer( uint16_t port, int8_t goalTearCount, int numPlayersToAutoStartMatch )
+{
+	m_isDedicatedServer = true;
+	m_sessionPort = port;
+	m_dedicatedServerGoalTearCount = goalTearCount;
+	m_numPlayersToAutoStartMatch = numPlayersToAutoStartMatch;
+
+	m_gameStateMachine.SetCurrentState( "TheGameState_Lobby" ); //Whose startup hosts and listens, see StartupLobby.
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool TheGame::ReplayGameNetCapture( const char* filename, NetCaptureReplayStats& out_stats )
+{
+	if ( m_gameSession != nullptr )
+	{
+		g_theConsole->Printf( "Stop the NetSession first, the replay's handlers reach the game through GetGameNetSession()." );
+		return false;
+	}
+
+	CreateGameNetSession();
+	if ( !m_gameSession->ReplayCapture( filename, out_stats ) )
+	{
+		TheEventSystem::Instance()->UnregisterSubscriber< TheGame, &TheGame::OnConnectionJoined_Handler >( "OnConnectionJoined", g_theGame );
+		TheEventSystem::Instance()->UnregisterSubscriber< TheGame, &TheGame::OnConnectionLeave_Handler >( "OnConnectionLeave", g_theGame );
+		TheEventSystem::Instance()->UnregisterSubscriber< TheGame, &TheGame::OnNetworkTick_Handler >( "OnNetworkTick", g_theGame );
+		delete m_gameSession;
+		m_gameSession = nullptr;
+		return false;
+	}
+
+	StopGameNetSession(); //Replaying sessions count as running, so it comes down like any other.
+	return true;
+}
+
+
 //--------------------------------------------------------------------------------------------------------------
 static void NetGameStart( Command& ) //Begin the game with connected players.
 {
@@ -528,7 +722,7 @@ static void NetSessionCreateConnection( Command& args )
 
 badArgs:
 	g_theConsole->Printf( "Incorrect arguments." );
-	g_theConsole->Printf( "Usage: NetSessionCreateConnection <0-%d ConnIndex> <ip> <port#> <guidStr>", MAX_CONNECTIONS ); //e.g. NetSessionPing 192.168.1.65 4334 myMessage
+	g_theConsole->Printf( "Usage: NetSessionCreateConnection <0-%d ConnIndex> <ip> <port#> <guidStr>", g_theGame->GetGameNetSession()->GetNumAllowedConnections() - 1 ); //e.g. NetSessionPing 192.168.1.65 4334 myMessage
 	return;
 }
 
@@ -564,7 +758,7 @@ static void NetSessionDestroyConnection( Command& args )
 
 badArgs:
 	g_theConsole->Printf( "Incorrect arguments." );
-	g_theConsole->Printf( "Usage: NetSessionDestroyConnection <0-%d ConnIndex>", MAX_CONNECTIONS ); //e.g. NetSessionPing 192.168.1.65 4334 myMessage
+	g_theConsole->Printf( "Usage: NetSessionDestroyConnection <0-%d ConnIndex>", g_theGame->GetGameNetSession()->GetNumAllowedConnections() - 1 ); //e.g. NetSessionPing 192.168.1.65 4334 myMessage
 	return;
 }
 
@@ -715,11 +909,12 @@ void TheGame::StopGameNetSession()
 		return;
 	}
 
-	TheEventSystem::Instance()->TriggerEvent( "OnNetSessionShutdown" );
-	TheEventSystem::Instance()->UnregisterEvent( "OnNetSessionShutdown" );
-	TheEventSystem::Instance()->UnregisterEvent( "OnConnectionJoined" );
-	TheEventSystem::Instance()->UnregisterEvent( "OnConnectionLeave" );
-	TheEventSystem::Instance()->UnregisterEvent( "OnNetworkTick" );
+	//Only ours, other sessions (e.g. NetLoadTest's) share these events.
+	EngineEvent shutdownEv( "OnNetSessionShutdown", m_gameSession );
+	TheEventSystem::Instance()->TriggerEvent( "OnNetSessionShutdown", &shutdownEv ); //Unsubs itself.
+	TheEventSystem::Instance()->UnregisterSubscriber< TheGame, &TheGame::OnConnectionJoined_Handler >( "OnConnectionJoined", g_theGame );
+	TheEventSystem::Instance()->UnregisterSubscriber< TheGame, &TheGame::OnConnectionLeave_Handler >( "OnConnectionLeave", g_theGame );
+	TheEventSystem::Instance()->UnregisterSubscriber< TheGame, &TheGame::OnNetworkTick_Handler >( "OnNetworkTick", g_theGame );
 
 	Logger::PrintfWithTag( "NetSession", "NetSession stopped." );
 	g_theConsole->Printf( "NetSession stopped." );
@@ -771,6 +966,19 @@ void TheGame::RegisterConsoleCommands_Networking()
 	//SD6 A6
 	g_theConsole->RegisterCommand( "NetGameStart", NetGameStart );
 	g_theConsole->RegisterCommand( "NetStartGame", NetGameStart );
+
+	//Connection Stats
+	g_theConsole->RegisterCommand( "NetSessionRTT", NetSessionRTT );
+	g_theConsole->RegisterCommand( "NetSessionSendRates", NetSessionSendRates );
+	g_theConsole->RegisterCommand( "NetSessionClock", NetSessionClock );
+	g_theConsole->RegisterCommand( "NetSessionTraffic", NetSessionTraffic );
+
+	//NetObject smoothing
+	g_theConsole->RegisterCommand( "NetObjectInterpolation", NetObjectInterpolation );
+
+	//Capture and replay
+	g_theConsole->RegisterCommand( "NetSessionCapture", NetSessionCapture );
+	g_theConsole->RegisterCommand( "NetSessionReplayCapture", NetSessionReplayCapture );
 }
 
 
@@ -778,9 +986,11 @@ void TheGame::RegisterConsoleCommands_Networking()
 bool TheGame::OnConnectionJoined_Handler( EngineEvent* eventContext )
 {
 	NetConnection* conn = dynamic_cast<EngineEventNetworked*>( eventContext )->connection;
+	if ( conn->GetSession() != m_gameSession )
+		return SHOULD_NOT_UNSUB; //Some other session's, e.g. NetLoadTest's.
 
 	//This way even the host must request a player, practices writing singleplayer as multiplayer:
-	if ( conn->IsMe() )
+	if ( conn->IsMe() && !m_isDedicatedServer )
 		ClientCreatePlayerRequest( conn ); //See processing in OnPlayerCreationRequestReceived.
 
 	//If someone else joins, the server host needs to send them a PLAYER_CREATE for every player currently in the game.
@@ -830,7 +1040,11 @@ void TheGame::DestroyPlayer( PlayerIndex destroyedPlayer )
 //--------------------------------------------------------------------------------------------------------------
 bool TheGame::OnConnectionLeave_Handler( EngineEvent* eventContext )
 {
-	NetConnectionIndex connIndex = dynamic_cast<EngineEventNetworked*>( eventContext )->GetConnectionIndex();
+	EngineEventNetworked* ev = dynamic_cast<EngineEventNetworked*>( eventContext );
+	if ( ( ev->connection != nullptr ) && ( ev->connection->GetSession() != m_gameSession ) )
+		return SHOULD_NOT_UNSUB;
+
+	NetConnectionIndex connIndex = ev->GetConnectionIndex();
 	
 	if ( IsMyConnectionHosting() )
 	{
@@ -843,6 +1057,8 @@ bool TheGame::OnConnectionLeave_Handler( EngineEvent* eventContext )
 			m_gameSession->SendToAllConnections( playerLeftMsg );
 			DestroyPlayer( leavingPlayers[ controllerIndex ]->GetPlayerIndex() );
 		}
+
+		NetObjectSystem::OnConnectionLeave( connIndex );
 	}
 	else if ( m_gameSession->GetMyConnectionIndex() == connIndex )
 	{
@@ -990,7 +1206,7 @@ bool TheGame::ClientUpdateOwnedPlayers( float deltaSeconds )
 			}
 		}
 
-		avatar->Update( deltaSeconds ); //Clients own their own players, so e.g. movement update here.
+		avatar->Update( deltaSeconds ); //Owners predict their own players' movement here, the host steps the same inputs authoritatively.
 	}
 
 	EngineEventUpdate ev( deltaSeconds ); //To render FPS.
@@ -1117,25 +1333,19 @@ bool TheGame::OnNetworkTick_Handler( EngineEvent* eventContext )
 
 	EngineEventNetworked* ev = dynamic_cast<EngineEventNetworked*>( eventContext ); //Does this only get hit in certain states?
 	NetConnection* conn = ev->connection;
+	if ( conn->GetSession() != m_gameSession )
+		return SHOULD_NOT_UNSUB;
 
 	//In A3, we didn't want to tell our object where it was at. Do we now?
 //	if ( conn->IsMe() )
 //		return false; //Don't need to tell myself where my object's at.
 
-	float deltaSeconds = ev->GetDeltaSeconds();
+	float deltaSeconds = ev->GetDeltaSeconds(); //This connection's own tick interval, so only for sending to it. The simulation steps in UpdateMidMatch.
 
 	if ( strcmp( m_gameStateMachine.GetCurrentState()->GetName(), "TheGameState_MidMatch" ) != 0 )
 		return SHOULD_NOT_UNSUB;
 
-	if ( m_gameSession->IsMyConnectionHosting() )
-		ServerUpdateAuthoritativeSimulation( deltaSeconds );
-	if ( ConnectionHasPlayers() ) //Not an else clause, can be both.
-	{
-		ClientUpdateUnauthoritativeSimulation( deltaSeconds );
-		m_didClientRender = ClientUpdateOwnedPlayers( deltaSeconds ); //Only small client-owned or predictive-logic game events processed here.
-	}
-
-	NetObjectSystem::OnNetworkTick( conn );
+	NetObjectSystem::OnNetworkTick( conn, deltaSeconds );
 
 	//Do not do updating code here, you'll flood the socket if you do this asap -- we send on a fixed tick.
 	//This is the last chance you have to send info until next tick.